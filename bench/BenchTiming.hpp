@@ -0,0 +1,45 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @file BenchTiming.hpp
+ * @brief Declares the timing loop the benchmarks share.
+ */
+
+namespace ms {
+namespace bench {
+
+/** Blocks run untimed first, so caches, predictors and smoothers settle. */
+constexpr int kWarmUpBlocks = 50;
+
+/** Timed runs; the fastest is the one least disturbed by the system. */
+constexpr int kRuns = 10;
+
+/**
+ * @brief Times a workload one block at a time.
+ * @param block Called as block(b) for b = 0 ... numBlocks - 1 in each run.
+ * @param numBlocks The number of blocks per run.
+ * @return The seconds the fastest of kRuns runs took, after kWarmUpBlocks
+ * untimed calls of block(0) ... block(kWarmUpBlocks - 1).
+ */
+template <typename Block> double bestSeconds(Block &&block, int numBlocks) {
+  for (int b = 0; b < kWarmUpBlocks; ++b) {
+    block(b);
+  }
+  double best = 0.0;
+  for (int run = 0; run < kRuns; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < numBlocks; ++b) {
+      block(b);
+    }
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    best = run == 0 ? seconds : std::min(best, seconds);
+  }
+  return best;
+}
+
+} // namespace bench
+} // namespace ms
@@ -0,0 +1,133 @@
+#include "ConvolutionNode.hpp"
+#include "Denormals.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <time.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * @file ConvolutionBench.cpp
+ * @brief Measures ConvolutionNode memory and CPU per second of impulse
+ * response.
+ *
+ * Renders noise through decaying-noise responses of several lengths, in
+ * mono, stereo and true stereo, paced in real time so that the background
+ * worker runs as it would behind a device. "audio" is the time spent in
+ * process() and "worker" the CPU time of the background worker, as
+ * percentages of the audio rendered; their total is also given per second
+ * of impulse response. Late partitions are those the worker did not
+ * finish in time.
+ */
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+
+/** CPU time of the process, or of the calling thread, in seconds. */
+double cpuSeconds(clockid_t clock) {
+  timespec now;
+  clock_gettime(clock, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+struct Layout {
+  const char *name;
+  int inputs;
+  int outputs;
+  int responses;
+};
+
+} // namespace
+
+int main() {
+  const ms::ScopedFlushDenormals flushDenormals;
+  const int blockSize = 256;
+  const double seconds = 4.0;
+  const int numBlocks = static_cast<int>(seconds * kSampleRate / blockSize);
+
+  std::printf("convolution, %d-frame blocks, %.0f s rendered per case\n",
+              blockSize, seconds);
+  std::printf("%-12s %6s %10s %9s %9s %12s %6s\n", "layout", "IR s",
+              "memory MB", "audio %", "worker %", "total %/IRs", "late");
+
+  const Layout layouts[] = {{"mono", 1, 1, 1},
+                            {"stereo", 2, 2, 2},
+                            {"true stereo", 2, 2, 4}};
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+  for (const Layout &layout : layouts) {
+    for (double irSeconds : {1.0, 4.0, 10.0}) {
+      const int length = static_cast<int>(irSeconds * kSampleRate);
+      std::vector<std::vector<float>> response(layout.responses,
+                                               std::vector<float>(length));
+      for (std::vector<float> &channel : response) {
+        for (int i = 0; i < length; ++i) {
+          channel[i] = noise(rng) * std::exp(-6.9f * i / length);
+        }
+      }
+
+      ms::ConvolutionNode node("reverb", layout.inputs, layout.outputs);
+      node.prepare(kSampleRate, blockSize);
+      node.setImpulseResponse(response);
+
+      std::vector<std::vector<float>> in(layout.inputs,
+                                         std::vector<float>(blockSize));
+      std::vector<std::vector<float>> out(layout.outputs,
+                                          std::vector<float>(blockSize));
+      std::vector<const float *> inputs;
+      std::vector<float *> outputs;
+      for (std::vector<float> &channel : in) {
+        for (float &x : channel) {
+          x = noise(rng);
+        }
+        inputs.push_back(channel.data());
+      }
+      for (std::vector<float> &channel : out) {
+        outputs.push_back(channel.data());
+      }
+
+      // Warm up past the crossfade and the first large partitions.
+      for (int b = 0; b < kSampleRate / blockSize; ++b) {
+        node.process(inputs.data(), outputs.data(), blockSize);
+      }
+      const uint64_t lateBefore = node.getStats().lateTasks;
+
+      const double processStart = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+      const double threadStart = cpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+      const auto begin = std::chrono::steady_clock::now();
+      const std::chrono::duration<double> period(
+          static_cast<double>(blockSize) / kSampleRate);
+      double audioSeconds = 0.0;
+      for (int b = 0; b < numBlocks; ++b) {
+        const auto start = std::chrono::steady_clock::now();
+        node.process(inputs.data(), outputs.data(), blockSize);
+        audioSeconds += std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+        std::this_thread::sleep_until(
+            begin + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        period * (b + 1)));
+      }
+      const double workerSeconds =
+          (cpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - processStart) -
+          (cpuSeconds(CLOCK_THREAD_CPUTIME_ID) - threadStart);
+
+      const ms::ConvolutionStats stats = node.getStats();
+      const double audioPercent = 100.0 * audioSeconds / seconds;
+      const double workerPercent = 100.0 * workerSeconds / seconds;
+      std::printf("%-12s %6.0f %10.1f %9.2f %9.2f %12.3f %6llu\n",
+                  layout.name, irSeconds,
+                  static_cast<double>(stats.memoryBytes) / (1 << 20),
+                  audioPercent, workerPercent,
+                  (audioPercent + workerPercent) / irSeconds,
+                  static_cast<unsigned long long>(stats.lateTasks -
+                                                  lateBefore));
+    }
+  }
+  return 0;
+}
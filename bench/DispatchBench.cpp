@@ -0,0 +1,96 @@
+#include "BenchTiming.hpp"
+#include "GainNode.hpp"
+#include "GraphManager.hpp"
+#include "NodeRegistry.hpp"
+#include "Simd.hpp"
+#include <cstdio>
+#include <string>
+
+/**
+ * @file DispatchBench.cpp
+ * @brief Measures per-node dispatch cost on a long chain of tiny nodes.
+ *
+ * Compares the built-in GainNode, which the plan calls directly, with an
+ * identical gain written as a plain Node subclass, which goes through the
+ * vtable. Sleeping is disabled, so both chains run every node.
+ */
+
+namespace {
+
+/** The same work as GainNode, dispatched through the vtable. */
+class VirtualGain : public ms::Node {
+public:
+  explicit VirtualGain(const std::string &id) : Node(id) {
+    addInputPort("in", ms::PortType::Audio);
+    addOutputPort("out", ms::PortType::Audio);
+    gain_ = addSmoothedParam("gain", 1.0f);
+  }
+
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) override {
+    const float *in = inputs[0];
+    float *out = outputs[0];
+    ms::SmoothedValue &gain = *getSmoother(gain_);
+    int i = 0;
+    if (gain.isRamping()) {
+      const float *g = gain.processBlock(nFrames);
+      for (; i + ms::simd::kWidth <= nFrames; i += ms::simd::kWidth) {
+        (ms::simd::Float4::load(in + i) * ms::simd::Float4::load(g + i))
+            .store(out + i);
+      }
+      for (; i < nFrames; ++i) {
+        out[i] = in[i] * g[i];
+      }
+      return;
+    }
+    const float g = gain.getCurrent();
+    const ms::simd::Float4 g4 = ms::simd::Float4::set1(g);
+    for (; i + ms::simd::kWidth <= nFrames; i += ms::simd::kWidth) {
+      (ms::simd::Float4::load(in + i) * g4).store(out + i);
+    }
+    for (; i < nFrames; ++i) {
+      out[i] = in[i] * g;
+    }
+  }
+
+private:
+  ms::ParamHandle gain_;
+};
+
+double nsPerNode(const char *typeName, int numNodes, int blockSize,
+                 int numBlocks) {
+  ms::GraphManager graph;
+  for (int i = 0; i < numNodes; ++i) {
+    const std::string id = "n" + std::to_string(i);
+    graph.createNode(id, typeName);
+    graph.getNode(id)->setFadeInDuration(0.0f);
+    if (i > 0) {
+      graph.connect("n" + std::to_string(i - 1), "out", id, "in");
+    }
+  }
+  // The chain's input is unconnected, so a GainNode, whose tail is zero,
+  // would sleep; keep every node awake to time the dispatch itself.
+  graph.setSleepThreshold(0.0f);
+  graph.prepare(48000, blockSize);
+  const double seconds = ms::bench::bestSeconds(
+      [&](int) { graph.process(blockSize); }, numBlocks);
+  return 1e9 * seconds / (static_cast<double>(numBlocks) * numNodes);
+}
+
+} // namespace
+
+int main() {
+  ms::NodeRegistry::instance().add<VirtualGain>("bench-virtual-gain");
+  const int numNodes = 1000;
+  const int numBlocks = 2000;
+  std::printf("%d-node gain chain, ns per node per block\n", numNodes);
+  std::printf("%8s %12s %12s\n", "frames", "virtual", "direct");
+  for (int blockSize : {16, 64, 256}) {
+    const double dynamic =
+        nsPerNode("bench-virtual-gain", numNodes, blockSize, numBlocks);
+    const double builtin =
+        nsPerNode(ms::GainNode::kTypeName, numNodes, blockSize, numBlocks);
+    std::printf("%8d %12.1f %12.1f\n", blockSize, dynamic, builtin);
+  }
+  return 0;
+}
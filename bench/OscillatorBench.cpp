@@ -0,0 +1,103 @@
+#include "BenchTiming.hpp"
+#include "GraphManager.hpp"
+#include "OscillatorBankNode.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @file OscillatorBench.cpp
+ * @brief Measures oscillator throughput as the number of oscillators one
+ * core can render in real time at 48 kHz.
+ *
+ * Compares the OscillatorBankNode waveforms with a bank of scalar
+ * std::sin() oscillators written as a plain Node.
+ */
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+
+/** The naive bank: one std::sin() per oscillator and sample. */
+class ScalarSineBank : public ms::Node {
+public:
+  ScalarSineBank(const std::string &id, int numOscillators)
+      : Node(id), phases_(numOscillators, 0.0f),
+        increments_(numOscillators) {
+    addOutputPort("out", ms::PortType::Audio);
+    for (int k = 0; k < numOscillators; ++k) {
+      increments_[k] = (110.0f + 10.0f * k) / kSampleRate;
+    }
+  }
+
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) override {
+    (void)inputs;
+    float *out = outputs[0];
+    std::fill(out, out + nFrames, 0.0f);
+    const float amplitude = 1.0f / static_cast<float>(phases_.size());
+    for (size_t k = 0; k < phases_.size(); ++k) {
+      float phase = phases_[k];
+      for (int i = 0; i < nFrames; ++i) {
+        out[i] += amplitude * std::sin(6.2831853f * phase);
+        phase += increments_[k];
+        phase -= phase >= 1.0f ? 1.0f : 0.0f;
+      }
+      phases_[k] = phase;
+    }
+  }
+
+private:
+  std::vector<float> phases_;
+  std::vector<float> increments_;
+};
+
+/** Renders blocks of a one-node graph and returns oscillators per core. */
+double oscillatorsPerCore(const std::function<ms::NodePtr()> &makeNode,
+                          int numOscillators, int blockSize, int numBlocks) {
+  ms::GraphManager graph;
+  ms::NodePtr node = makeNode();
+  node->setFadeInDuration(0.0f);
+  graph.createNode(node->getId(), node);
+  graph.prepare(kSampleRate, blockSize);
+  const double seconds = ms::bench::bestSeconds(
+      [&](int) { graph.process(blockSize); }, numBlocks);
+  const double audioSeconds =
+      static_cast<double>(numBlocks) * blockSize / kSampleRate;
+  return numOscillators * audioSeconds / seconds;
+}
+
+} // namespace
+
+int main() {
+  const int blockSize = 256;
+  const int numBlocks = 200;
+  std::printf("oscillators per core at %d Hz (%d-frame blocks)\n",
+              kSampleRate, blockSize);
+  std::printf("%8s %12s %12s %12s %12s\n", "bank", "scalar sin", "sine", "saw",
+              "square");
+  for (int n : {16, 64, 256, 1024}) {
+    auto bank = [n](ms::OscillatorWaveform waveform) {
+      return [n, waveform]() -> ms::NodePtr {
+        return std::make_shared<ms::OscillatorBankNode>("bank", n, waveform);
+      };
+    };
+    std::printf(
+        "%8d %12.0f %12.0f %12.0f %12.0f\n", n,
+        oscillatorsPerCore(
+            [n]() -> ms::NodePtr {
+              return std::make_shared<ScalarSineBank>("bank", n);
+            },
+            n, blockSize, numBlocks),
+        oscillatorsPerCore(bank(ms::OscillatorWaveform::Sine), n, blockSize,
+                           numBlocks),
+        oscillatorsPerCore(bank(ms::OscillatorWaveform::Saw), n, blockSize,
+                           numBlocks),
+        oscillatorsPerCore(bank(ms::OscillatorWaveform::Square), n, blockSize,
+                           numBlocks));
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include "BenchTiming.hpp"
+#include "DoubleNode.hpp"
+#include "GraphManager.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+
+/**
+ * @file PrecisionBench.cpp
+ * @brief Measures the cost of float, double and mixed-precision chains.
+ *
+ * Each chain runs a one-pole lowpass per node. The mixed chain alternates
+ * float and double nodes, so every connection crosses a precision boundary
+ * and pays for a conversion.
+ */
+
+namespace {
+
+/** Float one-pole lowpass. */
+class FloatLowpass : public ms::Node {
+public:
+  explicit FloatLowpass(const std::string &id) : Node(id) {
+    addInputPort("in", ms::PortType::Audio);
+    addOutputPort("out", ms::PortType::Audio);
+  }
+
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) override {
+    for (int i = 0; i < nFrames; ++i) {
+      state_ += 0.1f * (inputs[0][i] - state_);
+      outputs[0][i] = state_;
+    }
+  }
+
+private:
+  float state_ = 0.0f;
+};
+
+/** Double one-pole lowpass. */
+class DoubleLowpass : public ms::DoubleNode {
+public:
+  explicit DoubleLowpass(const std::string &id) : DoubleNode(id) {
+    addInputPort("in", ms::PortType::Audio);
+    addOutputPort("out", ms::PortType::Audio);
+  }
+
+  void processDouble(const double *const *inputs, double **outputs,
+                     int nFrames) override {
+    for (int i = 0; i < nFrames; ++i) {
+      state_ += 0.1 * (inputs[0][i] - state_);
+      outputs[0][i] = state_;
+    }
+  }
+
+private:
+  double state_ = 0.0;
+};
+
+enum class Chain { Float, Double, Mixed };
+
+double nsPerNodeSample(Chain chain, int numNodes, int blockSize,
+                       int numBlocks) {
+  ms::GraphManager graph;
+  for (int i = 0; i < numNodes; ++i) {
+    const std::string id = "n" + std::to_string(i);
+    const bool useDouble =
+        chain == Chain::Double || (chain == Chain::Mixed && i % 2 == 1);
+    ms::NodePtr node;
+    if (useDouble) {
+      node = std::make_shared<DoubleLowpass>(id);
+    } else {
+      node = std::make_shared<FloatLowpass>(id);
+    }
+    node->setFadeInDuration(0.0f);
+    graph.createNode(id, node);
+    if (i > 0) {
+      graph.connect("n" + std::to_string(i - 1), "out", id, "in");
+    }
+  }
+  graph.prepare(48000, blockSize);
+  const double seconds = ms::bench::bestSeconds(
+      [&](int) { graph.process(blockSize); }, numBlocks);
+  return 1e9 * seconds /
+         (static_cast<double>(numBlocks) * numNodes * blockSize);
+}
+
+} // namespace
+
+int main() {
+  const int numNodes = 64;
+  const int numBlocks = 500;
+  std::printf("%d-node one-pole chain, ns per node per sample\n", numNodes);
+  std::printf("%8s %10s %10s %10s\n", "frames", "float", "double", "mixed");
+  for (int blockSize : {64, 256, 1024}) {
+    std::printf("%8d %10.3f %10.3f %10.3f\n", blockSize,
+                nsPerNodeSample(Chain::Float, numNodes, blockSize, numBlocks),
+                nsPerNodeSample(Chain::Double, numNodes, blockSize, numBlocks),
+                nsPerNodeSample(Chain::Mixed, numNodes, blockSize, numBlocks));
+  }
+  return 0;
+}
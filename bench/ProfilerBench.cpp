@@ -0,0 +1,82 @@
+#include "BenchTiming.hpp"
+#include "GraphManager.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+
+/**
+ * @file ProfilerBench.cpp
+ * @brief Measures the overhead of per-node profiling and prints a snapshot.
+ */
+
+namespace {
+
+/** One-pole lowpass standing in for a typical small DSP node. */
+class Lowpass : public ms::Node {
+public:
+  explicit Lowpass(const std::string &id) : Node(id) {
+    addInputPort("in", ms::PortType::Audio);
+    addOutputPort("out", ms::PortType::Audio);
+  }
+
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) override {
+    for (int i = 0; i < nFrames; ++i) {
+      state_ += 0.1f * (inputs[0][i] - state_);
+      outputs[0][i] = state_;
+    }
+  }
+
+private:
+  float state_ = 0.0f;
+};
+
+double usPerBlock(ms::GraphManager &graph, int blockSize, int numBlocks) {
+  const double seconds = ms::bench::bestSeconds(
+      [&](int) { graph.process(blockSize); }, numBlocks);
+  return 1e6 * seconds / numBlocks;
+}
+
+} // namespace
+
+int main() {
+  const int numNodes = 64;
+  const int numBlocks = 1000;
+  std::printf("%d-node chain, us per block\n", numNodes);
+  std::printf("%8s %10s %10s %10s %10s %10s\n", "frames", "off", "sampled",
+              "overhead", "every", "overhead");
+  for (int blockSize : {64, 256}) {
+    ms::GraphManager graph;
+    for (int i = 0; i < numNodes; ++i) {
+      const std::string id = "n" + std::to_string(i);
+      graph.createNode(id, std::make_shared<Lowpass>(id));
+      if (i > 0) {
+        graph.connect("n" + std::to_string(i - 1), "out", id, "in");
+      }
+    }
+    graph.prepare(48000, blockSize);
+
+    const double off = usPerBlock(graph, blockSize, numBlocks);
+    graph.setProfilingEnabled(true);
+    const double sampled = usPerBlock(graph, blockSize, numBlocks);
+    graph.setProfileInterval(1);
+    const double every = usPerBlock(graph, blockSize, numBlocks);
+    std::printf("%8d %10.2f %10.2f %9.1f%% %10.2f %9.1f%%\n", blockSize, off,
+                sampled, 100.0 * (sampled - off) / off, every,
+                100.0 * (every - off) / off);
+
+    if (blockSize == 256) {
+      const auto snapshot = graph.getProfileSnapshot();
+      std::printf("\n%-6s %10s %10s %10s %10s %10s\n", "node", "mean ns",
+                  "p50 ns", "p99 ns", "max ns", "calls");
+      for (size_t i = 0; i < snapshot.size() && i < 5; ++i) {
+        const auto &s = snapshot[i];
+        std::printf("%-6s %10.0f %10.0f %10.0f %10.0f %10llu\n",
+                    s.nodeId.c_str(), s.processMeanNs, s.processP50Ns,
+                    s.processP99Ns, s.processMaxNs,
+                    static_cast<unsigned long long>(s.processCalls));
+      }
+    }
+  }
+  return 0;
+}
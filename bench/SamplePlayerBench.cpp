@@ -0,0 +1,139 @@
+#include "Denormals.hpp"
+#include "SamplePlayerNode.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @file SamplePlayerBench.cpp
+ * @brief Measures SamplePlayerNode streaming cost and underruns.
+ *
+ * Writes a set of 16-bit stereo WAV files to a temporary directory, then
+ * plays a growing number of voices from them at several playback rates,
+ * paced in real time so that the I/O thread streams as it would behind a
+ * device. "audio" is the time spent in process() and "I/O" the CPU time of
+ * the I/O thread, as percentages of the audio rendered. The files were
+ * just written, so they sit in the page cache: this measures decoding and
+ * scheduling, not the disk.
+ */
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr int kNumFiles = 16;
+constexpr int kFileSeconds = 12;
+
+/** CPU time of the process, or of the calling thread, in seconds. */
+double cpuSeconds(clockid_t clock) {
+  timespec now;
+  clock_gettime(clock, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void writeWav(const std::string &path, int seed) {
+  const uint32_t frames = kFileSeconds * kSampleRate;
+  const uint32_t bytes = frames * 2 * sizeof(int16_t);
+  std::vector<int16_t> data(static_cast<size_t>(frames) * 2);
+  for (uint32_t i = 0; i < frames; ++i) {
+    const double x = std::sin(0.01 * (seed + 1) * i);
+    data[2 * i] = static_cast<int16_t>(12000 * x);
+    data[2 * i + 1] = static_cast<int16_t>(-12000 * x);
+  }
+  FILE *file = std::fopen(path.c_str(), "wb");
+  const uint32_t header[] = {0x46464952u, 36 + bytes, 0x45564157u,
+                             0x20746d66u, 16,         0x00020001u,
+                             kSampleRate, kSampleRate * 4, 0x00100004u,
+                             0x61746164u, bytes};
+  std::fwrite(header, sizeof(header), 1, file);
+  std::fwrite(data.data(), sizeof(int16_t), data.size(), file);
+  std::fclose(file);
+}
+
+} // namespace
+
+int main() {
+  const ms::ScopedFlushDenormals flushDenormals;
+  const int blockSize = 256;
+  const double seconds = 4.0;
+  const int numBlocks = static_cast<int>(seconds * kSampleRate / blockSize);
+
+  char directory[] = "/tmp/SamplePlayerBenchXXXXXX";
+  if (!mkdtemp(directory)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  std::vector<std::string> paths;
+  for (int f = 0; f < kNumFiles; ++f) {
+    paths.push_back(std::string(directory) + "/sample" + std::to_string(f) +
+                    ".wav");
+    writeWav(paths.back(), f);
+  }
+
+  std::printf("sample player, %d-frame blocks, %.0f s rendered per case\n",
+              blockSize, seconds);
+  std::printf("%6s %5s %10s %8s %9s %7s %10s\n", "voices", "rate",
+              "preload MB", "ring MB", "audio %", "I/O %", "underruns");
+
+  for (int voices : {16, 64, 256}) {
+    for (float rate : {1.0f, 4.0f}) {
+      ms::SamplePlayerNode node("player", 2, voices);
+      for (const std::string &path : paths) {
+        node.loadSample(path);
+      }
+      node.prepare(kSampleRate, blockSize);
+      node.setParam("rate", rate);
+
+      std::vector<std::vector<float>> out(2, std::vector<float>(blockSize));
+      float *outputs[] = {out[0].data(), out[1].data()};
+      // Start the voices one block apart, as notes would arrive.
+      std::vector<ms::Event> events(1);
+      const ms::Symbol play = ms::Symbol::intern("play");
+
+      const double processStart = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+      const double threadStart = cpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+      const auto begin = std::chrono::steady_clock::now();
+      const std::chrono::duration<double> period(
+          static_cast<double>(blockSize) / kSampleRate);
+      double audioSeconds = 0.0;
+      for (int b = 0; b < numBlocks; ++b) {
+        const auto start = std::chrono::steady_clock::now();
+        ms::EventSpan span;
+        if (b < voices) {
+          events[0] = ms::Event(play, ms::ControlValue(b % kNumFiles), 0);
+          span = ms::EventSpan(events.data(), 1);
+        }
+        node.processEvent(&span, nullptr);
+        node.process(nullptr, outputs, blockSize);
+        audioSeconds += std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+        std::this_thread::sleep_until(
+            begin + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        period * (b + 1)));
+      }
+      const double ioSeconds =
+          (cpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - processStart) -
+          (cpuSeconds(CLOCK_THREAD_CPUTIME_ID) - threadStart);
+
+      const ms::SamplePlayerStats stats = node.getStats();
+      std::printf("%6d %5.1f %10.1f %8.1f %9.2f %7.2f %10llu\n", voices, rate,
+                  static_cast<double>(stats.preloadBytes) / (1 << 20),
+                  static_cast<double>(stats.ringBytes) / (1 << 20),
+                  100.0 * audioSeconds / seconds, 100.0 * ioSeconds / seconds,
+                  static_cast<unsigned long long>(stats.underruns));
+    }
+  }
+
+  for (const std::string &path : paths) {
+    std::remove(path.c_str());
+  }
+  rmdir(directory);
+  return 0;
+}
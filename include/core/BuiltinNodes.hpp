@@ -0,0 +1,27 @@
+#pragma once
+#include "ConvolutionNode.hpp"
+#include "DelayNode.hpp"
+#include "FilterNode.hpp"
+#include "GainNode.hpp"
+#include "MixerNode.hpp"
+#include "OscillatorBankNode.hpp"
+#include "SamplePlayerNode.hpp"
+#include "StaticNode.hpp"
+#include "SumNode.hpp"
+
+/**
+ * @file BuiltinNodes.hpp
+ * @brief Lists the node types that ship with MilliSuono.
+ */
+
+namespace ms {
+
+/**
+ * @brief Built-in node types. Each is registered in the NodeRegistry under
+ * its kTypeName, and the GraphManager calls its processBlock() directly.
+ */
+using BuiltinNodeTypes =
+    NodeTypeList<ConvolutionNode, DelayNode, FilterNode, GainNode,
+                 MixerNode, OscillatorBankNode, SamplePlayerNode, SumNode>;
+
+} // namespace ms
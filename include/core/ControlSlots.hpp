@@ -0,0 +1,97 @@
+#pragma once
+#include "Port.hpp"
+
+/**
+ * @file ControlSlots.hpp
+ * @brief Indexed views over the control slots of a node.
+ *
+ * The GraphManager lays out the control inputs and outputs of every node as
+ * contiguous ControlSlot ranges when the plan is compiled. processControl()
+ * receives these views; ports are addressed by their index among the node's
+ * control ports, in declaration order.
+ */
+
+namespace ms {
+
+/**
+ * @brief Read-only view over a node's control input slots.
+ */
+class ControlInputs {
+public:
+  ControlInputs() = default;
+
+  /**
+   * @brief Constructs a view over size slots.
+   * @param slots Pointer to the first slot.
+   * @param size The number of control input ports.
+   */
+  ControlInputs(const ControlSlot *slots, int size)
+      : slots_(slots), size_(size) {}
+
+  /** @brief Returns the value of a Float port. */
+  float getFloat(int index) const { return slots_[index].f; }
+
+  /** @brief Returns the value of an Int port. */
+  int getInt(int index) const { return slots_[index].i; }
+
+  /** @brief Returns the value of a Bool port. */
+  bool getBool(int index) const { return slots_[index].i != 0; }
+
+  /** @brief Returns the raw slots. */
+  const ControlSlot *data() const { return slots_; }
+
+  /** @brief Returns the number of control input ports. */
+  int size() const { return size_; }
+
+private:
+  const ControlSlot *slots_ = nullptr;
+  int size_ = 0;
+};
+
+/**
+ * @brief Writable view over a node's control output slots.
+ *
+ * Output slots keep their value between blocks, so a node only needs to
+ * write the outputs that change.
+ */
+class ControlOutputs {
+public:
+  ControlOutputs() = default;
+
+  /**
+   * @brief Constructs a view over size slots.
+   * @param slots Pointer to the first slot.
+   * @param size The number of control output ports.
+   */
+  ControlOutputs(ControlSlot *slots, int size) : slots_(slots), size_(size) {}
+
+  /** @brief Sets the value of a Float port. */
+  void setFloat(int index, float value) { slots_[index].f = value; }
+
+  /** @brief Sets the value of an Int port. */
+  void setInt(int index, int value) { slots_[index].i = value; }
+
+  /** @brief Sets the value of a Bool port. */
+  void setBool(int index, bool value) { slots_[index].i = value ? 1 : 0; }
+
+  /** @brief Returns the current value of a Float port. */
+  float getFloat(int index) const { return slots_[index].f; }
+
+  /** @brief Returns the current value of an Int port. */
+  int getInt(int index) const { return slots_[index].i; }
+
+  /** @brief Returns the current value of a Bool port. */
+  bool getBool(int index) const { return slots_[index].i != 0; }
+
+  /** @brief Returns the raw slots. */
+  ControlSlot *data() const { return slots_; }
+
+  /** @brief Returns the number of control output ports. */
+  int size() const { return size_; }
+
+private:
+  ControlSlot *slots_ = nullptr;
+  int size_ = 0;
+};
+
+} // namespace ms
@@ -0,0 +1,184 @@
+#pragma once
+#include "Symbol.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @file ControlValue.hpp
+ * @brief Declares the fixed-size, allocation-free value carried by
+ * parameters, events and parameter changes.
+ */
+
+namespace ms {
+
+/**
+ * @brief Represents the value carried by a parameter, control or event.
+ *
+ * This can be one of the following:
+ * - float: for continuous parameters (e.g., gain, frequency)
+ * - int: for discrete parameters or indices
+ * - bool: for binary control signals (e.g., mute, toggle)
+ * - string: for symbolic or textual data
+ *
+ * A ControlValue is 16 bytes and trivially copyable, so copying one on the
+ * audio thread never allocates. Strings of up to kInlineCapacity bytes are
+ * stored inline; longer strings are interned as a Symbol when the value is
+ * constructed (which takes a lock, so build long strings off the audio
+ * thread).
+ */
+class ControlValue {
+public:
+  /** @brief The type of value held. */
+  enum class Type : uint8_t { Float, Int, Bool, String };
+
+  /** Longest string stored inline, in bytes. */
+  static constexpr size_t kInlineCapacity = 14;
+
+  /** @brief Constructs the float value 0. */
+  ControlValue() : ControlValue(0.0f) {}
+
+  ControlValue(float value) { setScalar(Type::Float, &value, sizeof(value)); }
+  ControlValue(double value) : ControlValue(static_cast<float>(value)) {}
+  ControlValue(int value) {
+    const int32_t v = value;
+    setScalar(Type::Int, &v, sizeof(v));
+  }
+  ControlValue(bool value) {
+    const uint8_t v = value ? 1 : 0;
+    setScalar(Type::Bool, &v, sizeof(v));
+  }
+  ControlValue(const char *value) : ControlValue(std::string_view(value)) {}
+  ControlValue(const std::string &value)
+      : ControlValue(std::string_view(value)) {}
+  ControlValue(std::string_view value);
+
+  /**
+   * @brief Constructs a string value from an already interned symbol.
+   * Never allocates.
+   */
+  ControlValue(Symbol symbol) {
+    const uint32_t id = symbol.id();
+    setScalar(Type::String, &id, sizeof(id));
+    length_ = kPooled;
+  }
+
+  /** @brief Returns the type of value held. */
+  Type type() const { return type_; }
+
+  bool isFloat() const { return type_ == Type::Float; }
+  bool isInt() const { return type_ == Type::Int; }
+  bool isBool() const { return type_ == Type::Bool; }
+  bool isString() const { return type_ == Type::String; }
+
+  /** @brief Returns the value as float (ints and bools are converted). */
+  float asFloat() const {
+    switch (type_) {
+    case Type::Float:
+      return load<float>();
+    case Type::Int:
+      return static_cast<float>(load<int32_t>());
+    case Type::Bool:
+      return data_[0] ? 1.0f : 0.0f;
+    default:
+      return 0.0f;
+    }
+  }
+
+  /** @brief Returns the value as int (floats are truncated). */
+  int asInt() const {
+    switch (type_) {
+    case Type::Float:
+      return static_cast<int>(load<float>());
+    case Type::Int:
+      return load<int32_t>();
+    case Type::Bool:
+      return data_[0] ? 1 : 0;
+    default:
+      return 0;
+    }
+  }
+
+  /** @brief Returns the value as bool (non-zero numbers are true). */
+  bool asBool() const {
+    switch (type_) {
+    case Type::Float:
+      return load<float>() != 0.0f;
+    case Type::Int:
+      return load<int32_t>() != 0;
+    case Type::Bool:
+      return data_[0] != 0;
+    default:
+      return false;
+    }
+  }
+
+  /**
+   * @brief Returns the text of a string value (empty for other types).
+   * The view is valid as long as this ControlValue (inline strings) or
+   * forever (interned strings).
+   */
+  std::string_view asString() const {
+    if (type_ != Type::String) {
+      return {};
+    }
+    if (length_ == kPooled) {
+      return Symbol::fromId(load<uint32_t>()).str();
+    }
+    return std::string_view(data_, length_);
+  }
+
+  bool operator==(const ControlValue &other) const {
+    if (type_ != other.type_) {
+      return false;
+    }
+    if (type_ == Type::String) {
+      return asString() == other.asString();
+    }
+    return std::memcmp(data_, other.data_, sizeof(data_)) == 0;
+  }
+  bool operator!=(const ControlValue &other) const { return !(*this == other); }
+
+private:
+  /** length_ value marking a string stored as a Symbol id. */
+  static constexpr uint8_t kPooled = 0xFF;
+
+  void setScalar(Type type, const void *bytes, size_t size) {
+    std::memset(data_, 0, sizeof(data_));
+    std::memcpy(data_, bytes, size);
+    length_ = 0;
+    type_ = type;
+  }
+
+  template <typename T> T load() const {
+    T value;
+    std::memcpy(&value, data_, sizeof(T));
+    return value;
+  }
+
+  /** Inline payload: scalar bytes, inline string, or a Symbol id. */
+  char data_[kInlineCapacity];
+  /** Length of an inline string, or kPooled. */
+  uint8_t length_;
+  /** The type of value held. */
+  Type type_;
+};
+
+static_assert(sizeof(ControlValue) == 16, "ControlValue must stay 16 bytes");
+static_assert(std::is_trivially_copyable<ControlValue>::value,
+              "ControlValue must be trivially copyable");
+
+inline ControlValue::ControlValue(std::string_view value) {
+  if (value.size() <= kInlineCapacity) {
+    std::memset(data_, 0, sizeof(data_));
+    std::memcpy(data_, value.data(), value.size());
+    length_ = static_cast<uint8_t>(value.size());
+    type_ = Type::String;
+  } else {
+    *this = ControlValue(Symbol::intern(value));
+  }
+}
+
+} // namespace ms
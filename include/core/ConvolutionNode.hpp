@@ -0,0 +1,174 @@
+#pragma once
+#include "MpscQueue.hpp"
+#include "StaticNode.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file ConvolutionNode.hpp
+ * @brief Declares the built-in partitioned convolution (reverb) node.
+ */
+
+namespace ms {
+
+/**
+ * @brief Memory and scheduling figures of a ConvolutionNode.
+ */
+struct ConvolutionStats {
+  /** Length of the current impulse response, in samples (0 if none). */
+  int impulseLength = 0;
+  /** Bytes held by the current impulse response's kernel and state. */
+  size_t memoryBytes = 0;
+  /**
+   * Background partitions that missed their deadline: the audio thread
+   * either ran them itself or, when the worker was still on them, played
+   * that part of the response silent until the worker caught up.
+   */
+  uint64_t lateTasks = 0;
+};
+
+/**
+ * @brief Convolves its inputs with an impulse response, without latency.
+ *
+ * The impulse response is split into non-uniform partitions:
+ * - the first headSize taps run as a direct-form FIR, so the output has
+ *   no latency whatever the host block size;
+ * - the next 15 * headSize taps run as a uniformly partitioned
+ *   overlap-save convolution with headSize partitions, on the audio thread;
+ * - the rest runs in segments whose partitions grow eightfold up to 16384
+ *   samples. A segment of partition P starts at tap 2P, so its FFTs for
+ *   one period of P samples can run on a background worker while the
+ *   next period plays. If the worker has not started a partition by its
+ *   deadline, the audio thread runs it itself; if the worker is still
+ *   running it, the audio thread never waits: that segment is silent
+ *   until the worker catches up. getStats() counts both. When rendering
+ *   faster than real time, setSynchronous() runs them all on the calling
+ *   thread instead.
+ * Each segment transforms every input once and every output once per
+ * period; kernel spectra are multiplied in through a frequency-domain
+ * delay line, so true-stereo responses cost four products, not four
+ * convolutions.
+ *
+ * setImpulseResponse() partitions and transforms the response and starts
+ * its worker on the calling thread. The audio thread picks the new
+ * response up at its next block with an atomic exchange and crossfades
+ * from the old one; old responses are freed by the next call to
+ * setImpulseResponse(), prepare() or the destructor, never on the audio
+ * thread. The tail reported to the graph follows the response as soon as
+ * the audio thread picks it up.
+ *
+ * Ports: audio inputs "in0" ... "in<I-1>", audio outputs "out0" ...
+ * "out<O-1>". Parameters: "wet" and "dry" (linear gains, smoothed).
+ */
+class ConvolutionNode : public StaticNode<ConvolutionNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "convolution";
+
+  /** Default length of the direct-form head, in samples. */
+  static constexpr int kDefaultHeadSize = 64;
+
+  /** Largest partition, in samples. */
+  static constexpr int kMaxPartition = 16384;
+
+  /** Crossfade between impulse responses, in milliseconds. */
+  static constexpr float kSwapFadeMs = 50.0f;
+
+  /**
+   * @brief Constructs a node without an impulse response; it outputs the
+   * dry signal only until setImpulseResponse() is called.
+   * @param id The unique string identifier for the Node.
+   * @param numInputs The number of input channels (at least 1).
+   * @param numOutputs The number of output channels (at least 1).
+   * @param headSize Length of the direct-form head, rounded up to a power
+   * of two between 16 and 1024. Shorter heads cost less per sample but
+   * run more partitions on the audio thread.
+   */
+  explicit ConvolutionNode(const std::string &id, int numInputs = 1,
+                           int numOutputs = 1,
+                           int headSize = kDefaultHeadSize);
+  ~ConvolutionNode() override;
+
+  ConvolutionNode(const ConvolutionNode &) = delete;
+  ConvolutionNode &operator=(const ConvolutionNode &) = delete;
+
+  /** @brief Returns the number of input channels. */
+  int getNumInputs() const { return numInputs_; }
+
+  /** @brief Returns the number of output channels. */
+  int getNumOutputs() const { return numOutputs_; }
+
+  /**
+   * @brief Loads an impulse response, at the graph's sample rate. Call from
+   * one control thread at a time, never from the audio thread.
+   * @param channels Either one response per output, output o convolving
+   * input o % numInputs, or numInputs * numOutputs responses (true
+   * stereo), channels[i * numOutputs + o] leading from input i to output o.
+   * @return False if the number of channels fits neither layout or every
+   * channel is empty.
+   */
+  bool setImpulseResponse(const std::vector<std::vector<float>> &channels);
+
+  /** @brief Returns the current figures. Safe to call from any thread. */
+  ConvolutionStats getStats() const;
+
+  /**
+   * @brief Runs the background partitions on the thread that processes
+   * the node rather than on the worker. For offline rendering, which runs
+   * faster than real time and would miss every worker deadline; the
+   * output is then exact at any speed. Safe to call from any thread.
+   * @param synchronous True to run every partition on the calling thread.
+   */
+  void setSynchronous(bool synchronous) {
+    synchronous_.store(synchronous, std::memory_order_relaxed);
+  }
+
+  void prepare(int sampleRate, int blockSize) override;
+
+  /** @brief Convolves the block. */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    render(inputs, outputs, nFrames);
+  }
+
+private:
+  /** A partitioned impulse response with its state and worker. */
+  class Instance;
+
+  /** Swaps in a pending response, convolves and mixes the block. */
+  void render(const float *const *inputs, float **outputs, int nFrames);
+
+  /** Frees the instances the audio thread has retired. */
+  void collectRetired();
+
+  int numInputs_;
+  int numOutputs_;
+  int headSize_;
+  ParamHandle wet_;
+  ParamHandle dry_;
+
+  /** Published by setImpulseResponse(), taken by the audio thread. */
+  std::atomic<Instance *> pending_{nullptr};
+  /** The response being played, and the one fading out. Audio thread. */
+  Instance *current_ = nullptr;
+  Instance *fading_ = nullptr;
+  /** Frames of the crossfade done, and its length. Audio thread. */
+  int fadePosition_ = 0;
+  int fadeLength_ = 0;
+  /** Instances the audio thread is done with. */
+  MpscQueue<Instance *> retired_{8};
+
+  std::atomic<int> impulseLength_{0};
+  std::atomic<size_t> memoryBytes_{0};
+  std::atomic<uint64_t> lateTasks_{0};
+  std::atomic<bool> synchronous_{false};
+
+  /** Output of the fading response, numOutputs * blockSize. */
+  std::vector<float> fadeBuffer_;
+  std::vector<float *> fadeOutputs_;
+};
+
+} // namespace ms
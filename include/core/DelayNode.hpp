@@ -0,0 +1,127 @@
+#pragma once
+#include "MirroredRingBuffer.hpp"
+#include "StaticNode.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @file DelayNode.hpp
+ * @brief Declares the built-in modulated delay line node.
+ */
+
+namespace ms {
+
+/**
+ * @brief How a DelayNode reads between samples.
+ *
+ * Linear is cheapest and dulls highs slightly at fractional delays. Cubic
+ * (4-point Hermite) keeps more of the top octave when modulated. AllPass
+ * (first order) has a flat magnitude response, suiting slowly varying or
+ * fixed fractional delays such as tuned comb filters; fast modulation
+ * makes it ring.
+ */
+enum class DelayInterpolation { Linear, Cubic, AllPass };
+
+/**
+ * @brief Delays any number of channels by a fractional, modulatable time,
+ * with feedback and a dry/wet mix.
+ *
+ * Each channel writes into a MirroredRingBuffer sized in prepare() for
+ * the maximum delay plus one block. Because the ring appears twice in a
+ * row in memory, every block's taps are read from one contiguous window:
+ * there is no modulo or wrap test per sample, and a fixed delay reads
+ * four frames per SIMD load.
+ *
+ * The delay is the "time" parameter plus the "mod" input, both in
+ * milliseconds, so an oscillator into "mod" makes a chorus, flanger or
+ * vibrato. It is clamped to [kMinDelayFrames, maximum delay]. Feedback
+ * is applied sample-accurately: when the delay is shorter than the block,
+ * the block is processed in runs no longer than the delay.
+ *
+ * Ports: audio inputs "in0" ... "in<N-1>" and "mod", audio outputs
+ * "out0" ... "out<N-1>". Parameters: "time" (ms, smoothed), "feedback"
+ * (-kMaxFeedback to kMaxFeedback, smoothed), "mix" (0 dry to 1 wet,
+ * smoothed, default 1) and "interpolation" (Int, DelayInterpolation). The
+ * tail covers the echoes down to -80 dB and follows "feedback" from the
+ * block it changes in; when it shrinks, the previous tail is kept until
+ * the echoes already in the line have had that long to fade, so a graph
+ * never sleeps the node between echoes.
+ */
+class DelayNode : public StaticNode<DelayNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "delay";
+
+  /** Shortest delay, in frames; cubic reads one frame ahead of the tap. */
+  static constexpr float kMinDelayFrames = 2.0f;
+
+  /** Largest feedback magnitude. */
+  static constexpr float kMaxFeedback = 0.99f;
+
+  /**
+   * @brief Constructs a delay.
+   * @param id The unique string identifier for the Node.
+   * @param numChannels The number of channels (at least 1).
+   * @param maxDelayMs The longest delay "time" plus "mod" can reach.
+   * @param interpolation The initial value of the "interpolation"
+   * parameter.
+   */
+  explicit DelayNode(const std::string &id, int numChannels = 1,
+                     float maxDelayMs = 1000.0f,
+                     DelayInterpolation interpolation =
+                         DelayInterpolation::Linear);
+
+  /** @brief Returns the number of channels. */
+  int getNumChannels() const { return numChannels_; }
+
+  /** @brief Returns the longest delay, in milliseconds. */
+  float getMaxDelayMs() const { return maxDelayMs_; }
+
+  void prepare(int sampleRate, int blockSize) override;
+
+  /** @brief Clears the delay lines. */
+  void reset();
+
+  /** @brief Delays the block. */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    render(inputs, outputs, nFrames);
+  }
+
+private:
+  /** Reads the parameters and delays the block. */
+  void render(const float *const *inputs, float **outputs, int nFrames);
+
+  /** Declares the tail for a feedback gain. */
+  void updateTail(float feedback);
+
+  int numChannels_;
+  float maxDelayMs_;
+  ParamHandle time_;
+  ParamHandle feedback_;
+  ParamHandle mix_;
+  ParamHandle interpolation_;
+
+  /** One ring per channel. */
+  std::vector<MirroredRingBuffer> lines_;
+  /** Ring index the next block is written at, in [0, capacity). */
+  size_t writePosition_ = 0;
+  /** Longest delay, in frames. */
+  float maxDelayFrames_ = 0.0f;
+  /**
+   * Frames before the write position the taps can reach: the longest
+   * delay and the two frames past it that cubic reads.
+   */
+  size_t reach_ = 0;
+
+  /** The block's delay per frame, in frames. */
+  std::vector<float> delays_;
+  /** Last output of each channel's allpass interpolator. */
+  std::vector<float> allPassState_;
+  DelayInterpolation cachedInterpolation_;
+  float cachedFeedback_ = 0.0f;
+  /** Frames the previous, longer tail is still declared for. */
+  int tailHoldFrames_ = 0;
+};
+
+} // namespace ms
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MS_DENORMALS_SSE 1
+#include <xmmintrin.h>
+#elif (defined(__aarch64__) || defined(__arm__)) &&                            \
+    (defined(__GNUC__) || defined(__clang__))
+#define MS_DENORMALS_ARM 1
+#endif
+
+/**
+ * @file Denormals.hpp
+ * @brief Control of the floating-point denormal mode, and detection of
+ * subnormal and non-finite samples.
+ *
+ * Filters and reverbs decaying towards silence produce subnormal numbers,
+ * which most CPUs process an order of magnitude or two slower than normal
+ * ones. Audio code therefore runs with flush-to-zero (FTZ) and
+ * denormals-are-zero (DAZ) set; the mode is per thread, so every thread
+ * that runs DSP code has to set it.
+ */
+
+namespace ms {
+
+/**
+ * @brief Sets flush-to-zero and denormals-are-zero on the calling thread for
+ * the lifetime of the object and restores the previous mode on destruction.
+ *
+ * Used around every GraphManager block and meant to be placed at the top of
+ * any worker thread that processes audio. On ARM there is no separate DAZ
+ * switch: FZ covers both inputs and outputs. Does nothing on other targets.
+ */
+class ScopedFlushDenormals {
+public:
+  /**
+   * @param enable False to leave the current mode untouched (e.g. to let
+   * denormals through while hunting for the node that produces them).
+   */
+  explicit ScopedFlushDenormals(bool enable = true) : enabled_(enable) {
+    if (!enabled_) {
+      return;
+    }
+    saved_ = readMode();
+    writeMode(saved_ | kFlushBits);
+  }
+
+  ~ScopedFlushDenormals() {
+    if (enabled_) {
+      writeMode(saved_);
+    }
+  }
+
+  ScopedFlushDenormals(const ScopedFlushDenormals &) = delete;
+  ScopedFlushDenormals &operator=(const ScopedFlushDenormals &) = delete;
+
+  /** @brief Returns true if FTZ is set on the calling thread. */
+  static bool isFlushing() { return (readMode() & kFlushBits) == kFlushBits; }
+
+private:
+#if MS_DENORMALS_SSE
+  /** MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6). */
+  static constexpr uint64_t kFlushBits = 0x8040;
+#elif MS_DENORMALS_ARM
+  /** FPCR / FPSCR flush-to-zero (bit 24). */
+  static constexpr uint64_t kFlushBits = uint64_t(1) << 24;
+#else
+  static constexpr uint64_t kFlushBits = 0;
+#endif
+
+  static uint64_t readMode() {
+#if MS_DENORMALS_SSE
+    return _mm_getcsr();
+#elif MS_DENORMALS_ARM && defined(__aarch64__)
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    return fpcr;
+#elif MS_DENORMALS_ARM
+    uint32_t fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    return fpscr;
+#else
+    return 0;
+#endif
+  }
+
+  static void writeMode(uint64_t mode) {
+#if MS_DENORMALS_SSE
+    _mm_setcsr(static_cast<unsigned int>(mode));
+#elif MS_DENORMALS_ARM && defined(__aarch64__)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(mode));
+#elif MS_DENORMALS_ARM
+    const uint32_t fpscr = static_cast<uint32_t>(mode);
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr));
+#else
+    (void)mode;
+#endif
+  }
+
+  uint64_t saved_ = 0;
+  bool enabled_;
+};
+
+/**
+ * @brief Number of suspicious samples found by scanSamples().
+ */
+struct SampleFaults {
+  /** Subnormal samples (non-zero values below the normal range). */
+  uint64_t subnormal = 0;
+  /** NaN and infinite samples. */
+  uint64_t nonFinite = 0;
+
+  SampleFaults &operator+=(const SampleFaults &other) {
+    subnormal += other.subnormal;
+    nonFinite += other.nonFinite;
+    return *this;
+  }
+
+  /** @brief Returns true if any suspicious sample was found. */
+  bool any() const { return subnormal != 0 || nonFinite != 0; }
+};
+
+/**
+ * @brief Counts the subnormal and non-finite samples of a buffer.
+ * Classifies samples by their bit patterns, so the result does not depend
+ * on the current denormal mode.
+ * @param samples The samples.
+ * @param count The number of samples.
+ */
+SampleFaults scanSamples(const float *samples, int count);
+
+/** @copydoc scanSamples(const float *, int) */
+SampleFaults scanSamples(const double *samples, int count);
+
+} // namespace ms
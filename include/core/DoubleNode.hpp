@@ -0,0 +1,56 @@
+#pragma once
+#include "Node.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @file DoubleNode.hpp
+ * @brief Declares the base class for nodes that process in double precision.
+ */
+
+namespace ms {
+
+/**
+ * @brief Base class for nodes whose audio runs in double precision.
+ *
+ * Subclasses implement processDouble() instead of process(). Inside a graph
+ * the GraphManager gives the node double buffers and inserts conversions
+ * where it connects to float nodes: float sources are widened once after
+ * they run, and every output also keeps a float copy for float consumers,
+ * device output and getNodeOutput(). Chains of DoubleNodes pass double
+ * buffers directly.
+ */
+class DoubleNode : public Node {
+public:
+  /**
+   * @brief Constructs a double-precision node.
+   * @param id The unique string identifier for the Node.
+   */
+  explicit DoubleNode(const std::string &id) : Node(id) {
+    sampleType_ = SampleType::Float64;
+  }
+
+  /**
+   * @brief Processes audio in double precision.
+   * @param inputs An array of input audio buffers.
+   * @param outputs An array of output audio buffers.
+   * @param nFrames The number of frames to process.
+   */
+  virtual void processDouble(const double *const *inputs, double **outputs,
+                             int nFrames) = 0;
+
+  /**
+   * @brief Converts to double, calls processDouble() and converts back.
+   * Only used when the node is driven outside a GraphManager; scratch
+   * buffers are allocated on the first call.
+   */
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) final;
+
+private:
+  std::vector<std::vector<double>> scratch_;
+  std::vector<const double *> scratchInputs_;
+  std::vector<double *> scratchOutputs_;
+};
+
+} // namespace ms
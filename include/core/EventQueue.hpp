@@ -0,0 +1,87 @@
+#pragma once
+#include "Port.hpp"
+#include "Span.hpp"
+#include <cstddef>
+
+/**
+ * @file EventQueue.hpp
+ * @brief Fixed-capacity, sample-ordered event queues for event ports.
+ */
+
+namespace ms {
+
+/**
+ * @brief Read-only view over the events delivered to an event input port,
+ * ordered by sampleOffset.
+ */
+using EventSpan = Span<const Event>;
+
+/**
+ * @brief Fixed-capacity queue of events kept sorted by sampleOffset.
+ *
+ * A queue does not own its storage: the GraphManager carves all queues out
+ * of a single event arena when the plan is compiled, so pushing never
+ * allocates and clearing a queue at the start of a block is O(1). Events
+ * with equal offsets keep their push order. Events pushed past capacity are
+ * dropped and counted.
+ */
+class EventQueue {
+public:
+  /**
+   * @brief Attaches the queue to a region of the event arena and clears it.
+   * @param storage Pointer to capacity preallocated Event slots.
+   * @param capacity The number of slots.
+   */
+  void bind(Event *storage, size_t capacity) {
+    data_ = storage;
+    capacity_ = capacity;
+    size_ = 0;
+  }
+
+  /** @brief Removes all events (O(1); slots are reused in place). */
+  void clear() { size_ = 0; }
+
+  /**
+   * @brief Inserts an event in sampleOffset order.
+   * In-order pushes cost O(1); an out-of-order event is shifted into place.
+   * @param event The event to insert.
+   * @return False if the queue is full and the event was dropped.
+   */
+  bool push(const Event &event) {
+    if (size_ == capacity_) {
+      ++dropped_;
+      return false;
+    }
+    size_t i = size_;
+    while (i > 0 && data_[i - 1].sampleOffset > event.sampleOffset) {
+      data_[i] = data_[i - 1];
+      --i;
+    }
+    data_[i] = event;
+    ++size_;
+    return true;
+  }
+
+  /** @brief Returns the queued events in sampleOffset order. */
+  EventSpan events() const { return EventSpan(data_, size_); }
+
+  /** @brief Returns the number of queued events. */
+  size_t size() const { return size_; }
+
+  /** @brief Returns true if no events are queued. */
+  bool empty() const { return size_ == 0; }
+
+  /** @brief Returns the maximum number of events per block. */
+  size_t capacity() const { return capacity_; }
+
+  /** @brief Returns the number of events dropped because of capacity. */
+  size_t dropped() const { return dropped_; }
+
+private:
+  Event *data_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  size_t dropped_ = 0;
+};
+
+} // namespace ms
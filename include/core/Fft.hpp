@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * @file Fft.hpp
+ * @brief Declares the real-input FFT used for fast convolution.
+ */
+
+namespace ms {
+
+/**
+ * @brief Power-of-two FFT of real signals.
+ *
+ * A real transform of size N runs as a complex transform of N / 2 points
+ * over the even and odd samples, followed by a split step that separates
+ * their spectra. The complex transform is a radix-2 Stockham FFT: every
+ * stage reads one buffer and writes the other in natural order, so there
+ * is no bit reversal, and every stage runs four butterflies per vector.
+ *
+ * Spectra are split into real and imaginary arrays of N / 2 bins. Bin 0
+ * and the Nyquist bin are both real, so re[0] holds bin 0 and im[0] holds
+ * the Nyquist bin. inverse() is unscaled: forward() followed by inverse()
+ * multiplies the signal by N.
+ *
+ * Twiddle tables and scratch are allocated in the constructor; forward()
+ * and inverse() never allocate. An RealFft must not be used by two threads
+ * at once.
+ */
+class RealFft {
+public:
+  /** Smallest supported size. */
+  static constexpr int kMinSize = 16;
+
+  /**
+   * @brief Constructs a transform.
+   * @param size The number of real samples; rounded up to a power of two
+   * of at least kMinSize.
+   */
+  explicit RealFft(int size);
+
+  /** @brief Returns the number of real samples per transform. */
+  int getSize() const { return size_; }
+
+  /** @brief Returns the bytes held by twiddle tables and scratch. */
+  size_t getMemoryBytes() const;
+
+  /**
+   * @brief Transforms getSize() real samples.
+   * @param input The samples.
+   * @param re Receives getSize() / 2 real parts.
+   * @param im Receives getSize() / 2 imaginary parts (im[0]: Nyquist).
+   */
+  void forward(const float *input, float *re, float *im);
+
+  /**
+   * @brief Transforms a spectrum back, multiplied by getSize().
+   * @param re getSize() / 2 real parts.
+   * @param im getSize() / 2 imaginary parts (im[0]: Nyquist).
+   * @param output Receives getSize() samples.
+   */
+  void inverse(const float *re, const float *im, float *output);
+
+private:
+  /**
+   * Complex FFT of half_ points. (re, im) hold the input and (otherRe,
+   * otherIm) are scratch; on return the pointers are swapped as needed so
+   * that (re, im) hold the result.
+   */
+  void transform(float *&re, float *&im, float *&otherRe, float *&otherIm);
+
+  int size_;
+  int half_;
+  /** exp(-2 pi i j / half_) for j < half_ / 2. */
+  std::vector<float> twiddleRe_;
+  std::vector<float> twiddleIm_;
+  /** The stride-2 twiddles of the second stage, each repeated twice. */
+  std::vector<float> pairedRe_;
+  std::vector<float> pairedIm_;
+  /** cos and -sin of 2 pi k / size_ for the split step, k < half_. */
+  std::vector<float> splitRe_;
+  std::vector<float> splitIm_;
+  /** Two complex buffers of half_ + 1 points. */
+  std::vector<float> bufferRe_[2];
+  std::vector<float> bufferIm_[2];
+};
+
+} // namespace ms
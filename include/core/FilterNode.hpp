@@ -0,0 +1,202 @@
+#pragma once
+#include "StaticNode.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @file FilterNode.hpp
+ * @brief Declares the built-in multichannel state-variable filter node.
+ */
+
+namespace ms {
+
+/**
+ * @brief Response of a FilterNode.
+ */
+enum class FilterMode { LowPass, HighPass, BandPass, Notch, AllPass };
+
+/**
+ * @brief Filters any number of channels through a cascade of
+ * state-variable filter sections.
+ *
+ * Each section is a topology-preserving-transform (trapezoidal) SVF, which
+ * stays stable and free of zipper noise under fast cutoff modulation. A
+ * cascade of n sections gives a response of order 2n whose section
+ * resonances follow a Butterworth layout, scaled so that q = 0.7071 is
+ * maximally flat.
+ *
+ * Channels are processed four per SIMD vector. When there are fewer
+ * channels than sections, each channel instead runs its sections in the
+ * lanes as a pipeline: lane s filters the sample that lane s - 1 filtered
+ * one step earlier. The pipeline is filled and drained within each block
+ * with masked state updates, so it adds no latency.
+ *
+ * Coefficients are cached and only recomputed when a parameter changes.
+ * While "cutoff" or "q" ramps, per-sample coefficients are computed for
+ * the whole block first, four samples per vector with a rational tan()
+ * approximation, so modulation costs one extra pass per block rather than
+ * a tan() per sample.
+ *
+ * FilterNodes at the same level of a graph are processed in one
+ * processBatch() call, which runs steady mono filters four to a vector.
+ *
+ * Ports: audio inputs "in0" ... "in<N-1>", audio outputs "out0" ...
+ * "out<N-1>". Parameters: "cutoff" (Hz, smoothed), "q" (smoothed) and
+ * "mode" (Int, FilterMode).
+ */
+class FilterNode : public StaticNode<FilterNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "filter";
+
+  /** Largest number of cascaded sections. */
+  static constexpr int kMaxSections = 8;
+
+  /**
+   * @brief Constructs a filter.
+   * @param id The unique string identifier for the Node.
+   * @param numChannels The number of channels (at least 1).
+   * @param numSections The number of cascaded sections, 1 to kMaxSections.
+   * @param mode The initial value of the "mode" parameter.
+   */
+  explicit FilterNode(const std::string &id, int numChannels = 1,
+                      int numSections = 1,
+                      FilterMode mode = FilterMode::LowPass);
+
+  /** @brief Returns the number of channels. */
+  int getNumChannels() const { return numChannels_; }
+
+  /** @brief Returns the number of cascaded sections. */
+  int getNumSections() const { return numSections_; }
+
+  void prepare(int sampleRate, int blockSize) override;
+
+  /** @brief Clears the filter state. */
+  void reset();
+
+  /** @brief Filters the block. */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    render(inputs, outputs, nFrames);
+  }
+
+  /**
+   * @brief Filters several FilterNodes in one call (see
+   * Node::setBatchProcess()). Mono filters whose cutoff and q are steady
+   * run four per SIMD vector, one filter per lane, grouped by cascade
+   * length; the others filter on their own.
+   */
+  static void processBatch(Node *const *nodes, int count,
+                           const float *const *const *inputs,
+                           float **const *outputs, int nFrames);
+
+private:
+  /**
+   * Coefficients of one section: a1 ... a3 update the state, m0 ... m2 mix
+   * the input, band and low outputs into the selected response.
+   */
+  struct Coefficients {
+    float a1, a2, a3, m0, m1, m2;
+  };
+
+  /** Number of floats per section in modulatedCoefficients_. */
+  static constexpr int kCoefficientCount = 6;
+
+  /** Reads the parameters and filters the block. */
+  void render(const float *const *inputs, float **outputs, int nFrames);
+
+  /** Returns the "mode" parameter as a valid FilterMode. */
+  FilterMode currentMode() const;
+
+  /** Recomputes coefficients_ if cutoff, q or mode changed. */
+  void updateCoefficients(float cutoff, float q, FilterMode mode);
+
+  /**
+   * Updates coefficients_ and returns true if cutoff and q are steady, so
+   * the block runs with fixed coefficients.
+   */
+  bool updateFixedCoefficients();
+
+  /** Fills modulatedCoefficients_ for per-sample cutoff and q values. */
+  void computeModulatedCoefficients(const float *cutoff, const float *q,
+                                    int nFrames, FilterMode mode);
+
+  /** Fills skewedCoefficients_ for per-sample cutoff and q values. */
+  void computeSkewedCoefficients(const float *cutoff, const float *q,
+                                 int nFrames, FilterMode mode);
+
+  /**
+   * Runs the cascade with channels in lanes; Modulated reads
+   * modulatedCoefficients_.
+   */
+  template <bool Modulated>
+  void filterChannels(const float *const *inputs, float **outputs,
+                      int nFrames);
+
+  /** Runs the cascade with sections in lanes, one channel at a time. */
+  template <bool Modulated>
+  void filterSections(const float *const *inputs, float **outputs,
+                      int nFrames);
+
+  /**
+   * Runs up to four steady mono filters with the same number of sections,
+   * one filter per lane.
+   */
+  static void filterNodes(FilterNode *const *nodes,
+                          const float *const *inputs,
+                          float *const *outputs, int count, int nFrames);
+
+  /** Returns the index of an integrator state in state_. */
+  size_t stateIndex(int channel, int section, int which) const {
+    const size_t group = static_cast<size_t>(channel / 4);
+    return ((group * numSections_ + section) * 2 + which) * 4 + channel % 4;
+  }
+
+  int numChannels_;
+  int numSections_;
+  /** True when sections, rather than channels, are run in lanes. */
+  bool sectionsInLanes_;
+  ParamHandle cutoff_;
+  ParamHandle q_;
+  ParamHandle mode_;
+
+  /** Resonance of each section relative to q (Butterworth layout). */
+  float sectionQ_[kMaxSections] = {};
+
+  /** Cached coefficients and the parameters they were computed for. */
+  Coefficients coefficients_[kMaxSections] = {};
+  float cachedCutoff_ = -1.0f;
+  float cachedQ_ = -1.0f;
+  FilterMode cachedMode_ = FilterMode::LowPass;
+  int cachedSampleRate_ = 0;
+
+  /**
+   * Per-sample coefficients while modulated:
+   * [(section * kCoefficientCount + coefficient) * blockSize + frame].
+   */
+  std::vector<float> modulatedCoefficients_;
+
+  /**
+   * The same when sections run in lanes, skewed so that one load fetches
+   * the coefficients of section base + l at frame j - l for all lanes:
+   * [((pass * kCoefficientCount + coefficient) * (blockSize + 3) + j) * 4
+   * + l], with pass = section / 4.
+   */
+  std::vector<float> skewedCoefficients_;
+
+  /** Cutoff and q ramps padded by three frames on each side. */
+  std::vector<float> paddedCutoff_;
+  std::vector<float> paddedQ_;
+
+  /**
+   * Two integrator states per section and channel, grouped by four
+   * channels: [((group * numSections + section) * 2 + state) * 4 + lane].
+   */
+  std::vector<float> state_;
+
+  /** Silence read by, and scratch written by, unused lanes. */
+  std::vector<float> silence_;
+  std::vector<float> scratch_;
+};
+
+} // namespace ms
@@ -0,0 +1,103 @@
+#pragma once
+
+/**
+ * @file GainEnvelope.hpp
+ * @brief Declares the vectorized fade envelope applied to node outputs.
+ */
+
+namespace ms {
+
+/**
+ * @brief Shape of a fade.
+ *
+ * - Linear: gain proportional to time.
+ * - EqualPower: quarter sine, keeps summed power constant in crossfades.
+ * - Exponential: normalized exponential (about 60 dB of curvature), which
+ *   sounds even on level changes.
+ */
+enum class FadeCurve { Linear, EqualPower, Exponential };
+
+/**
+ * @brief Fade-in / fade-out gain envelope for multichannel buffers.
+ *
+ * The envelope advances once per apply() call regardless of the number of
+ * channels. Gains are generated with SIMD recurrences that are re-anchored
+ * to the exact curve every tile, so the per-sample cost is one multiply (or
+ * one multiply-add when crossfading with a dry signal) and nothing at all
+ * once the fade has finished.
+ */
+class GainEnvelope {
+public:
+  /**
+   * @brief Starts a fade from silence to unity gain.
+   * @param lengthSamples The fade length in samples (0 = no fade).
+   * @param curve The fade shape.
+   */
+  void startFadeIn(int lengthSamples, FadeCurve curve);
+
+  /**
+   * @brief Starts a fade from unity gain to silence.
+   * @param lengthSamples The fade length in samples (0 = cut immediately).
+   * @param curve The fade shape.
+   */
+  void startFadeOut(int lengthSamples, FadeCurve curve);
+
+  /** @brief Stops any fade and returns to unity gain. */
+  void reset() { state_ = State::Idle; }
+
+  /** @brief Returns true while a fade is running or the output is silent. */
+  bool isActive() const { return state_ != State::Idle; }
+
+  /** @brief Returns true once a fade-out has completed. */
+  bool isSilent() const { return state_ == State::Silent; }
+
+  /** @brief Returns true while fading out or silent after a fade-out. */
+  bool isFadingOut() const { return state_ != State::Idle && fadingOut_; }
+
+  /**
+   * @brief Applies the envelope in place to several channels.
+   * @param buffers Array of numChannels buffers.
+   * @param numChannels The number of channels.
+   * @param nFrames The number of frames.
+   */
+  void apply(float *const *buffers, int numChannels, int nFrames) {
+    apply(buffers, nullptr, numChannels, nFrames);
+  }
+
+  /**
+   * @brief Crossfades the buffers against a dry signal:
+   * out = dry + gain * (out - dry).
+   * @param buffers Array of numChannels buffers, processed in place.
+   * @param dry Array of numChannels dry buffers (nullptr entries or a null
+   * array mean silence).
+   * @param numChannels The number of channels.
+   * @param nFrames The number of frames.
+   */
+  void apply(float *const *buffers, const float *const *dry, int numChannels,
+             int nFrames);
+
+  /**
+   * @brief Double-precision variant of apply(), used for DoubleNode outputs.
+   */
+  void apply(double *const *buffers, const double *const *dry,
+             int numChannels, int nFrames);
+
+private:
+  enum class State { Idle, Ramping, Silent };
+
+  /** Writes gains for the next n samples (n <= tile size) and advances. */
+  void nextGains(float *gains, int n);
+
+  /** Shared body of the apply() overloads. */
+  template <typename T>
+  void applyTo(T *const *buffers, const T *const *dry, int numChannels,
+               int nFrames);
+
+  State state_ = State::Idle;
+  bool fadingOut_ = false;
+  FadeCurve curve_ = FadeCurve::Linear;
+  int length_ = 0;
+  int position_ = 0;
+};
+
+} // namespace ms
@@ -0,0 +1,64 @@
+#pragma once
+#include "Simd.hpp"
+#include "StaticNode.hpp"
+#include <string>
+
+/**
+ * @file GainNode.hpp
+ * @brief Declares the built-in smoothed gain node.
+ */
+
+namespace ms {
+
+/**
+ * @brief Multiplies its audio input by a smoothed "gain" parameter.
+ *
+ * Ports: audio input "in", audio output "out".
+ */
+class GainNode : public StaticNode<GainNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "gain";
+
+  /**
+   * @brief Constructs a unity-gain node.
+   * @param id The unique string identifier for the Node.
+   */
+  explicit GainNode(const std::string &id);
+
+  /**
+   * @brief Applies the gain. Defined inline so the GraphManager can inline
+   * it into its processing loop.
+   */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    const float *in = inputs[0];
+    float *out = outputs[0];
+    SmoothedValue &gain = *getSmoother(gain_);
+    int i = 0;
+    if (gain.isRamping()) {
+      const float *g = gain.processBlock(nFrames);
+      for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+        (simd::Float4::load(in + i) * simd::Float4::load(g + i)).store(out + i);
+      }
+      for (; i < nFrames; ++i) {
+        out[i] = in[i] * g[i];
+      }
+      return;
+    }
+    const float g = gain.getCurrent();
+    const simd::Float4 g4 = simd::Float4::set1(g);
+    for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+      (simd::Float4::load(in + i) * g4).store(out + i);
+    }
+    for (; i < nFrames; ++i) {
+      out[i] = in[i] * g;
+    }
+  }
+
+private:
+  /** The "gain" parameter (linear). */
+  ParamHandle gain_;
+};
+
+} // namespace ms
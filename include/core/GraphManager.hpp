@@ -1,5 +1,14 @@
 #pragma once 
+#include "Denormals.hpp"
+#include "MpscQueue.hpp"
 #include "Node.hpp"
+#include "NodePool.hpp"
+#include "Profiler.hpp"
+#include "SampleConversion.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <string>
@@ -42,6 +51,59 @@ struct Connection {
   std::string toPortName;
 };
 
+/**
+ * @brief Lightweight handle to a node owned by a GraphManager.
+ *
+ * Handles index the graph's node table directly. The generation counter
+ * makes handles of removed nodes invalid even when the slot is reused.
+ */
+struct NodeHandle {
+  /** Slot index in the node table. */
+  uint32_t index = UINT32_MAX;
+  /** Generation of the slot when the handle was issued. */
+  uint32_t generation = 0;
+
+  /** @brief Returns true if the handle was issued by a graph. */
+  bool isValid() const { return index != UINT32_MAX; }
+};
+
+/**
+ * @brief Fixed-size record describing a parameter change posted from a
+ * control thread.
+ */
+struct ParamChange {
+  /** The target node. */
+  NodeHandle node;
+  /** The target parameter. */
+  ParamHandle param;
+  /** The new value. */
+  ControlValue value;
+  /** Absolute sample time at which to apply the change (0 = next block). */
+  uint64_t sampleTime = 0;
+  /** Arrival order, assigned by the audio thread to keep sorting stable. */
+  uint64_t sequence = 0;
+};
+
+/**
+ * @brief Per-block control processing statistics.
+ */
+struct ControlStats {
+  /** Nodes whose processControl() ran in the last block. */
+  uint32_t evaluated = 0;
+  /** Nodes skipped in the last block because no control input changed. */
+  uint32_t skipped = 0;
+};
+
+/**
+ * @brief Node sleeping statistics (see Node::setTailLength()).
+ */
+struct SleepStats {
+  /** Nodes asleep at the end of the last block. */
+  uint32_t sleeping = 0;
+  /** Times a sleeping node was woken since the graph was created. */
+  uint64_t wakeups = 0;
+};
+
 class GraphManager {
 public:
   /** 
@@ -62,13 +124,43 @@ public:
    */
   NodePtr createNode(const std::string& id, NodePtr node);
 
+  /** 
+   * Creates a node of a type registered in the NodeRegistry and adds it to 
+   * the graph. The node is constructed in the graph's NodePool, next to the 
+   * nodes created before it.
+   * @param id The unique identifier for the node.
+   * @param typeName The registered type name.
+   * @return NodePtr to the added node, or nullptr if the type is unknown or 
+   * the id is taken.
+   */
+  NodePtr createNode(const std::string& id, const std::string& typeName);
+
   /**
    * @brief Removes a node and all its connections from the graph by its ID.
+   * If the graph is prepared and the node has a fade-out duration, the node
+   * keeps running while its output fades out and is released afterwards, on
+   * the next graph edit or by collectRetiredNodes().
    * @param id The unique identifier of the node to remove.
    * @return true if the node was successfully removed, false otherwise.
    */
   bool removeNode(const std::string& id);
 
+  /**
+   * @brief Bypasses a node or brings it back. The node's outputs crossfade 
+   * to its same-index audio inputs (or silence) over its fade-out duration; 
+   * once fully bypassed the node is no longer processed.
+   * @param id The unique identifier of the node.
+   * @param bypassed True to bypass the node, false to re-activate it.
+   * @return true if the node was found, false otherwise.
+   */
+  bool setBypassed(const std::string& id, bool bypassed);
+
+  /**
+   * @brief Releases nodes whose removal fade-out has completed.
+   * @return The number of nodes released.
+   */
+  int collectRetiredNodes();
+
   /** 
    * Retrieves a node by its ID.
    * @param id The unique identifier of the node.
@@ -76,6 +168,180 @@ public:
    */
   NodePtr getNode(const std::string& id) const;
 
+  /** 
+   * Retrieves the handle of a node, for use with postParamChange().
+   * @param id The unique identifier of the node.
+   * @return The node handle, or an invalid handle if not found.
+   */
+  NodeHandle getNodeHandle(const std::string& id) const;
+
+  /** 
+   * Resolves a node handle without touching any reference count or the 
+   * graph lock, so it may be called from the audio thread. The pointer 
+   * stays valid until the node is removed.
+   * @param handle The handle of the node.
+   * @return The node, or nullptr if the handle is stale.
+   */
+  Node* getNode(NodeHandle handle) const;
+
+  /** 
+   * Returns the pool that holds nodes created by type name.
+   * @return The graph's node pool.
+   */
+  const NodePool& getNodePool() const { return *nodePool_; }
+
+  /** 
+   * Posts a parameter change to the audio thread. Safe to call from any 
+   * thread; lock-free and allocation-free. Changes are applied at the start 
+   * of the next block, or at the exact sample offset when sampleTime falls 
+   * inside a later block.
+   * @param node The handle of the target node.
+   * @param param The handle of the target parameter.
+   * @param value The new value.
+   * @param sampleTime Absolute sample time to apply the change at 
+   * (see getSampleTime()), or 0 to apply it at the next block start.
+   * @return false if the queue is full.
+   */
+  bool postParamChange(NodeHandle node, ParamHandle param,
+                       const ControlValue &value, uint64_t sampleTime = 0);
+
+  /** 
+   * Returns the absolute sample time of the next block to be processed.
+   * @return The number of samples processed since prepare().
+   */
+  uint64_t getSampleTime() const { return sampleTime_.load(std::memory_order_relaxed); }
+
+  /** 
+   * Returns the number of parameter changes dropped because the queue or 
+   * the pending list was full.
+   * @return The number of dropped parameter changes.
+   */
+  uint64_t getDroppedParamChanges() const { return droppedParamChanges_.load(std::memory_order_relaxed); }
+
+  /** 
+   * Returns how many control evaluations ran and how many were avoided in 
+   * the last processed block.
+   * @return The control statistics of the last block.
+   */
+  ControlStats getControlStats() const {
+    ControlStats stats;
+    stats.evaluated = controlEvaluated_.load(std::memory_order_relaxed);
+    stats.skipped = controlSkipped_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /** 
+   * Sets the peak level below which a node with a finite tail counts as 
+   * silent. Such a node is put to sleep once its audio inputs have been 
+   * silent for longer than its tail and its outputs are below the 
+   * threshold; it is woken as soon as an input rises above it, an event 
+   * arrives or a fade starts. Defaults to kDefaultSleepThreshold 
+   * (-100 dBFS); 0 disables sleeping, wakes every sleeping node and stops
+   * measuring outputs for it.
+   * @param threshold The linear peak threshold.
+   */
+  void setSleepThreshold(float threshold) {
+    sleepThreshold_.store(std::max(threshold, 0.0f), std::memory_order_relaxed);
+  }
+
+  /** 
+   * Returns the sleep threshold.
+   */
+  float getSleepThreshold() const {
+    return sleepThreshold_.load(std::memory_order_relaxed);
+  }
+
+  /** 
+   * Returns how many nodes are asleep and how often nodes were woken.
+   * @return The sleep statistics as of the last block.
+   */
+  SleepStats getSleepStats() const {
+    SleepStats stats;
+    stats.sleeping = sleepingNodes_.load(std::memory_order_relaxed);
+    stats.wakeups = sleepWakeups_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /** Default for setSleepThreshold(). */
+  static constexpr float kDefaultSleepThreshold = 1e-5f;
+
+  /** 
+   * Starts or stops timing every node's process(), processControl() and 
+   * processEvent() calls. Does nothing when built with MS_PROFILING=0.
+   * @param enabled True to record timings.
+   */
+  void setProfilingEnabled(bool enabled);
+
+  /** 
+   * Returns true while node timings are recorded.
+   */
+  bool isProfilingEnabled() const { return profilingEnabled_; }
+
+  /** 
+   * Sets how often blocks are timed while profiling: every blocks-th block 
+   * is timed, the others run untimed. Reading the clock around every call 
+   * is costly next to small nodes, so the default samples one block in 
+   * kDefaultProfileInterval; 1 times every block (e.g. to catch rare 
+   * spikes in processMaxNs).
+   * @param blocks The sampling interval in blocks (at least 1).
+   */
+  void setProfileInterval(int blocks) {
+    profileInterval_.store(std::max(blocks, 1), std::memory_order_relaxed);
+  }
+
+  /** 
+   * Returns the profiling sampling interval in blocks.
+   */
+  int getProfileInterval() const {
+    return profileInterval_.load(std::memory_order_relaxed);
+  }
+
+  /** 
+   * Returns the timings recorded so far, most expensive node first (by 
+   * total process() time). Safe to call from any thread while the graph 
+   * is running; never blocks the audio thread.
+   * @return One entry per profiled node.
+   */
+  std::vector<NodeProfileStats> getProfileSnapshot() const;
+
+  /** 
+   * Clears all recorded timings.
+   */
+  void resetProfile();
+
+  /** 
+   * Sets whether blocks run with flush-to-zero and denormals-are-zero set 
+   * (the default). The previous mode of the calling thread is restored 
+   * when each block returns. Turn it off together with the output check 
+   * to find the nodes that decay into denormals.
+   * @param flush True to flush denormals to zero.
+   */
+  void setFlushDenormals(bool flush) {
+    flushDenormals_.store(flush, std::memory_order_relaxed);
+  }
+
+  /** 
+   * Returns true if blocks run with denormals flushed to zero.
+   */
+  bool isFlushingDenormals() const {
+    return flushDenormals_.load(std::memory_order_relaxed);
+  }
+
+  /** 
+   * Starts or stops the output check, a debugging aid that scans every 
+   * node's outputs after each block for subnormal, NaN and infinite 
+   * samples. The counts appear in getProfileSnapshot(), where 
+   * nonFiniteOrigins names the node that first produced a NaN or 
+   * infinity. Costs a pass over every output buffer per block.
+   * @param enabled True to check outputs.
+   */
+  void setSignalCheckEnabled(bool enabled);
+
+  /** 
+   * Returns true while the output check runs.
+   */
+  bool isSignalCheckEnabled() const { return signalCheckEnabled_; }
+
   /** 
    * Connects the output port of one node to the input port of another node.
    * @param fromId The ID of the source node.
@@ -108,12 +374,19 @@ public:
    */
   void clear();
 
+  /** Default device channel count for prepare(). */
+  static constexpr int kDefaultDeviceChannels = 2;
+
   /** 
    * Prepares the graph for processing by allocating necessary buffers and sorting nodes.
    * @param sampleRate The sample rate for audio processing.
    * @param blockSize The block size for audio processing.
+   * @param numDeviceChannels The most interleaved channels a device buffer
+   * passed to process() will have; the table that feeds them is allocated
+   * here, off the audio thread.
    */
-  void prepare(int sampleRate, int blockSize);
+  void prepare(int sampleRate, int blockSize,
+               int numDeviceChannels = kDefaultDeviceChannels);
 
   /** 
    * Processes the graph for a given number of frames.
@@ -121,6 +394,36 @@ public:
    */
   void process(int nFrames);
 
+  /**
+   * Processes the graph and writes all PhysicalOutputNode sinks into an
+   * interleaved device buffer (e.g. the miniaudio playback buffer).
+   * Interleaving and format conversion happen on the last stage of the plan,
+   * reading directly from the buffers connected to the sinks. Requests larger
+   * than the block size are processed in consecutive blocks.
+   * @param nFrames The number of frames to process.
+   * @param deviceOutput The interleaved device buffer to fill.
+   * @param format The sample format of the device buffer.
+   * @param numDeviceChannels The number of interleaved channels in the device
+   * buffer. Channels with no bound sink are filled with silence. A buffer
+   * wider than both the count given to prepare() and the highest bound
+   * channel is silenced whole, since filling it would allocate.
+   */
+  void process(int nFrames, void *deviceOutput, SampleFormat format,
+               int numDeviceChannels);
+
+  /**
+   * Enables or disables TPDF dither when converting to 16- or 24-bit output.
+   * @param enabled True to add dither before quantization.
+   */
+  void setOutputDither(bool enabled) { ditherState_.enabled = enabled; }
+
+  /**
+   * Sets the number of events each event port can carry per block. Takes 
+   * effect on the next prepare() or graph edit.
+   * @param capacity The maximum number of events per port and block.
+   */
+  void setEventQueueCapacity(int capacity) { eventQueueCapacity_ = capacity; }
+
   /** 
    * Retrieves the output audio buffer of a node by its ID and output index.
    * @param nodeId The unique identifier of the node.
@@ -129,6 +432,16 @@ public:
    */
   const float *getNodeOutput(const std::string &nodeId, int outputIndex = 0) const;
 
+  /** 
+   * Returns the latency of a node's output relative to the graph's 
+   * sources: the largest sum of Node::getLatency() along any audio path 
+   * ending at the node, the node included. Paths are not aligned, so 
+   * parallel branches with different latencies stay offset.
+   * @param nodeId The unique identifier of the node.
+   * @return The latency in samples, or 0 if the node does not exist.
+   */
+  int getLatency(const std::string &nodeId) const;
+
   /** 
    * Sets the physical audio input buffer for a specific channel index.
    * @param channelIndex The index of the physical input channel.
@@ -144,6 +457,16 @@ public:
    */
   const float* getPhysicalInput(int channelIndex) const;
 
+  /** 
+   * Reads the current value of a node's control output port.
+   * @param nodeId The unique identifier of the node.
+   * @param portName The name of the control output port.
+   * @param value Receives the value (float, int or bool).
+   * @return true if the port exists and the graph is prepared.
+   */
+  bool getControlOutput(const std::string &nodeId, const std::string &portName,
+                        ControlValue &value) const;
+
   /** 
    * Gets the number of physical audio input channels.
    * @return The number of physical input channels.
@@ -152,6 +475,302 @@ public:
 
 private:
 
+  /**
+   * One compiled step of the execution plan: a node together with its
+   * resolved input and output buffers.
+   */
+  struct PlanStep {
+    /** The node processed by this step. */
+    Node *node = nullptr;
+    /** 
+     * Summary flags, kept next to node so that steps without fan-in, 
+     * control or event ports only touch one cache line before process(). 
+     */
+    bool hasFanIn = false;
+    bool hasControl = false;
+    bool hasEvents = false;
+    /** Depth of the node in the graph (see nodeLevels_). */
+    uint32_t level = kNoLevel;
+    /** Timing counters of the node, or nullptr when not profiling. */
+    NodeProfile *profile = nullptr;
+    /** True for DoubleNode steps, whose audio lives in doubleIO. */
+    bool isDouble = false;
+    /** 
+     * Double copies of the outputs of a float node read by a DoubleNode, 
+     * written after the node runs. 
+     */
+    std::vector<double *> doubleOutputs;
+    /** 
+     * Double-precision buffers of a DoubleNode step. step.outputs then 
+     * holds the float copies written after the node runs. 
+     */
+    struct DoubleIO {
+      std::vector<const double *> inputs;
+      std::vector<double *> outputs;
+      std::vector<std::vector<const double *>> fanInSources;
+      std::vector<std::vector<double>> fanInBuffers;
+      std::vector<const double *> dryInputs;
+      std::vector<const double *> segmentInputs;
+      std::vector<double *> segmentOutputs;
+      std::vector<const double *> segmentDry;
+    };
+    std::unique_ptr<DoubleIO> doubleIO;
+    /** Resolved audio input pointer per audio input port. */
+    std::vector<const float *> inputs;
+    /** Audio output pointer per audio output port. */
+    std::vector<float *> outputs;
+    /** Source buffers of input ports fed by more than one connection. */
+    std::vector<std::vector<const float *>> fanInSources;
+    /** Summing buffers for fan-in inputs (empty when not needed). */
+    std::vector<std::vector<float>> fanInBuffers;
+    /** First control slot of the node (inputs, then outputs). */
+    uint32_t controlBase = 0;
+    /** Number of control input ports. */
+    int numControlInputs = 0;
+    /** Number of control output ports. */
+    int numControlOutputs = 0;
+    /** Range of controlRoutes_ feeding this node's control inputs. */
+    uint32_t controlRouteBegin = 0;
+    uint32_t controlRouteEnd = 0;
+    /** Value of controlChangeCounter_ when the inputs were last read. */
+    uint64_t controlSeen = 0;
+    /** True until processControl() has run once after compilation. */
+    bool controlPending = true;
+    /** Source queues per event input port. */
+    std::vector<std::vector<const EventQueue *>> eventSources;
+    /** Merge queues for event inputs fed by more than one connection. */
+    std::vector<EventQueue> eventMerges;
+    /** Scratch read positions used while merging event sources. */
+    std::vector<size_t> eventMergeHeads;
+    /** Event spans handed to processEvent, one per event input port. */
+    std::vector<EventSpan> eventInputs;
+    /** The node's output queues, one per event output port. */
+    std::vector<EventQueue *> eventOutputs;
+    /** Dry signal per audio output used for bypass crossfades. */
+    std::vector<const float *> dryInputs;
+    /** Offset dry pointers used when the block is split. */
+    std::vector<const float *> segmentDry;
+    /** Offset input pointers used when the block is split. */
+    std::vector<const float *> segmentInputs;
+    /** Offset output pointers used when the block is split. */
+    std::vector<float *> segmentOutputs;
+    /** 
+     * Tail of the node when the plan was compiled; only steps with a 
+     * finite tail (>= 0) may sleep. How long they wait before sleeping 
+     * follows the node's current tail. 
+     */
+    int tail = Node::kInfiniteTail;
+    /** True if outputQuiet is maintained: sleepers and their sources. */
+    bool trackSilence = false;
+    /** True if the outputs of the last segment were below the threshold. */
+    bool outputQuiet = false;
+    /** True if every audio source was quiet in the current segment. */
+    bool inputsQuiet = false;
+    /** True while process() is skipped and the outputs hold silence. */
+    bool asleep = false;
+    /** Frames processed since the inputs went quiet. */
+    int64_t quietFrames = 0;
+    /** Plan indices of the steps feeding the audio inputs (sleepers only). */
+    std::vector<uint32_t> audioSources;
+    /**
+     * Range of pendingParamChanges_ holding this node's changes due inside
+     * the current block; the step is split at their offsets (empty range
+     * when there are none).
+     */
+    uint32_t changeBegin = 0;
+    uint32_t changeEnd = 0;
+  };
+
+  /**
+   * Lays out the control slots of all nodes in processing order, keeping the
+   * values of existing control outputs. Called by compilePlan().
+   */
+  void layoutControlSlots();
+
+  /**
+   * Resolves connections into the compiled plan. Called with graphMutex_ held
+   * after sorting and buffer allocation.
+   */
+  void compilePlan();
+
+  /**
+   * Sorts, allocates and recompiles the plan if the graph has been prepared.
+   * Called with graphMutex_ held after every structural change.
+   */
+  void rebuildIfPrepared();
+
+  /**
+   * Removes a node, its connections and its buffers without fading.
+   * Called with graphMutex_ held; the caller rebuilds the plan.
+   */
+  void eraseNode(const std::string& id);
+
+  /**
+   * Erases retiring nodes whose fade-out has completed and rebuilds the plan
+   * if any were found. Called with graphMutex_ held.
+   * @return The number of nodes released.
+   */
+  int purgeRetiredNodes();
+
+  /**
+   * Processes one block: applies the parameter changes due at its start,
+   * hands later ones to the steps of their nodes, and runs the plan.
+   * Called with graphMutex_ held.
+   * @param nFrames The number of frames to process (at most blockSize_).
+   */
+  void runBlock(int nFrames);
+
+  /**
+   * Runs every step of the compiled plan over the block. Called with
+   * graphMutex_ held.
+   * @param nFrames The number of frames in the block.
+   */
+  void runPlan(int nFrames);
+
+  /**
+   * Processes the plan steps [begin, end), calling 
+   * Dispatch::process(node, inputs, outputs, nFrames) for each node. 
+   * Instantiated once for dynamic nodes and once per built-in node type.
+   */
+  template <typename Dispatch>
+  void runSteps(PlanStep *begin, PlanStep *end, int nFrames);
+
+  /**
+   * Processes one step over a segment of the block.
+   * @param offset The first frame of the segment within the block.
+   * @param nFrames The number of frames in the segment.
+   * @param firstSegment True for the segment starting the block; control
+   * and event processing only run once per block.
+   */
+  template <typename Dispatch>
+  void runStep(PlanStep &step, int offset, int nFrames, bool firstSegment);
+
+  /**
+   * Runs a step with parameter changes inside the block in segments,
+   * applying each change at its offset: run(offset, nFrames, firstSegment)
+   * processes one segment. Other steps see the block unsplit.
+   */
+  template <typename Run>
+  void runSplit(PlanStep &step, int nFrames, Run run);
+
+  /** Member pointer to one runSteps() instantiation. */
+  using RunSteps = void (GraphManager::*)(PlanStep *, PlanStep *, int);
+
+  /**
+   * Returns the runSteps() instantiation for a node: the direct-call one 
+   * for built-in node types, the virtual one otherwise.
+   */
+  static RunSteps dispatchFor(const Node *node);
+
+  /**
+   * Audio pointers of a step for the current segment.
+   */
+  struct StepIO {
+    const float *const *inputs;
+    float **outputs;
+    const float *const *dry;
+    int numOutputs;
+  };
+
+  /**
+   * Runs everything that precedes process() for a step: fan-in sums, 
+   * segment pointers, control and event processing. 
+   * @return False if the node is faded out and must not be processed.
+   */
+  bool beginStep(PlanStep &step, int offset, int nFrames, bool firstSegment,
+                 StepIO &io);
+
+  /**
+   * Updates the sleep state of a step with a finite tail before it runs, 
+   * waking it if its inputs are no longer quiet.
+   * @return True if the step is asleep and must not be processed.
+   */
+  bool sleepThrough(PlanStep &step, bool firstSegment);
+
+  /**
+   * Measures a step's outputs for the segment after it ran and puts it to 
+   * sleep once it has decayed past its tail.
+   */
+  void trackSilence(PlanStep &step, int offset, int nFrames);
+
+  /**
+   * Returns the path latency of a node (see getLatency()). memo holds the 
+   * nodes already visited; -1 marks nodes on the current path, which 
+   * breaks feedback cycles. Called with graphMutex_ held.
+   */
+  int pathLatency(const std::string &nodeId,
+                  std::unordered_map<std::string, int> &memo) const;
+
+  /**
+   * Returns the timing counters of a node, creating them on first use.
+   */
+  NodeProfile *profileFor(const std::string &nodeId);
+
+  /**
+   * Points every plan step at its node's counters while profiling or the 
+   * output check is on, and at nullptr otherwise.
+   */
+  void assignProfiles();
+
+  /**
+   * Scans a step's outputs for the segment and records suspicious samples 
+   * (output check only).
+   */
+  void checkOutputs(PlanStep &step, int offset, int nFrames);
+
+  /**
+   * Runs processControl() and processEvent() for a step (first segment 
+   * only).
+   */
+  void runControlAndEvents(PlanStep &step, bool firstSegment);
+
+  /**
+   * Applies the node's fade envelope after process().
+   */
+  void endStep(PlanStep &step, const StepIO &io, int offset, int nFrames);
+
+  /**
+   * Writes the other-precision copies of a step's outputs for the segment.
+   */
+  void convertOutputs(PlanStep &step, int offset, int nFrames);
+
+  /**
+   * Processes consecutive DoubleNode steps.
+   */
+  void runDoubleSteps(PlanStep *begin, PlanStep *end, int nFrames);
+
+  /**
+   * Processes one DoubleNode step over a segment of the block (see
+   * runStep()).
+   */
+  void runDoubleStep(PlanStep &step, int offset, int nFrames,
+                     bool firstSegment);
+
+  /**
+   * Processes the plan steps [begin, end), which share a batch entry point 
+   * and do not depend on each other, with one call to that entry point.
+   * Steps with parameter changes inside the block run on their own.
+   */
+  void runBatch(PlanStep *begin, PlanStep *end, int nFrames);
+
+  /**
+   * Runs processControl() for a step if one of its control inputs changed,
+   * and stamps the outputs it changed. Called with graphMutex_ held.
+   */
+  void runControl(PlanStep &step);
+
+  /**
+   * Applies a parameter change to its node, ignoring stale handles.
+   */
+  void applyParamChange(const ParamChange &change);
+
+  /**
+   * Last stage of the plan: interleaves and converts the buffers feeding the
+   * physical output sinks into the device buffer.
+   */
+  void writeDeviceOutput(void *deviceOutput, SampleFormat format,
+                         int numDeviceChannels, int nFrames);
+
   /** 
    * Allocates audio, control, and event buffers for all nodes in the graph. 
    * Ensures that each node has the necessary resources for processing.
@@ -182,6 +801,13 @@ private:
    */
   std::vector<NodePtr> orderedNodes_;
 
+  /** 
+   * Depth of each node in orderedNodes_: one more than its deepest source. 
+   * Nodes on a cycle get kNoLevel and are never batched.
+   */
+  std::vector<uint32_t> nodeLevels_;
+  static constexpr uint32_t kNoLevel = UINT32_MAX;
+
   /** 
    * List of connections between nodes. Represents how nodes are connected 
    * in the audio graph.
@@ -195,16 +821,114 @@ private:
   std::unordered_map<std::string, std::vector<std::vector<float>>> audioBuffers_;
 
   /** 
-   * Maps node names to their output control parameters (e.g., volume, frequency). 
-   * Each node can have multiple controls, identified by name.
+   * Double-precision output buffers: the outputs of DoubleNodes, and the 
+   * widened outputs of float nodes that feed a DoubleNode. 
+   */
+  std::unordered_map<std::string, std::vector<std::vector<double>>> doubleBuffers_;
+
+  /** 
+   * Position of a node's control ports in controlSlots_.
    */
-  std::unordered_map<std::string, std::unordered_map<std::string, ControlValue>> controlValues_;
+  struct ControlLayout {
+    /** First slot; the node's inputs come first, then its outputs. */
+    uint32_t base = 0;
+    /** Number of control input ports. */
+    uint32_t numInputs = 0;
+    /** Number of control output ports. */
+    uint32_t numOutputs = 0;
+  };
 
   /** 
-   * Maps node names to their output event buffers. Each node can receive different types 
-   * of events (e.g., triggers, messages), each stored in a vector.
+   * Copies one control output slot into a connected control input slot.
    */
-  std::unordered_map<std::string, std::unordered_map<std::string, std::vector<Event>>> eventBuffers_;
+  struct ControlRoute {
+    /** Input slot being fed. */
+    uint32_t destination;
+    /** Output slot feeding it. */
+    uint32_t source;
+  };
+
+  /** 
+   * Contiguous control slots of all nodes, laid out in processing order 
+   * when the plan is compiled. Output values survive recompilation.
+   */
+  std::vector<ControlSlot> controlSlots_;
+
+  /** 
+   * Maps node names to their control slot layout.
+   */
+  std::unordered_map<std::string, ControlLayout> controlLayouts_;
+
+  /** 
+   * Control routes of all nodes, grouped per plan step in processing order.
+   */
+  std::vector<ControlRoute> controlRoutes_;
+
+  /** 
+   * Per control slot, the value of controlChangeCounter_ when the slot's 
+   * value last changed. A node's inputs are dirty when a source stamp is 
+   * newer than the node's PlanStep::controlSeen.
+   */
+  std::vector<uint64_t> controlStamps_;
+
+  /** 
+   * Incremented every time a control output changes value.
+   */
+  uint64_t controlChangeCounter_ = 0;
+
+  /** 
+   * Snapshot of a node's control outputs taken before processControl().
+   */
+  std::vector<ControlSlot> controlScratch_;
+
+  /** 
+   * Number of processControl() calls in the last block.
+   */
+  std::atomic<uint32_t> controlEvaluated_{0};
+
+  /** 
+   * Number of processControl() calls avoided in the last block.
+   */
+  std::atomic<uint32_t> controlSkipped_{0};
+
+  /** 
+   * Counters of the block being processed, published at the end of it.
+   */
+  uint32_t blockControlEvaluated_ = 0;
+  uint32_t blockControlSkipped_ = 0;
+
+  /** See setSleepThreshold(); read once per block into blockSleepThreshold_. */
+  std::atomic<float> sleepThreshold_{kDefaultSleepThreshold};
+  float blockSleepThreshold_ = kDefaultSleepThreshold;
+
+  /** 
+   * Published sleep statistics (see getSleepStats()).
+   */
+  std::atomic<uint32_t> sleepingNodes_{0};
+  std::atomic<uint64_t> sleepWakeups_{0};
+
+  /** 
+   * Sleeping steps of the current plan and wakeups so far. Audio thread.
+   */
+  uint32_t sleepingSteps_ = 0;
+  uint64_t wakeups_ = 0;
+
+  /** 
+   * Maps node names to their output event queues, one per event output port 
+   * in port order. Queue storage lives in eventArena_.
+   */
+  std::unordered_map<std::string, std::vector<EventQueue>> eventBuffers_;
+
+  /** 
+   * Preallocated storage for every event queue of the plan. Queues are 
+   * fixed regions of this arena, so delivering events never allocates.
+   */
+  std::vector<Event> eventArena_;
+
+  /** 
+   * Capacity of each event queue, in events per block.
+   */
+  int eventQueueCapacity_ = 256;
 
   /** 
    * Sample rate for audio processing. Determines how many samples per second 
@@ -218,6 +942,12 @@ private:
    */
   int blockSize_ = 512;
 
+  /** 
+   * Device channel count given to prepare(); deviceChannelPointers_ covers
+   * at least this many channels.
+   */
+  int numDeviceChannels_ = kDefaultDeviceChannels;
+
   /** 
    * Flag indicating whether the graph has been prepared (buffers allocated, 
    * nodes sorted, etc.) and is ready for processing.
@@ -237,5 +967,212 @@ private:
    */
   std::atomic<bool> needsBufferReallocation_{false};
 
+  /** 
+   * Compiled execution plan, one step per node in processing order.
+   */
+  std::vector<PlanStep> plan_;
+
+  /**
+   * A run of consecutive plan steps processed by one runSteps() call.
+   */
+  struct PlanGroup {
+    uint32_t begin;
+    uint32_t end;
+    RunSteps run;
+  };
+
+  /** 
+   * Scratch arrays handed to batch entry points, sized for the largest 
+   * batch group. 
+   */
+  std::vector<PlanStep *> batchSteps_;
+  std::vector<Node *> batchNodes_;
+  std::vector<const float *const *> batchInputs_;
+  std::vector<float **> batchOutputs_;
+  std::vector<StepIO> batchIO_;
+
+  /** 
+   * plan_ split into runs of consecutive steps sharing a dispatch. 
+   */
+  std::vector<PlanGroup> planGroups_;
+
+  /** 
+   * Physical audio input buffers, one per hardware input channel.
+   */
+  std::vector<std::vector<float>> physicalInputBuffers_;
+
+  /** 
+   * Offset into the physical input buffers of the block being processed, 
+   * used when a device request is split into several blocks.
+   */
+  int physicalInputOffset_ = 0;
+
+  /** 
+   * Buffers feeding each device output channel, collected from the 
+   * PhysicalOutputNode sinks when the plan is compiled.
+   */
+  std::vector<std::vector<const float *>> deviceChannelSources_;
+
+  /** 
+   * Summing buffers for device channels bound to more than one sink.
+   */
+  std::vector<std::vector<float>> deviceMixBuffers_;
+
+  /** 
+   * Per-block table of device channel pointers handed to the converter,
+   * sized when the plan is compiled.
+   */
+  std::vector<const float *> deviceChannelPointers_;
+
+  /** 
+   * Silent buffer used for unconnected audio inputs.
+   */
+  std::vector<float> silence_;
+
+  /** 
+   * Double-precision silence for unconnected DoubleNode inputs.
+   */
+  std::vector<double> doubleSilence_;
+
+  /** 
+   * Dither generator state for integer device formats.
+   */
+  DitherState ditherState_;
+
+  /** 
+   * A slot of the node table addressed by NodeHandle. The node and 
+   * generation are atomic so that getNode(NodeHandle) can read them 
+   * without the graph lock.
+   */
+  struct NodeSlot {
+    /** The node in this slot, or nullptr if free. */
+    std::atomic<Node *> node{nullptr};
+    /** Incremented every time the slot is freed. */
+    std::atomic<uint32_t> generation{0};
+    /** Index of the node's step in plan_, or UINT32_MAX if none. */
+    uint32_t planStep = UINT32_MAX;
+  };
+
+  /** Slots per page of the node table. */
+  static constexpr uint32_t kNodeSlotsPerPage = 256;
+
+  /** Pages of the node table; bounds the number of live nodes. */
+  static constexpr uint32_t kMaxNodeSlotPages = 1024;
+
+  /** 
+   * Returns the slot at index, or nullptr past the end of the table. 
+   * Safe without the graph lock: pages are never moved or freed.
+   */
+  NodeSlot *findNodeSlot(uint32_t index) const;
+
+  /** 
+   * Returns an existing slot; for graph edits under the graph lock.
+   */
+  NodeSlot &nodeSlot(uint32_t index) const {
+    return nodeSlotStorage_[index / kNodeSlotsPerPage]
+                           [index % kNodeSlotsPerPage];
+  }
+
+  /** 
+   * Node table indexed by NodeHandle::index, in fixed pages so that 
+   * growing it never moves a slot under a lock-free reader.
+   */
+  std::array<std::atomic<NodeSlot *>, kMaxNodeSlotPages> nodeSlotPages_{};
+
+  /** 
+   * Owns the pages of nodeSlotPages_.
+   */
+  std::vector<std::unique_ptr<NodeSlot[]>> nodeSlotStorage_;
+
+  /** 
+   * Number of slots in use or free, published after their page.
+   */
+  std::atomic<uint32_t> numNodeSlots_{0};
+
+  /** 
+   * Free slots of the node table available for reuse.
+   */
+  std::vector<uint32_t> freeNodeSlots_;
+
+  /** 
+   * Maps node names to their slot in the node table.
+   */
+  std::unordered_map<std::string, uint32_t> nodeSlotIndex_;
+
+  /** 
+   * Storage of nodes created by type name. Shared with the deleters of 
+   * those nodes, so it outlives every NodePtr handed out.
+   */
+  std::shared_ptr<NodePool> nodePool_ = std::make_shared<NodePool>();
+
+  /** 
+   * Timing counters per node id. Written by the audio thread through 
+   * PlanStep::profile; the map itself is guarded by profileMutex_ so that 
+   * snapshots never take graphMutex_.
+   */
+  std::unordered_map<std::string, std::unique_ptr<NodeProfile>> profiles_;
+  mutable std::mutex profileMutex_;
+  bool profilingEnabled_ = false;
+
+  /** See setFlushDenormals(). */
+  std::atomic<bool> flushDenormals_{true};
+  bool signalCheckEnabled_ = false;
+  /** True once a node output NaN/infinity in the current block. */
+  bool blockNonFinite_ = false;
+
+  /** Default for setProfileInterval(). */
+  static constexpr int kDefaultProfileInterval = 16;
+  std::atomic<int> profileInterval_{kDefaultProfileInterval};
+  /** Blocks left until the next timed block. Audio thread only. */
+  int profileCountdown_ = 1;
+  /** True while the current block is timed. Audio thread only. */
+  bool profileBlock_ = false;
+
+  /** 
+   * Returns the counters a step records into during this block, or 
+   * nullptr if the block is not timed.
+   */
+  NodeProfile *activeProfile(const PlanStep &step) const {
+#if MS_PROFILING
+    return profileBlock_ ? step.profile : nullptr;
+#else
+    (void)step;
+    return nullptr;
+#endif
+  }
+
+  /** 
+   * Reference points used to calibrate profiler ticks to nanoseconds.
+   */
+  uint64_t profileStartTicks_ = ProfileClock::now();
+  std::chrono::steady_clock::time_point profileStartTime_ =
+      std::chrono::steady_clock::now();
+
+  /** 
+   * Queue of parameter changes posted by control threads.
+   */
+  MpscQueue<ParamChange> paramChangeQueue_{4096};
+
+  /** 
+   * Changes drained from the queue but not yet due. Capacity is reserved 
+   * up front so the audio thread never allocates.
+   */
+  std::vector<ParamChange> pendingParamChanges_;
+
+  /** 
+   * Arrival counter used to keep changes with equal sample times in order.
+   */
+  uint64_t paramChangeSequence_ = 0;
+
+  /** 
+   * Absolute sample time of the next block.
+   */
+  std::atomic<uint64_t> sampleTime_{0};
+
+  /** 
+   * Number of parameter changes dropped because of a full queue.
+   */
+  std::atomic<uint64_t> droppedParamChanges_{0};
+
 };
 } // namespace ms
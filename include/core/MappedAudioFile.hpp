@@ -0,0 +1,144 @@
+#pragma once
+#include "SampleConversion.hpp"
+#include "Span.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @file MappedAudioFile.hpp
+ * @brief Declares zero-copy, memory-mapped access to uncompressed audio
+ * files.
+ */
+
+namespace ms {
+
+/** @brief Expected access pattern of a mapped file, passed to madvise. */
+enum class AccessPattern { Normal, Sequential, Random };
+
+/**
+ * @brief An uncompressed audio file mapped into memory.
+ *
+ * open() maps a WAV file of 16-bit integer or 32-bit float PCM (plain or
+ * WAVE_FORMAT_EXTENSIBLE); openRaw() maps headerless PCM. Only the header
+ * is read: the kernel pages sample data in when it is first touched, so
+ * opening a whole library costs a few system calls per file. The data is
+ * exposed in place as interleaved frames; read() converts 16-bit files to
+ * float on demand, four samples per instruction.
+ *
+ * Touching a page that is not resident blocks on the disk, and touch() or
+ * prefetch() only make a page resident for now: the kernel may evict it
+ * again under memory pressure. Audio threads should therefore play copies
+ * made by another thread, as SamplePlayerNode's I/O thread does, rather
+ * than read the mapping.
+ *
+ * A mapped file is read-only and may be shared between threads. The file
+ * must not be truncated while mapped: reading past its new end raises
+ * SIGBUS. Mapping is supported on POSIX systems; elsewhere open() fails.
+ */
+class MappedAudioFile {
+public:
+  MappedAudioFile() = default;
+  ~MappedAudioFile();
+
+  MappedAudioFile(const MappedAudioFile &) = delete;
+  MappedAudioFile &operator=(const MappedAudioFile &) = delete;
+
+  /**
+   * @brief Maps a WAV file.
+   * @param path The file.
+   * @return False if the file cannot be mapped, is not a WAV file, or its
+   * data is not 16-bit integer or 32-bit float PCM.
+   */
+  bool open(const std::string &path);
+
+  /**
+   * @brief Maps headerless PCM.
+   * @param path The file.
+   * @param format SampleFormat::S16 or SampleFormat::F32, native endian.
+   * @param channels The number of interleaved channels.
+   * @param sampleRate The sample rate, in Hz.
+   * @param dataOffset Bytes to skip before the first frame; a multiple of
+   * the sample size.
+   * @return False if the file cannot be mapped or the layout is invalid.
+   */
+  bool openRaw(const std::string &path, SampleFormat format, int channels,
+               int sampleRate, size_t dataOffset = 0);
+
+  /** @brief Unmaps the file. */
+  void close();
+
+  /** @brief Returns true while a file is mapped. */
+  bool isOpen() const { return mapping_ != nullptr; }
+
+  /** @brief Returns the path of the mapped file. */
+  const std::string &getPath() const { return path_; }
+
+  /** @brief Returns SampleFormat::S16 or SampleFormat::F32. */
+  SampleFormat getFormat() const { return format_; }
+
+  /** @brief Returns the number of interleaved channels. */
+  int getChannels() const { return channels_; }
+
+  /** @brief Returns the sample rate, in Hz. */
+  int getSampleRate() const { return sampleRate_; }
+
+  /** @brief Returns the number of frames. */
+  uint64_t getFrames() const { return frames_; }
+
+  /** @brief Returns the bytes of address space mapped. */
+  size_t getMappedBytes() const { return mappedBytes_; }
+
+  /** @brief Returns the interleaved frames of an F32 file (else empty). */
+  Span<const float> getFloatData() const;
+
+  /** @brief Returns the interleaved frames of an S16 file (else empty). */
+  Span<const int16_t> getInt16Data() const;
+
+  /**
+   * @brief Tells the kernel how the data will be read, so it can read
+   * ahead further (Sequential) or not at all (Random).
+   */
+  void advise(AccessPattern pattern) const;
+
+  /**
+   * @brief Asks the kernel to start reading frames in the background.
+   * Returns at once.
+   */
+  void prefetch(uint64_t frame, uint64_t count) const;
+
+  /**
+   * @brief Faults frames into memory, blocking until they are resident.
+   * Not for audio threads.
+   */
+  void touch(uint64_t frame, uint64_t count) const;
+
+  /**
+   * @brief Copies frames as interleaved floats in [-1, 1), converting
+   * 16-bit data. Frames past the end are not written.
+   * @param frame The first frame.
+   * @param count The number of frames.
+   * @param output Receives count * getChannels() samples.
+   * @return The number of frames written.
+   */
+  uint64_t read(uint64_t frame, uint64_t count, float *output) const;
+
+private:
+  /** Maps the file and checks it is long enough for the header. */
+  bool map(const std::string &path);
+
+  /** Points the data at the mapping; false if the layout is invalid. */
+  bool setLayout(SampleFormat format, int channels, int sampleRate,
+                 size_t dataOffset, size_t dataBytes);
+
+  std::string path_;
+  void *mapping_ = nullptr;
+  size_t mappedBytes_ = 0;
+  const unsigned char *data_ = nullptr;
+  SampleFormat format_ = SampleFormat::F32;
+  int channels_ = 0;
+  int sampleRate_ = 0;
+  uint64_t frames_ = 0;
+};
+
+} // namespace ms
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * @file MirroredRingBuffer.hpp
+ * @brief Declares a ring buffer of floats whose storage appears twice in a
+ * row, so any window of it is contiguous.
+ */
+
+namespace ms {
+
+/**
+ * @brief A ring of getCapacity() floats laid out so that data()[i] and
+ * data()[i + getCapacity()] are the same sample.
+ *
+ * Any run of up to getCapacity() samples starting in [0, getCapacity())
+ * is therefore contiguous in memory, however it straddles the end of the
+ * ring: readers index with plain pointer arithmetic and SIMD loads never
+ * need to be split at the wrap.
+ *
+ * On Linux the two halves are the same physical pages, mapped twice from
+ * a memfd; writes to either half appear in both for free. Elsewhere, or
+ * if the mapping fails, the halves are separate copies and commit() copies
+ * written samples into the other half. Write through data(), then
+ * commit() the written range before reading it through the other half.
+ *
+ * allocate() and release() map memory and may block; call them outside
+ * the audio thread. The buffer is not thread-safe.
+ */
+class MirroredRingBuffer {
+public:
+  MirroredRingBuffer() = default;
+  ~MirroredRingBuffer();
+
+  MirroredRingBuffer(const MirroredRingBuffer &) = delete;
+  MirroredRingBuffer &operator=(const MirroredRingBuffer &) = delete;
+  MirroredRingBuffer(MirroredRingBuffer &&other) noexcept;
+  MirroredRingBuffer &operator=(MirroredRingBuffer &&other) noexcept;
+
+  /**
+   * @brief Allocates a cleared ring of at least minCapacity samples,
+   * replacing any previous one. The capacity is rounded up to whole pages.
+   * @param minCapacity The number of samples the ring must hold.
+   */
+  void allocate(size_t minCapacity);
+
+  /** @brief Frees the ring. */
+  void release();
+
+  /** @brief Returns the number of samples in the ring. */
+  size_t getCapacity() const { return capacity_; }
+
+  /** @brief Returns true if the halves share pages (commit() is free). */
+  bool isMirrored() const { return mapping_ != nullptr; }
+
+  /** @brief Returns the start of the 2 * getCapacity() samples. */
+  float *data() { return data_; }
+  const float *data() const { return data_; }
+
+  /**
+   * @brief Makes samples written through data() visible in the other
+   * half. Does nothing when the halves share pages.
+   * @param position Index of the first written sample, in
+   * [0, 2 * getCapacity()).
+   * @param count The number of samples, at most getCapacity().
+   */
+  void commit(size_t position, size_t count) {
+    if (!mapping_ && count > 0) {
+      copyToMirror(position, count);
+    }
+  }
+
+  /** @brief Sets every sample to zero. */
+  void clear();
+
+private:
+  /** Copies [position, position + count) into the other half. */
+  void copyToMirror(size_t position, size_t count);
+
+  /** Maps the ring twice from a memfd; false if unsupported or failed. */
+  bool mapMirrored(size_t capacity);
+
+  float *data_ = nullptr;
+  size_t capacity_ = 0;
+  /** The double mapping, or nullptr when fallback_ holds the samples. */
+  void *mapping_ = nullptr;
+  std::vector<float> fallback_;
+};
+
+} // namespace ms
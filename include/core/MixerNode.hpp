@@ -0,0 +1,103 @@
+#pragma once
+#include "StaticNode.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @file MixerNode.hpp
+ * @brief Declares the built-in multichannel mixer node.
+ */
+
+namespace ms {
+
+/**
+ * @brief Mixes any number of mono inputs into any number of output
+ * channels, with a gain and a pan position per input.
+ *
+ * The inputs are mixed through an N x M matrix of gains, one row per
+ * input, computed from its "gain" and "pan" parameters. Pan places an input
+ * along the outputs as a line: -1 is out0, 1 is out<M-1>, and positions in
+ * between are shared by the two nearest outputs with a constant-power law,
+ * so with two outputs this is the usual stereo pan (-3 dB at the centre).
+ * A single output ignores pan.
+ *
+ * Each input is read once per block and accumulated into every output it
+ * reaches, up to four outputs per pass, four frames per SIMD vector; zero
+ * entries of the matrix are skipped. Inputs whose block is entirely zero
+ * (silent or unconnected) are skipped. When a parameter changes, the row
+ * ramps linearly to its new gains over kRampMs; rows that are not changing
+ * use constant gains.
+ *
+ * Ports: audio inputs "in0" ... "in<N-1>", audio outputs "out0" ...
+ * "out<M-1>". Parameters: "gain<i>" (linear, default 1) and "pan<i>"
+ * (-1 to 1, default 0) for each input i.
+ */
+class MixerNode : public StaticNode<MixerNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "mixer";
+
+  /** Time over which gain and pan changes ramp, in milliseconds. */
+  static constexpr float kRampMs = 20.0f;
+
+  /**
+   * @brief Constructs a mixer.
+   * @param id The unique string identifier for the Node.
+   * @param numInputs The number of mono inputs (at least 1).
+   * @param numOutputs The number of output channels (at least 1).
+   */
+  explicit MixerNode(const std::string &id, int numInputs = 2,
+                     int numOutputs = 2);
+
+  /** @brief Returns the number of inputs. */
+  int getNumInputs() const { return numInputs_; }
+
+  /** @brief Returns the number of output channels. */
+  int getNumOutputs() const { return numOutputs_; }
+
+  /**
+   * @brief Returns the current gain from an input to an output, including
+   * any ramp in progress.
+   */
+  float getMatrixGain(int input, int output) const {
+    return gains_[static_cast<size_t>(input) * numOutputs_ + output];
+  }
+
+  void prepare(int sampleRate, int blockSize) override;
+
+  /** @brief Mixes the block. */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    render(inputs, outputs, nFrames);
+  }
+
+private:
+  /** Reads the parameters and mixes the block. */
+  void render(const float *const *inputs, float **outputs, int nFrames);
+
+  /** Computes an input's target row from its gain and pan. */
+  void computeTargets(int input, float gain, float pan);
+
+  int numInputs_;
+  int numOutputs_;
+  std::vector<ParamHandle> gainParams_;
+  std::vector<ParamHandle> panParams_;
+
+  /** The gain and pan each row's targets were computed from. */
+  std::vector<float> cachedGain_;
+  std::vector<float> cachedPan_;
+
+  /**
+   * The matrix, its targets and per-sample ramp increments:
+   * [input * numOutputs + output].
+   */
+  std::vector<float> gains_;
+  std::vector<float> targets_;
+  std::vector<float> steps_;
+
+  /** Frames left in each row's ramp (0 = constant). */
+  std::vector<int> rampLeft_;
+  int rampFrames_ = 1;
+};
+
+} // namespace ms
@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @file MpscQueue.hpp
+ * @brief Bounded lock-free multi-producer / single-consumer queue.
+ *
+ * Used to hand fixed-size records from control threads (UI, network,
+ * automation) to the audio thread without locks or allocation.
+ */
+
+namespace ms {
+
+/**
+ * @brief Bounded MPSC ring buffer of trivially copyable records.
+ *
+ * Based on Dmitry Vyukov's bounded queue: each cell carries a sequence
+ * number, so producers only contend on a single atomic index and the
+ * consumer never waits. push() is lock-free and fails when the queue is
+ * full; pop() is wait-free. Storage is allocated once in the constructor.
+ */
+template <typename T> class MpscQueue {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "MpscQueue records must be trivially copyable");
+
+public:
+  /**
+   * @brief Constructs a queue.
+   * @param capacity Minimum number of records; rounded up to a power of two.
+   */
+  explicit MpscQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /**
+   * @brief Enqueues a record. Safe to call from any number of threads.
+   * @param item The record to enqueue.
+   * @return False if the queue is full.
+   */
+  bool push(const T &item) {
+    Cell *cell;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Dequeues a record. Must only be called from the consumer thread.
+   * @param item Receives the dequeued record.
+   * @return False if the queue is empty.
+   */
+  bool pop(T &item) {
+    Cell *cell = &cells_[dequeuePos_ & mask_];
+    const size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(dequeuePos_ + 1) <
+        0) {
+      return false;
+    }
+    item = cell->data;
+    cell->sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+    ++dequeuePos_;
+    return true;
+  }
+
+  /** @brief Returns the number of records the queue can hold. */
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_ = 0;
+  alignas(64) std::atomic<size_t> enqueuePos_{0};
+  alignas(64) size_t dequeuePos_ = 0;
+};
+
+} // namespace ms
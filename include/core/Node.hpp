@@ -1,7 +1,14 @@
 #pragma once
+#include "ControlSlots.hpp"
+#include "EventQueue.hpp"
+#include "GainEnvelope.hpp"
 #include "Port.hpp"
+#include "SmoothedValue.hpp"
+#include "Span.hpp"
+#include <atomic>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 /**
@@ -14,6 +21,8 @@
 
 namespace ms {
 
+class GraphManager;
+
 /**
  * @brief Represents a named parameter of a Node.
  *
@@ -37,6 +46,26 @@ struct Param {
       : name(paramName), value(paramValue) {}
 };
 
+/**
+ * @brief Sample precision a Node processes audio in.
+ */
+enum class SampleType { Float32, Float64 };
+
+/**
+ * @brief Stable handle to a parameter of a Node.
+ *
+ * Handles are returned when a parameter is declared and stay valid for the
+ * lifetime of the Node (unless setParams() replaces the whole parameter
+ * list). Access by handle is a direct index, without any string comparison.
+ */
+struct ParamHandle {
+  /** Index of the parameter in the Node's parameter list (-1 = invalid). */
+  int index = -1;
+
+  /** @brief Returns true if the handle refers to a parameter. */
+  bool isValid() const { return index >= 0; }
+};
+
 /**
  * @brief Represents a processing unit in the MilliSuono graph.
  *
@@ -71,9 +100,22 @@ public:
 
   /**
    * @brief Returns the list of parameters associated with the Node (mutable).
-   * @return A const reference to the vector of Params.
+   *
+   * The view allows editing values in place without copying the list;
+   * parameter names must not be changed through it.
+   * @return A non-copying view over the Params.
+   */
+  Span<Param> getParams() { return Span<Param>(params_); }
+
+  /**
+   * @brief Looks up the handle of a parameter by name.
+   * @param name The name of the parameter.
+   * @return The parameter handle, or an invalid handle if not found.
    */
-  std::vector<Param> getParams() { return params_; }
+  ParamHandle findParam(const std::string &name) const {
+    auto it = paramIndex_.find(name);
+    return it != paramIndex_.end() ? ParamHandle{it->second} : ParamHandle{};
+  }
 
   /**
    * @brief Retrieves a parameter value by name.
@@ -81,19 +123,47 @@ public:
    * @return A pointer to the ControlValue if found, nullptr otherwise.
    */
   const ControlValue *getParam(const std::string &name) const {
-    for (const auto &param : params_) {
-      if (param.name == name) {
-        return &param.value;
-      }
+    return getParam(findParam(name));
+  }
+
+  /**
+   * @brief Retrieves a parameter value by handle in O(1).
+   * @param handle The handle of the parameter to retrieve.
+   * @return A pointer to the ControlValue if valid, nullptr otherwise.
+   */
+  const ControlValue *getParam(ParamHandle handle) const {
+    if (static_cast<size_t>(handle.index) >= params_.size()) {
+      return nullptr;
     }
-    return nullptr;
+    return &params_[handle.index].value;
   }
 
   /**
    * @brief Sets the parameters of the Node.
+   * Previously issued handles refer to the new list by position. Smoothers
+   * follow their parameter by name and jump to its new value without a
+   * ramp; smoothers whose parameter is no longer listed are dropped.
    * @param newParams A vector of Params to set for the Node.
    */
-  void setParams(const std::vector<Param> &newParams) { params_ = newParams; }
+  void setParams(const std::vector<Param> &newParams) {
+    std::vector<int> smootherIndex(newParams.size(), -1);
+    for (size_t i = 0; i < newParams.size(); ++i) {
+      const ParamHandle old = findParam(newParams[i].name);
+      if (static_cast<size_t>(old.index) >= smootherIndex_.size() ||
+          smootherIndex_[old.index] < 0) {
+        continue;
+      }
+      smootherIndex[i] = smootherIndex_[old.index];
+      if (newParams[i].value.isFloat()) {
+        smoothers_[smootherIndex[i]].setCurrentAndTarget(
+            newParams[i].value.asFloat());
+      }
+    }
+    smootherIndex_ = std::move(smootherIndex);
+    params_ = newParams;
+    rebuildParamIndex();
+    paramsChanged_.store(true, std::memory_order_relaxed);
+  }
 
   /**
    * @brief Sets a parameter value by name.
@@ -102,13 +172,41 @@ public:
    * @return True if the parameter was found and set, false otherwise.
    */
   bool setParam(const std::string &name, const ControlValue &value) {
-    for (auto &param : params_) {
-      if (param.name == name) {
-        param.value = value;
-        return true;
+    return setParam(findParam(name), value);
+  }
+
+  /**
+   * @brief Sets a parameter value by handle in O(1).
+   * @param handle The handle of the parameter to set.
+   * @param value The new value to assign to the parameter.
+   * @return True if the handle was valid and the value set, false otherwise.
+   */
+  bool setParam(ParamHandle handle, const ControlValue &value) {
+    if (static_cast<size_t>(handle.index) >= params_.size()) {
+      return false;
+    }
+    params_[handle.index].value = value;
+    paramsChanged_.store(true, std::memory_order_relaxed);
+    if (SmoothedValue *smoother = getSmoother(handle)) {
+      if (value.isFloat()) {
+        smoother->setTarget(value.asFloat());
       }
     }
-    return false;
+    return true;
+  }
+
+  /**
+   * @brief Returns the smoother attached to a parameter.
+   * @param handle The handle of a parameter declared with addSmoothedParam().
+   * @return Pointer to the SmoothedValue, or nullptr if the parameter is not
+   * smoothed.
+   */
+  SmoothedValue *getSmoother(ParamHandle handle) {
+    if (static_cast<size_t>(handle.index) >= smootherIndex_.size() ||
+        smootherIndex_[handle.index] < 0) {
+      return nullptr;
+    }
+    return &smoothers_[smootherIndex_[handle.index]];
   }
 
   /**
@@ -122,18 +220,76 @@ public:
    * @param durationMs The fade-in duration in milliseconds (0 = disabled,
    * default = 50ms).
    */
-  void setFadeInDuration(float durationMs) {
-    fadeInDurationMs_ = durationMs;
-    updateFadeInSamples();
-  }
+  void setFadeInDuration(float durationMs) { fadeInDurationMs_ = durationMs; }
+
+  /**
+   * @brief Gets the fade-out duration in milliseconds.
+   * @return The fade-out duration in milliseconds.
+   */
+  float getFadeOutDuration() const { return fadeOutDurationMs_; }
+
+  /**
+   * @brief Sets the fade-out duration used when the node is removed from or
+   * bypassed in a graph.
+   * @param durationMs The fade-out duration in milliseconds (0 = cut
+   * immediately, default = 50ms).
+   */
+  void setFadeOutDuration(float durationMs) { fadeOutDurationMs_ = durationMs; }
 
   /**
-   * @brief Resets the fade-in effect to start from the beginning
-   * (useful when re-activating a node).
+   * @brief Gets the curve used for fade-ins and fade-outs.
+   * @return The fade curve.
    */
-  void resetFadeIn() {
-    currentFadeInSample_ = 0;
-    fadeInActive_ = (fadeInDurationMs_ > 0.0f);
+  FadeCurve getFadeCurve() const { return fadeCurve_; }
+
+  /**
+   * @brief Sets the curve used for fade-ins and fade-outs.
+   * @param curve The fade curve (default = Linear).
+   */
+  void setFadeCurve(FadeCurve curve) { fadeCurve_ = curve; }
+
+  /**
+   * @brief Resets the fade-in effect to start from the beginning.
+   * The graph calls this when the node is inserted into a prepared graph,
+   * when the graph is first prepared, and when the node is un-bypassed;
+   * preparing it again does not restart the fade.
+   */
+  void resetFadeIn() { envelope_.startFadeIn(msToSamples(fadeInDurationMs_), fadeCurve_); }
+
+  /**
+   * @brief Starts fading the node's output out to silence.
+   */
+  void startFadeOut() { envelope_.startFadeOut(msToSamples(fadeOutDurationMs_), fadeCurve_); }
+
+  /**
+   * @brief Returns true once a fade-out has completed.
+   * @return True if the node's output is silent after a fade-out.
+   */
+  bool isFadeOutComplete() const { return envelope_.isSilent(); }
+
+  /**
+   * @brief Returns true if the node is bypassed in its graph.
+   * @return True if bypassed (see GraphManager::setBypassed()).
+   */
+  bool isBypassed() const { return bypassed_; }
+
+  /**
+   * @brief Returns true if processControl() runs every block.
+   * @return True if the node opted out of change-driven control processing.
+   */
+  bool getProcessControlEveryBlock() const { return processControlEveryBlock_; }
+
+  /**
+   * @brief Opts the node out of change-driven control processing.
+   * By default the GraphManager only calls processControl() when one of the
+   * node's control inputs or parameters changed (and once after each graph
+   * edit). Nodes
+   * whose control outputs change on their own, such as LFOs or envelope
+   * followers, must enable this.
+   * @param everyBlock True to call processControl() every block.
+   */
+  void setProcessControlEveryBlock(bool everyBlock) {
+    processControlEveryBlock_ = everyBlock;
   }
 
   /**
@@ -158,9 +314,9 @@ public:
   virtual void prepare(int sampleRate, int blockSize) {
     sampleRate_ = sampleRate;
     blockSize_ = blockSize;
-    updateFadeInSamples();
-    currentFadeInSample_ = 0;
-    fadeInActive_ = (fadeInDurationMs_ > 0.0f);
+    for (auto &smoother : smoothers_) {
+      smoother.prepare(sampleRate, blockSize);
+    }
   }
 
   /**
@@ -174,32 +330,164 @@ public:
 
   /**
    * @brief Processes control data for the Node.
-   * Subclasses can override this to handle control data.
-   * @param inputControls A map of input control values.
-   * @param outputControls A map to store output control values.
+   * Subclasses can override this to handle control data. Called once per
+   * block, before processEvent() and process(); ports are indexed in
+   * declaration order among the Node's control ports.
+   * @param inputControls The values of the control input ports.
+   * @param outputControls The control output ports to write.
    */
-  virtual void processControl(
-      const std::unordered_map<std::string, ControlValue> &inputControls,
-      std::unordered_map<std::string, ControlValue> &outputControls) {}
+  virtual void processControl(const ControlInputs &inputControls,
+                              ControlOutputs &outputControls) {}
+
   /**
    * @brief Processes events for the Node.
-   * Subclasses can override this to handle events.
-   * @param inputEvents A map of input events.
-   * @param outputEvents A map to store output events.
+   * Subclasses can override this to handle events. Called once per block,
+   * before process(); ports are indexed in declaration order among the
+   * Node's event ports.
+   * @param inputEvents One span per event input port, ordered by
+   * sampleOffset.
+   * @param outputEvents One queue per event output port; cleared before the
+   * call. Pushing never allocates.
    */
-  virtual void processEvent(
-      const std::unordered_map<std::string, Event> &inputEvents,
-      std::unordered_map<std::string, Event> &outputEvents) {}
+  virtual void processEvent(const EventSpan *inputEvents,
+                            EventQueue *const *outputEvents) {}
+
+  /**
+   * @brief Signature of a batch entry point that processes several nodes of
+   * the same type in one call.
+   * @param nodes The nodes to process; all share the same batch entry point.
+   * @param count The number of nodes.
+   * @param inputs The audio inputs of each node, as passed to process().
+   * @param outputs The audio outputs of each node, as passed to process().
+   * @param nFrames The number of frames to process.
+   */
+  using BatchProcess = void (*)(Node *const *nodes, int count,
+                                const float *const *const *inputs,
+                                float **const *outputs, int nFrames);
+
+  /**
+   * @brief Returns the batch entry point of the Node, or nullptr if it is
+   * processed on its own.
+   */
+  BatchProcess getBatchProcess() const { return batchProcess_; }
+
+  /**
+   * @brief Returns the precision of the Node's audio buffers: Float64 for
+   * DoubleNode subclasses, Float32 otherwise.
+   */
+  SampleType getSampleType() const { return sampleType_; }
+
+  /**
+   * @brief Returns the delay the Node adds between its audio inputs and
+   * outputs, in samples. Valid after prepare().
+   */
+  int getLatency() const { return latency_; }
+
+  /** Tail length of nodes that must keep running forever (the default). */
+  static constexpr int kInfiniteTail = -1;
+
+  /**
+   * @brief Returns how long the Node keeps producing output after its
+   * inputs go silent, in samples, or kInfiniteTail.
+   */
+  int getTailLength() const { return tailLength_; }
 
 protected:
   /**
-   * @brief Applies fade-in envelope to an audio buffer
-   * Subclasses should call this at the end of process() on their output buffers
+   * @brief Declares a batch entry point for the Node's type.
+   * The GraphManager hands all nodes sharing the entry point that sit at the
+   * same depth of the graph (so none feeds another) to a single call,
+   * instead of calling process() on each; the implementation can then
+   * vectorize across instances. Control and event processing, fades and
+   * bypass still happen per node.
+   * @param batchProcess The entry point, or nullptr to disable batching.
+   */
+  void setBatchProcess(BatchProcess batchProcess) {
+    batchProcess_ = batchProcess;
+  }
+
+  /**
+   * @brief Declares the Node's latency, typically from prepare().
+   * GraphManager::getLatency() adds it up along audio paths; other paths
+   * are not delayed to compensate.
+   * @param samples The delay in samples.
+   */
+  void setLatency(int samples) { latency_ = samples; }
+
+  /**
+   * @brief Declares the Node's tail, from the constructor or prepare().
+   * A GraphManager stops calling process() once the Node's audio inputs
+   * have been silent for longer than the tail and its outputs have decayed
+   * below the sleep threshold, and resumes as soon as input or events
+   * arrive. Stateless nodes declare 0; reverbs and delays their decay
+   * time. Sources and nodes that must always run keep kInfiniteTail.
+   *
+   * Whether the Node may sleep at all is decided when the graph compiles
+   * its plan, from the tail at that time. A finite tail may then change
+   * from process() (say, when the decay time changes); the graph reads it
+   * every block, and a change to kInfiniteTail keeps the Node awake.
+   * @param samples The tail in samples, or kInfiniteTail.
+   */
+  void setTailLength(int samples) { tailLength_ = samples; }
+
+  /**
+   * @brief Applies the fade envelope to an audio buffer.
+   * Nodes owned by a GraphManager get the envelope applied to all their
+   * outputs automatically, so this does nothing for them; call it at the end
+   * of process() only when driving a node directly.
    * @param buffer The audio buffer to apply fade-in to.
    * @param nFrames The number of frames in the buffer.
    */
   void applyFadeIn(float *buffer, int nFrames);
 
+  /**
+   * @brief Declares a parameter, typically from the subclass constructor.
+   * Declaring a name twice updates the value and returns the existing handle.
+   * @param name The name of the parameter.
+   * @param value The initial value of the parameter.
+   * @return A stable handle for O(1) access to the parameter.
+   */
+  ParamHandle addParam(const std::string &name, const ControlValue &value) {
+    ParamHandle existing = findParam(name);
+    if (existing.isValid()) {
+      params_[existing.index].value = value;
+      return existing;
+    }
+    params_.emplace_back(name, value);
+    const int index = static_cast<int>(params_.size()) - 1;
+    paramIndex_.emplace(name, index);
+    return ParamHandle{index};
+  }
+
+  /**
+   * @brief Declares a float parameter whose changes are smoothed.
+   * setParam() then starts a ramp instead of snapping; process() reads the
+   * ramp through getSmoother(handle)->processBlock() or getNextValue().
+   * @param name The name of the parameter.
+   * @param value The initial value of the parameter.
+   * @param rampTimeMs The ramp time in milliseconds.
+   * @param type The ramp shape.
+   * @return A stable handle for O(1) access to the parameter.
+   */
+  ParamHandle addSmoothedParam(const std::string &name, float value,
+                               float rampTimeMs = 20.0f,
+                               SmoothingType type = SmoothingType::Linear) {
+    ParamHandle handle = addParam(name, value);
+    if (smootherIndex_.size() < params_.size()) {
+      smootherIndex_.resize(params_.size(), -1);
+    }
+    if (smootherIndex_[handle.index] < 0) {
+      smootherIndex_[handle.index] = static_cast<int>(smoothers_.size());
+      smoothers_.emplace_back(value, rampTimeMs, type);
+    } else {
+      SmoothedValue &smoother = smoothers_[smootherIndex_[handle.index]];
+      smoother.setRampTime(rampTimeMs);
+      smoother.setType(type);
+      smoother.setCurrentAndTarget(value);
+    }
+    return handle;
+  }
+
   /**
    * @brief Adds an input port to the Node.
    * @param name The name of the input port.
@@ -209,6 +497,26 @@ protected:
     inputPorts_.push_back(Port(name, type));
   }
 
+  /**
+   * @brief Adds a typed control input port to the Node.
+   * @param name The name of the input port.
+   * @param type The value type of the port.
+   * @param defaultValue The value of the port while unconnected.
+   */
+  void addControlInputPort(const std::string &name, ControlType type,
+                           ControlSlot defaultValue = ControlSlot::fromInt(0)) {
+    inputPorts_.push_back(Port(name, type, defaultValue));
+  }
+
+  /**
+   * @brief Adds a typed control output port to the Node.
+   * @param name The name of the output port.
+   * @param type The value type of the port.
+   */
+  void addControlOutputPort(const std::string &name, ControlType type) {
+    outputPorts_.push_back(Port(name, type, ControlSlot::fromInt(0)));
+  }
+
   /**
    * @brief Adds an output port to the Node.
    * @param name The name of the output port.
@@ -239,28 +547,82 @@ protected:
   int blockSize_ = 512;
 
 private:
+  friend class GraphManager;
+  template <typename Derived> friend class StaticNode;
+  friend class DoubleNode;
+
   /** The unique identifier of the Node. */
   const std::string id_;
 
+  /** The graph this Node belongs to (set by GraphManager::createNode). */
+  GraphManager *graph_ = nullptr;
+
   /** The list of parameters associated with the Node. */
   std::vector<Param> params_;
 
+  /** Maps parameter names to their index in params_. */
+  std::unordered_map<std::string, int> paramIndex_;
+
+  /** Smoothers for parameters declared with addSmoothedParam(). */
+  std::vector<SmoothedValue> smoothers_;
+
+  /** Index into smoothers_ per parameter (-1 = not smoothed). */
+  std::vector<int> smootherIndex_;
+
   /** The duration of the fade-in effect in milliseconds. */
   float fadeInDurationMs_ = 50.0f;
-  /** The number of samples over which the fade-in effect occurs. */
-  int fadeInSamples_ = 0;
-  /** The current sample index within the fade-in effect. */
-  int currentFadeInSample_ = 0;
-  /** Flag indicating whether the fade-in effect is active. */
-  bool fadeInActive_ = false;
+  /** The duration of the fade-out effect in milliseconds. */
+  float fadeOutDurationMs_ = 50.0f;
+  /** The curve used for fades. */
+  FadeCurve fadeCurve_ = FadeCurve::Linear;
+  /** The fade envelope applied to the node's outputs. */
+  GainEnvelope envelope_;
+
+  /** True while the node is bypassed in its graph. */
+  bool bypassed_ = false;
+  /** True while fades crossfade against the node's inputs (bypass). */
+  bool fadeAgainstDry_ = false;
+  /** True once removal was requested and the node is fading out. */
+  bool retiring_ = false;
+
+  /** True if processControl() must run every block. */
+  bool processControlEveryBlock_ = false;
+
+  /** Set by setParam() so the next block re-runs processControl(). */
+  std::atomic<bool> paramsChanged_{false};
+
+  /** Type key of StaticNode subclasses (nullptr for dynamic nodes). */
+  const void *staticType_ = nullptr;
+
+  /** Batch entry point shared by nodes of the same type, or nullptr. */
+  BatchProcess batchProcess_ = nullptr;
+
+  /** Delay between the node's audio inputs and outputs, in samples. */
+  int latency_ = 0;
+
+  /** Output duration after the inputs go silent, or kInfiniteTail. */
+  int tailLength_ = kInfiniteTail;
+
+  /** Precision of the audio buffers (set by DoubleNode). */
+  SampleType sampleType_ = SampleType::Float32;
+
+  /**
+   * @brief Rebuilds the name-to-index map after params_ was replaced.
+   */
+  void rebuildParamIndex() {
+    paramIndex_.clear();
+    for (size_t i = 0; i < params_.size(); ++i) {
+      paramIndex_.emplace(params_[i].name, static_cast<int>(i));
+    }
+  }
 
   /**
-   * @brief Updates the number of samples for the fade-in effect based on the
-   * current duration and sample rate.
+   * @brief Converts a duration in milliseconds to samples at the current
+   * sample rate.
    */
-  void updateFadeInSamples() {
-    fadeInSamples_ = static_cast<int>((fadeInDurationMs_ / 1000.0f) *
-                                      static_cast<float>(sampleRate_));
+  int msToSamples(float durationMs) const {
+    return static_cast<int>((durationMs / 1000.0f) *
+                            static_cast<float>(sampleRate_));
   }
 };
 
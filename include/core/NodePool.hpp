@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @file NodePool.hpp
+ * @brief Per-graph arena that keeps node objects adjacent in memory.
+ */
+
+namespace ms {
+
+/**
+ * @brief Cache-line aligned bump allocator for node objects.
+ *
+ * Nodes are carved out of large chunks in the order they are created, so a
+ * graph built from sources to sinks ends up with each node's state next to
+ * the state of the node processed after it. Every block starts on its own
+ * cache line, so two nodes never share one. Freed blocks are kept on
+ * free lists keyed by size and alignment and reused by later nodes with
+ * the same layout, so a reused block is always aligned for its node.
+ *
+ * allocate() and deallocate() take a lock; they are meant for graph edits
+ * and node release, never for the audio thread.
+ */
+class NodePool {
+public:
+  /** Alignment and size granularity of every block. */
+  static constexpr size_t kCacheLineSize = 64;
+
+  /**
+   * @brief Constructs an empty pool.
+   * @param chunkSize The size of each chunk requested from the system.
+   */
+  explicit NodePool(size_t chunkSize = 64 * 1024);
+
+  ~NodePool();
+
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  /**
+   * @brief Allocates a block for one node.
+   * @param size The object size in bytes.
+   * @param alignment The object alignment; at least kCacheLineSize is used.
+   * @return Pointer to uninitialized storage.
+   */
+  void *allocate(size_t size, size_t alignment);
+
+  /**
+   * @brief Returns a block to the pool. The object must already be destroyed.
+   * @param block A pointer returned by allocate().
+   * @param size The size passed to allocate().
+   * @param alignment The alignment passed to allocate().
+   */
+  void deallocate(void *block, size_t size, size_t alignment);
+
+  /** @brief Returns the number of bytes currently handed out. */
+  size_t getBytesInUse() const;
+
+  /** @brief Returns the number of bytes reserved from the system. */
+  size_t getBytesReserved() const;
+
+private:
+  /** Rounds a request up to a whole number of cache lines. */
+  static size_t blockSize(size_t size, size_t alignment);
+
+  /** Allocated chunk with its size, released in the destructor. */
+  struct Chunk {
+    char *data;
+    size_t size;
+  };
+
+  mutable std::mutex mutex_;
+  size_t chunkSize_;
+  std::vector<Chunk> chunks_;
+  /** Bump pointer into the newest chunk, and its end. */
+  char *cursor_ = nullptr;
+  char *end_ = nullptr;
+  /** Freed blocks keyed by block size and alignment. */
+  std::map<std::pair<size_t, size_t>, std::vector<void *>> freeBlocks_;
+  size_t bytesInUse_ = 0;
+  size_t bytesReserved_ = 0;
+};
+
+} // namespace ms
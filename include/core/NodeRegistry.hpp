@@ -0,0 +1,105 @@
+#pragma once
+#include "Node.hpp"
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file NodeRegistry.hpp
+ * @brief Process-wide table of node types that can be created by name.
+ */
+
+namespace ms {
+
+/**
+ * @brief Maps node type names to factories.
+ *
+ * The BuiltinNodeTypes are always registered. Other node types register
+ * themselves once (usually with MS_REGISTER_NODE in their source file);
+ * GraphManager::createNode(id, typeName) then
+ * constructs them in the graph's NodePool instead of on the general heap.
+ */
+class NodeRegistry {
+public:
+  /** @brief Constructs a node of the registered type in place. */
+  using Constructor = Node *(*)(void *memory, const std::string &id);
+
+  /** @brief Everything needed to place a node type in a pool. */
+  struct Entry {
+    Constructor construct = nullptr;
+    size_t size = 0;
+    size_t alignment = 0;
+  };
+
+  /** @brief Returns the process-wide registry. */
+  static NodeRegistry &instance();
+
+  /**
+   * @brief Registers a node type.
+   * @param typeName The name used by GraphManager::createNode().
+   * @param entry The factory and layout of the type.
+   * @return False if the name is already registered.
+   */
+  bool add(const std::string &typeName, const Entry &entry);
+
+  /**
+   * @brief Registers a node type constructible from its id.
+   * @tparam T A Node subclass with a T(const std::string &id) constructor.
+   * @param typeName The name used by GraphManager::createNode().
+   * @return False if the name is already registered.
+   */
+  template <typename T> bool add(const std::string &typeName) {
+    static_assert(std::is_base_of<Node, T>::value,
+                  "registered types must derive from Node");
+    Entry entry;
+    entry.construct = [](void *memory, const std::string &id) -> Node * {
+      return new (memory) T(id);
+    };
+    entry.size = sizeof(T);
+    entry.alignment = alignof(T);
+    return add(typeName, entry);
+  }
+
+  /**
+   * @brief Looks up a node type.
+   * @param typeName The registered name.
+   * @param entry Receives the entry if found.
+   * @return True if the type is registered.
+   */
+  bool find(const std::string &typeName, Entry &entry) const;
+
+  /** @brief Returns the names of all registered types. */
+  std::vector<std::string> getTypeNames() const;
+
+private:
+  /** Registers the BuiltinNodeTypes. */
+  NodeRegistry();
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+/**
+ * @brief Registers T under a name during static initialization.
+ */
+template <typename T> struct NodeRegistrar {
+  explicit NodeRegistrar(const char *typeName) {
+    NodeRegistry::instance().add<T>(typeName);
+  }
+};
+
+} // namespace ms
+
+/**
+ * @brief Registers a node type by name from its source file.
+ *
+ * When MilliSuonoLib is linked statically, a source file whose symbols are
+ * never referenced is dropped together with its registration; such types
+ * can be registered explicitly with NodeRegistry::instance().add<T>().
+ */
+#define MS_REGISTER_NODE(Type, typeName)                                       \
+  static const ::ms::NodeRegistrar<Type> msNodeRegistrar_##Type(typeName)
@@ -0,0 +1,100 @@
+#pragma once
+#include "StaticNode.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file OscillatorBankNode.hpp
+ * @brief Declares the built-in node that renders many oscillators at once.
+ */
+
+namespace ms {
+
+/**
+ * @brief Waveform shared by all oscillators of an OscillatorBankNode.
+ */
+enum class OscillatorWaveform {
+  /** Polynomial sine (error below -120 dB). */
+  Sine,
+  /** Rising sawtooth, band-limited with PolyBLEP. */
+  Saw,
+  /** 50% square, band-limited with PolyBLEP. */
+  Square
+};
+
+/**
+ * @brief Renders a bank of oscillators and outputs their mix.
+ *
+ * The oscillators are stored as structure-of-arrays (phases, increments and
+ * amplitudes in separate arrays) and rendered four per SIMD vector, so one
+ * process() call advances the whole bank. Phases are 32-bit fixed-point
+ * accumulators that wrap without a branch.
+ *
+ * Ports: control inputs "freq<k>" (Hz, default 440) and "amp<k>" (linear,
+ * default 1/numOscillators) for each oscillator k, in that order; audio
+ * output "out". The Int parameter "waveform" selects an
+ * OscillatorWaveform. Amplitude changes ramp over one block; frequencies
+ * are clamped to [0, sampleRate / 2).
+ */
+class OscillatorBankNode : public StaticNode<OscillatorBankNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "oscillator_bank";
+
+  /**
+   * @brief Constructs a bank.
+   * @param id The unique string identifier for the Node.
+   * @param numOscillators The number of oscillators (at least 1).
+   * @param waveform The initial value of the "waveform" parameter.
+   */
+  explicit OscillatorBankNode(
+      const std::string &id, int numOscillators = 16,
+      OscillatorWaveform waveform = OscillatorWaveform::Sine);
+
+  /** @brief Returns the number of oscillators. */
+  int getNumOscillators() const { return numOscillators_; }
+
+  void prepare(int sampleRate, int blockSize) override;
+  void processControl(const ControlInputs &inputControls,
+                      ControlOutputs &outputControls) override;
+
+  /** @brief Renders the mix. */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    (void)inputs;
+    render(outputs[0], nFrames);
+  }
+
+private:
+  /** Recomputes the phase increment of oscillator k for the sample rate. */
+  void updateIncrement(int k);
+
+  /** Renders all oscillators with the current waveform. */
+  void render(float *out, int nFrames);
+
+  /** Renders all oscillators with Wave (see OscillatorBankNode.cpp). */
+  template <typename Wave> void renderWith(float *out, int nFrames);
+
+  int numOscillators_;
+  ParamHandle waveform_;
+  OscillatorWaveform activeWaveform_;
+
+  /**
+   * Per-oscillator state, padded to a multiple of four with silent
+   * oscillators.
+   */
+  std::vector<uint32_t> phases_;
+  std::vector<uint32_t> increments_;
+  std::vector<float> frequencies_;
+  /** Phase increment in cycles per sample, and its reciprocal (PolyBLEP). */
+  std::vector<float> steps_;
+  std::vector<float> inverseSteps_;
+  std::vector<float> amplitudes_;
+  std::vector<float> targetAmplitudes_;
+
+  /** Four partial mixes per frame, one per SIMD lane. */
+  std::vector<float> laneMix_;
+};
+
+} // namespace ms
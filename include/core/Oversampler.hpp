@@ -0,0 +1,161 @@
+#pragma once
+#include <vector>
+
+/**
+ * @file Oversampler.hpp
+ * @brief Multi-channel 2x/4x/8x up- and downsampling with half-band filter
+ * cascades.
+ */
+
+namespace ms {
+
+/**
+ * @brief Filter family used by an Oversampler.
+ */
+enum class OversamplingFilter {
+  /** Symmetric half-band FIRs: no phase distortion, higher latency. */
+  LinearPhase,
+  /**
+   * Polyphase allpass (IIR) half-bands: minimum-phase-like response with a
+   * few samples of latency, at the cost of phase distortion near Nyquist.
+   */
+  MinimumPhase
+};
+
+/**
+ * @brief Converts planar audio to 2, 4 or 8 times its sample rate and back.
+ *
+ * Each factor of two is one stage of a cascade; the first stage, which
+ * sees the full band, gets the steepest filter. Filter coefficients are
+ * designed in the constructor and all state and scratch buffers are
+ * allocated in prepare(), so upsample() and downsample() never allocate.
+ *
+ * FIR stages are polyphase: the zero taps of the half-band filter are
+ * skipped and the remaining ones are evaluated four at a time. IIR stages
+ * process four channels per SIMD vector.
+ */
+class Oversampler {
+public:
+  /** Largest supported factor. */
+  static constexpr int kMaxFactor = 8;
+
+  /**
+   * @brief Constructs an oversampler.
+   * @param factor 1, 2, 4 or 8; other values are rounded down to one of
+   * these.
+   * @param filter The filter family.
+   */
+  explicit Oversampler(int factor,
+                       OversamplingFilter filter = OversamplingFilter::LinearPhase);
+
+  /**
+   * @brief Allocates state and buffers and clears the filters.
+   * @param numInputs Number of channels passed to upsample().
+   * @param numOutputs Number of channels produced by downsample().
+   * @param maxFrames Largest block, in base-rate frames.
+   * @param pathLatency Latency, in oversampled samples, of the processing
+   * between upsample() and downsample().
+   */
+  void prepare(int numInputs, int numOutputs, int maxFrames,
+               int pathLatency = 0);
+
+  /** @brief Clears the filter state. */
+  void reset();
+
+  /** @brief Returns the oversampling factor. */
+  int getFactor() const { return factor_; }
+
+  /** @brief Returns the filter family. */
+  OversamplingFilter getFilter() const { return filter_; }
+
+  /**
+   * @brief Returns the delay of a round trip through upsample(), the path
+   * and downsample() at low frequencies, in whole base-rate samples. The
+   * filters alone delay by a fraction of a sample in 4x and 8x cascades
+   * (and with a path latency that is not a multiple of the factor), so
+   * downsample() delays its input by the rest, at the oversampled rate.
+   * Exact for LinearPhase; MinimumPhase delay varies with frequency.
+   */
+  int getLatency() const { return latency_; }
+
+  /**
+   * @brief Upsamples a block.
+   * @param inputs numInputs planar channels of nFrames samples.
+   * @param nFrames Number of base-rate frames (at most maxFrames).
+   * @return numInputs channels of nFrames * getFactor() samples, valid
+   * until the next call.
+   */
+  const float *const *upsample(const float *const *inputs, int nFrames);
+
+  /**
+   * @brief Returns the numOutputs oversampled buffers (maxFrames *
+   * getFactor() samples each) that downsample() reads.
+   */
+  float **getOversampledOutputs() { return outputPointers_.data(); }
+
+  /**
+   * @brief Downsamples the oversampled output buffers.
+   * @param outputs numOutputs planar channels receiving nFrames samples.
+   * @param nFrames Number of base-rate frames (at most maxFrames).
+   */
+  void downsample(float **outputs, int nFrames);
+
+private:
+  /** Filter of one 2x stage, shared by all channels and both directions. */
+  struct Stage {
+    /** FIR: the non-zero taps of one polyphase branch (symmetric). */
+    std::vector<float> taps;
+    /** IIR: allpass coefficients, alternating between the two branches. */
+    std::vector<float> coefs;
+    /** Round-trip delay of the stage, in samples at its lower rate. */
+    double latency = 0.0;
+  };
+
+  /**
+   * Memory of one stage in one direction. FIR: one channel, as doubled
+   * ring buffers so the last taps.size() samples are always contiguous.
+   * IIR: four channels, one per lane.
+   */
+  struct FilterState {
+    std::vector<float> history;
+    std::vector<float> odd;
+    int pos = 0;
+    std::vector<float> x;
+    std::vector<float> y;
+  };
+
+  /**
+   * Per-direction state: filters[stage * numStates + state] plus two
+   * ping-pong buffers per channel.
+   */
+  struct Direction {
+    int numChannels = 0;
+    int numStates = 0;
+    std::vector<FilterState> filters;
+    std::vector<std::vector<float>> buffers[2];
+  };
+
+  void prepareDirection(Direction &direction, int numChannels, int maxFrames);
+  void resetDirection(Direction &direction);
+
+  int factor_;
+  int numStages_;
+  OversamplingFilter filter_;
+  /** Round-trip delay of the filters, in oversampled samples. */
+  double filterLatency_ = 0.0;
+  int latency_ = 0;
+  /** Delay added before downsampling, in oversampled samples. */
+  int padLength_ = 0;
+  /** The last padLength_ samples of each output channel, and scratch. */
+  std::vector<std::vector<float>> padState_;
+  std::vector<float> padScratch_;
+  std::vector<Stage> stages_;
+  Direction up_;
+  Direction down_;
+  std::vector<const float *> stageInputs_;
+  std::vector<float *> stageOutputs_;
+  std::vector<const float *> upsampledPointers_;
+  std::vector<float *> outputPointers_;
+};
+
+} // namespace ms
@@ -0,0 +1,87 @@
+#pragma once
+#include "EventQueue.hpp"
+#include "Node.hpp"
+#include "Oversampler.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @file OversamplingNode.hpp
+ * @brief Declares the adaptor that runs another node at a multiple of the
+ * graph's sample rate.
+ */
+
+namespace ms {
+
+/**
+ * @brief Runs a wrapped node at 2x, 4x or 8x the graph's sample rate.
+ *
+ * Nonlinear nodes (distortion, waveshaping) create harmonics above Nyquist
+ * that fold back as aliasing; running them oversampled and filtering
+ * before decimation removes most of it. The adaptor exposes the wrapped
+ * node's ports and parameters under its own id:
+ * - audio inputs are upsampled, and audio outputs downsampled, by an
+ *   Oversampler;
+ * - the wrapped node is prepared at the higher rate and block size;
+ * - control ports are passed through, and event offsets are scaled;
+ * - parameter changes made on the adaptor are forwarded before each
+ *   process() call, so scheduled changes keep their timing.
+ *
+ * The latency of the filters plus the wrapped node's own latency (scaled
+ * to the graph's rate) is reported through getLatency(); the tail is the
+ * wrapped node's, scaled, plus the ringing of the filters.
+ */
+class OversamplingNode : public Node {
+public:
+  /** Events per port and block the adaptor can forward. */
+  static constexpr int kEventCapacity = 256;
+
+  /**
+   * @brief Wraps a node.
+   * @param id The unique string identifier for the Node.
+   * @param inner The node to oversample; it must not be added to a graph
+   * itself.
+   * @param factor 2, 4 or 8.
+   * @param filter The filter family of the resamplers.
+   */
+  OversamplingNode(const std::string &id, std::shared_ptr<Node> inner,
+                   int factor,
+                   OversamplingFilter filter = OversamplingFilter::LinearPhase);
+
+  /** @brief Returns the wrapped node. */
+  Node *getInner() const { return inner_.get(); }
+
+  /** @brief Returns the oversampling factor. */
+  int getFactor() const { return oversampler_.getFactor(); }
+
+  void prepare(int sampleRate, int blockSize) override;
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) override;
+  void processControl(const ControlInputs &inputControls,
+                      ControlOutputs &outputControls) override;
+  void processEvent(const EventSpan *inputEvents,
+                    EventQueue *const *outputEvents) override;
+
+private:
+  /** Copies the parameters changed since the last call to the inner node. */
+  void forwardParams();
+
+  std::shared_ptr<Node> inner_;
+  Oversampler oversampler_;
+  int numAudioInputs_ = 0;
+  int numAudioOutputs_ = 0;
+
+  /** Parameter values last forwarded to the inner node. */
+  std::vector<ControlValue> forwardedParams_;
+
+  /** Input events with offsets scaled to the inner rate, per port. */
+  std::vector<Event> inputEventStorage_;
+  std::vector<EventSpan> inputSpans_;
+  /** Queues the inner node writes its output events to. */
+  std::vector<Event> outputEventStorage_;
+  std::vector<EventQueue> outputQueues_;
+  std::vector<EventQueue *> outputQueuePointers_;
+};
+
+} // namespace ms
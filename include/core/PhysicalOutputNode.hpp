@@ -0,0 +1,49 @@
+#pragma once
+#include "Node.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @file PhysicalOutputNode.hpp
+ * @brief Declares the sink node that routes graph audio to device channels.
+ */
+
+namespace ms {
+
+/**
+ * @brief Sink node bound to one or more physical output channels.
+ *
+ * Each audio input port ("in0", "in1", ...) is bound to a device channel.
+ * The node itself does not copy anything: on the last stage of the plan the
+ * GraphManager reads the buffers connected to these inputs and interleaves
+ * and converts them straight into the playback buffer.
+ */
+class PhysicalOutputNode : public Node {
+public:
+  /**
+   * @brief Constructs a sink bound to the given device channels.
+   * @param id The unique string identifier for the Node.
+   * @param deviceChannels Device channel index for each input port, in port
+   * order (e.g. {0, 1} for a stereo pair).
+   */
+  PhysicalOutputNode(const std::string &id,
+                     const std::vector<int> &deviceChannels);
+
+  /**
+   * @brief Returns the device channel bound to each input port.
+   * @return A const reference to the vector of device channel indices.
+   */
+  const std::vector<int> &getDeviceChannels() const { return deviceChannels_; }
+
+  /**
+   * @brief Does nothing; the GraphManager writes the device buffer directly.
+   */
+  void process(const float *const * /*inputs*/, float ** /*outputs*/,
+               int /*nFrames*/) override {}
+
+private:
+  /** Device channel index for each input port. */
+  std::vector<int> deviceChannels_;
+};
+
+} // namespace ms
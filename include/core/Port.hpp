@@ -1,6 +1,9 @@
 #pragma once
+#include "ControlValue.hpp"
+#include "Symbol.hpp"
+#include <cstdint>
 #include <string>
-#include <variant>
+#include <type_traits>
 
 /**
  * @file Port.hpp
@@ -17,51 +20,103 @@ namespace ms {
  * @brief Defines the possible types of ports in the MilliSuono system.
  *
  * - Audio: for audio signal connections
- * - Control: for control parameters (float, int, bool, string)
+ * - Control: for control values (float, int or bool, see ControlType);
+ *   strings travel only as parameters and event values
  * - Event: for time-stamped control or trigger events
  */
 enum class PortType { Audio, Control, Event };
 
 /**
- * @brief Represents the value carried by a control or event port.
+ * @brief Defines the value type carried by a control port.
  *
- * This can be one of the following:
- * - float: for continuous parameters (e.g., gain, frequency)
- * - int: for discrete parameters or indices
- * - bool: for binary control signals (e.g., mute, toggle)
- * - std::string: for symbolic or textual data
+ * Control ports are resolved to fixed 4-byte slots when the graph is
+ * compiled, so only fixed-size types are supported:
+ * - Float: continuous values (e.g., gain, frequency)
+ * - Int: discrete values or indices
+ * - Bool: binary switches (e.g., mute, toggle)
  */
-using ControlValue = std::variant<float, int, bool, std::string>;
+enum class ControlType { Float, Int, Bool };
+
+/**
+ * @brief Storage for one control port value.
+ *
+ * Float ports use f; Int and Bool ports use i (bools are stored as 0 or 1),
+ * so two slots holding the same value are bitwise equal.
+ */
+union ControlSlot {
+  /** Value of a Float port. */
+  float f;
+  /** Value of an Int or Bool port. */
+  int32_t i;
+
+  /** @brief Builds a slot holding a float. */
+  static ControlSlot fromFloat(float value) {
+    ControlSlot slot;
+    slot.f = value;
+    return slot;
+  }
+
+  /** @brief Builds a slot holding an int. */
+  static ControlSlot fromInt(int32_t value) {
+    ControlSlot slot;
+    slot.i = value;
+    return slot;
+  }
+
+  /** @brief Builds a slot holding a bool. */
+  static ControlSlot fromBool(bool value) { return fromInt(value ? 1 : 0); }
+};
 
 /**
  * @brief Represents a time-stamped event in the audio processing timeline.
  *
  * Events are typically generated by control sources (e.g., user interaction,
  * automation, or MIDI input) and scheduled at a specific sample offset within
- * a processing block.
+ * a processing block. Events are 24 bytes and trivially copyable, so event
+ * queues stay cache-dense and never allocate.
  */
 struct Event {
   /** Type or category of the event (e.g., "note_on", "param_change"). */
-  std::string type;
+  Symbol type;
+
+  /** The sample offset within the current processing block at which the event
+   * occurs. */
+  int32_t sampleOffset;
 
   /** The event payload, which can be any supported ControlValue type. */
   ControlValue value;
 
-  /** The sample offset within the current processing block at which the event
-   * occurs. */
-  int sampleOffset;
+  /**
+   * @brief Constructs an empty Event (used to preallocate event storage).
+   */
+  Event() : sampleOffset(0) {}
 
   /**
    * @brief Constructs an Event object.
+   * @param type The event type symbol.
+   * @param value The payload associated with the event.
+   * @param sampleOffset The sample index relative to the start of the
+   * processing block.
+   */
+  Event(Symbol type, const ControlValue &value, int sampleOffset)
+      : type(type), sampleOffset(sampleOffset), value(value) {}
+
+  /**
+   * @brief Constructs an Event object, interning the type name.
+   * Interning may lock; prefer the Symbol overload on the audio thread.
    * @param type The event type identifier.
    * @param value The payload associated with the event.
    * @param sampleOffset The sample index relative to the start of the
    * processing block.
    */
-  Event(const std::string &type, const ControlValue &value, int sampleOffset)
-      : type(type), value(value), sampleOffset(sampleOffset) {}
+  Event(std::string_view type, const ControlValue &value, int sampleOffset)
+      : Event(Symbol::intern(type), value, sampleOffset) {}
 };
 
+static_assert(sizeof(Event) == 24, "Event must stay 24 bytes");
+static_assert(std::is_trivially_copyable<Event>::value,
+              "Event must be trivially copyable");
+
 /**
  * @brief Represents an input or output port of a Node.
  *
@@ -75,12 +130,29 @@ struct Port {
   /** The type of the port (Audio, Control, or Event). */
   PortType type;
 
+  /** The value type of a Control port (ignored for other port types). */
+  ControlType controlType = ControlType::Float;
+
+  /** The value of an unconnected Control input port. */
+  ControlSlot defaultValue = ControlSlot::fromInt(0);
+
   /**
    * @brief Constructs a Port object.
    * @param name The name identifying the port.
    * @param type The port type (Audio, Control, or Event).
    */
   Port(const std::string &name, PortType type) : name(name), type(type) {}
+
+  /**
+   * @brief Constructs a typed Control port.
+   * @param name The name identifying the port.
+   * @param controlType The value type of the port.
+   * @param defaultValue The value of the port while unconnected.
+   */
+  Port(const std::string &name, ControlType controlType,
+       ControlSlot defaultValue)
+      : name(name), type(PortType::Control), controlType(controlType),
+        defaultValue(defaultValue) {}
 };
 
 } // namespace ms
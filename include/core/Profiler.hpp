@@ -0,0 +1,226 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifndef MS_PROFILING
+/** Set to 0 (-DMILLISUONO_PROFILING=OFF) to compile the profiler out. */
+#define MS_PROFILING 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if MS_PROFILING
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MS_PROFILING_RDTSC 1
+#ifndef _MSC_VER
+#include <x86intrin.h>
+#endif
+#else
+#include <time.h>
+#endif
+#endif
+
+/**
+ * @file Profiler.hpp
+ * @brief Per-node timing counters recorded by the GraphManager's process
+ * loop.
+ */
+
+namespace ms {
+
+/**
+ * @brief Cheap monotonic timestamps for the profiler.
+ *
+ * Uses the time-stamp counter on x86 and CLOCK_MONOTONIC_RAW elsewhere.
+ * Tick lengths are calibrated against the system clock when a snapshot is
+ * taken.
+ */
+struct ProfileClock {
+  /** @brief Returns the current tick count. */
+  static uint64_t now() {
+#if !MS_PROFILING
+    return 0;
+#elif MS_PROFILING_RDTSC
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+           static_cast<uint64_t>(ts.tv_nsec);
+#endif
+  }
+};
+
+/**
+ * @brief Call count and min/total/max duration of one kind of call.
+ *
+ * Written by the audio thread only, read by snapshot readers; every field is
+ * an independent relaxed atomic, so neither side ever blocks.
+ */
+struct ProfileCounter {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> totalTicks{0};
+  std::atomic<uint64_t> minTicks{UINT64_MAX};
+  std::atomic<uint64_t> maxTicks{0};
+
+  /** @brief Records one call. Audio thread only. */
+  void record(uint64_t ticks) {
+    // Single writer: plain load/store pairs avoid locked instructions.
+    calls.store(calls.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    totalTicks.store(totalTicks.load(std::memory_order_relaxed) + ticks,
+                     std::memory_order_relaxed);
+    if (ticks < minTicks.load(std::memory_order_relaxed)) {
+      minTicks.store(ticks, std::memory_order_relaxed);
+    }
+    if (ticks > maxTicks.load(std::memory_order_relaxed)) {
+      maxTicks.store(ticks, std::memory_order_relaxed);
+    }
+  }
+
+  /** @brief Clears the counter. */
+  void reset() {
+    calls.store(0, std::memory_order_relaxed);
+    totalTicks.store(0, std::memory_order_relaxed);
+    minTicks.store(UINT64_MAX, std::memory_order_relaxed);
+    maxTicks.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Timing and signal counters of one node.
+ *
+ * process() durations also go into a log-linear histogram (four bins per
+ * octave of ticks) from which percentiles are estimated. The signal
+ * counters are filled by the GraphManager's output check.
+ */
+struct NodeProfile {
+  /** Number of histogram bins; covers the full 64-bit tick range. */
+  static constexpr int kHistogramBins = 256;
+
+  /** The id of the profiled node. */
+  std::string nodeId;
+  ProfileCounter process;
+  ProfileCounter control;
+  ProfileCounter event;
+  std::atomic<uint32_t> histogram[kHistogramBins] = {};
+  /** Subnormal output samples seen by the output check. */
+  std::atomic<uint64_t> subnormalSamples{0};
+  /** NaN or infinite output samples seen by the output check. */
+  std::atomic<uint64_t> nonFiniteSamples{0};
+  /**
+   * Blocks in which this node was the first, in processing order, to
+   * output a NaN or infinite sample; i.e. where it produced rather than
+   * passed on the fault.
+   */
+  std::atomic<uint64_t> nonFiniteOrigins{0};
+
+  /** @brief Returns the histogram bin of a duration. */
+  static int binOf(uint64_t ticks) {
+    if (ticks < 4) {
+      return static_cast<int>(ticks);
+    }
+#if defined(_MSC_VER)
+    unsigned long msb;
+    _BitScanReverse64(&msb, ticks);
+    const int exponent = static_cast<int>(msb);
+#else
+    const int exponent = 63 - __builtin_clzll(ticks);
+#endif
+    return (exponent - 1) * 4 + static_cast<int>((ticks >> (exponent - 2)) & 3);
+  }
+
+  /** @brief Returns the smallest duration falling into a bin. */
+  static uint64_t binFloor(int bin) {
+    if (bin < 4) {
+      return static_cast<uint64_t>(bin);
+    }
+    return static_cast<uint64_t>(4 + bin % 4) << (bin / 4 - 1);
+  }
+
+  /** @brief Records one process() call. Audio thread only. */
+  void recordProcess(uint64_t ticks) {
+    process.record(ticks);
+    std::atomic<uint32_t> &bin = histogram[binOf(ticks)];
+    bin.store(bin.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Records the suspicious samples of one output check. Audio
+   * thread only.
+   * @param subnormal Number of subnormal samples.
+   * @param nonFinite Number of NaN or infinite samples.
+   * @param origin True if no earlier node output a non-finite sample in
+   * this block.
+   */
+  void recordFaults(uint64_t subnormal, uint64_t nonFinite, bool origin) {
+    subnormalSamples.store(
+        subnormalSamples.load(std::memory_order_relaxed) + subnormal,
+        std::memory_order_relaxed);
+    nonFiniteSamples.store(
+        nonFiniteSamples.load(std::memory_order_relaxed) + nonFinite,
+        std::memory_order_relaxed);
+    if (origin && nonFinite != 0) {
+      nonFiniteOrigins.store(
+          nonFiniteOrigins.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+    }
+  }
+
+  /** @brief Clears all counters. */
+  void reset() {
+    process.reset();
+    control.reset();
+    event.reset();
+    for (auto &bin : histogram) {
+      bin.store(0, std::memory_order_relaxed);
+    }
+    subnormalSamples.store(0, std::memory_order_relaxed);
+    nonFiniteSamples.store(0, std::memory_order_relaxed);
+    nonFiniteOrigins.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Snapshot of one node's timings, in nanoseconds.
+ */
+struct NodeProfileStats {
+  /** The id of the node. */
+  std::string nodeId;
+  /** Number of process() calls. */
+  uint64_t processCalls = 0;
+  double processMinNs = 0.0;
+  double processMeanNs = 0.0;
+  double processMaxNs = 0.0;
+  /** Percentiles estimated from the histogram. */
+  double processP50Ns = 0.0;
+  double processP90Ns = 0.0;
+  double processP99Ns = 0.0;
+  /** Number of processControl() calls, with mean and max duration. */
+  uint64_t controlCalls = 0;
+  double controlMeanNs = 0.0;
+  double controlMaxNs = 0.0;
+  /** Number of processEvent() calls, with mean and max duration. */
+  uint64_t eventCalls = 0;
+  double eventMeanNs = 0.0;
+  double eventMaxNs = 0.0;
+  /** Subnormal and NaN/infinite output samples (output check only). */
+  uint64_t subnormalSamples = 0;
+  uint64_t nonFiniteSamples = 0;
+  /** Blocks in which this node was the first to output NaN/infinity. */
+  uint64_t nonFiniteOrigins = 0;
+};
+
+/**
+ * @brief Converts a node's counters to a snapshot.
+ * @param profile The counters.
+ * @param nsPerTick The calibrated tick length.
+ * @return The snapshot.
+ */
+NodeProfileStats makeProfileStats(const NodeProfile &profile, double nsPerTick);
+
+} // namespace ms
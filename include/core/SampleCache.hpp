@@ -0,0 +1,219 @@
+#pragma once
+#include "SampleConversion.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file SampleCache.hpp
+ * @brief Process-wide cache of decoded audio files, shared between nodes.
+ */
+
+namespace ms {
+
+/**
+ * @brief Identifies a decoded sample: the same file decoded at another rate
+ * or format is another entry.
+ */
+struct SampleKey {
+  /** Path of the file, as passed to the decoder. */
+  std::string path;
+  /** Rate to resample to, in Hz, or 0 for the file's own rate. */
+  int sampleRate = 0;
+  /** Format to decode to: F32 or S16. */
+  SampleFormat format = SampleFormat::F32;
+
+  bool operator==(const SampleKey &other) const {
+    return path == other.path && sampleRate == other.sampleRate &&
+           format == other.format;
+  }
+};
+
+/**
+ * @brief A whole decoded file. Immutable once the cache hands it out, so
+ * any number of threads, including audio threads, may read it.
+ */
+struct DecodedSample {
+  SampleKey key;
+  /** The rate of the data, in Hz (the file's own if key.sampleRate is 0). */
+  int sampleRate = 0;
+  int channels = 0;
+  uint64_t frames = 0;
+  /** Interleaved frames; floats for F32, int16s for S16. */
+  std::vector<float> floats;
+  std::vector<int16_t> int16s;
+
+  /** @brief Returns the bytes of decoded data. */
+  size_t getBytes() const {
+    return floats.size() * sizeof(float) + int16s.size() * sizeof(int16_t);
+  }
+};
+
+/**
+ * @brief Hit rate, memory and decoding figures of a SampleCache.
+ */
+struct SampleCacheStats {
+  /** Requests served from memory. */
+  uint64_t hits = 0;
+  /** Requests that needed a decode, or joined one in progress. */
+  uint64_t misses = 0;
+  /** Requests whose file could not be decoded, or in an unsupported format. */
+  uint64_t failures = 0;
+  /** Entries dropped to stay within the budget. */
+  uint64_t evictions = 0;
+  /** Number of entries held. */
+  int entries = 0;
+  /** Bytes of decoded data held. */
+  size_t residentBytes = 0;
+  /** The byte budget. */
+  size_t budgetBytes = 0;
+  /** Bytes produced by all decodes, and the time they took, in seconds. */
+  uint64_t decodedBytes = 0;
+  double decodeSeconds = 0.0;
+
+  /** @brief Returns hits / (hits + misses), or 0 before any request. */
+  double hitRate() const {
+    const uint64_t requests = hits + misses;
+    return requests ? static_cast<double>(hits) / requests : 0.0;
+  }
+
+  /** @brief Returns the decode throughput, in bytes per second. */
+  double decodeBytesPerSecond() const {
+    return decodeSeconds > 0.0 ? decodedBytes / decodeSeconds : 0.0;
+  }
+};
+
+/**
+ * @brief Decodes audio files once and shares the result.
+ *
+ * Entries are keyed by SampleKey and handed out as shared pointers to
+ * immutable DecodedSamples, so nodes that load the same file share one
+ * copy. Misses are decoded with miniaudio on the cache's loader threads;
+ * concurrent requests for the same key wait for the same decode.
+ *
+ * The cache holds at most getBudget() bytes: after each decode, and on
+ * setBudget(), it drops least recently used entries until it fits. Entries
+ * still referenced outside the cache are skipped, since dropping them
+ * would free nothing and the next request would decode a second copy; the
+ * cache can therefore exceed its budget while in-use data alone does.
+ *
+ * All member functions are thread-safe, but take a lock: call them from
+ * control threads, never from the audio thread. Completion callbacks run
+ * on a loader thread (or on the calling thread for a hit) and must not
+ * call load().
+ */
+class SampleCache {
+public:
+  /** Receives the loaded sample, or nullptr if the file failed to decode. */
+  using Callback = std::function<void(std::shared_ptr<const DecodedSample>)>;
+
+  /** Default budget of instance(), in bytes. */
+  static constexpr size_t kDefaultBudget = size_t(512) << 20;
+
+  /** Default number of loader threads. */
+  static constexpr int kDefaultLoaders = 2;
+
+  /** @brief Returns the process-wide cache. */
+  static SampleCache &instance();
+
+  /**
+   * @brief Constructs an empty cache. Loader threads start on first use.
+   * @param budgetBytes The byte budget.
+   * @param numLoaders The number of loader threads (at least 1).
+   */
+  explicit SampleCache(size_t budgetBytes = kDefaultBudget,
+                       int numLoaders = kDefaultLoaders);
+
+  /**
+   * @brief Waits for the decodes in progress and stops the loaders; queued
+   * requests get nullptr.
+   */
+  ~SampleCache();
+
+  SampleCache(const SampleCache &) = delete;
+  SampleCache &operator=(const SampleCache &) = delete;
+
+  /**
+   * @brief Returns a cached sample without loading it. Counts as a hit if
+   * found; a miss is not counted.
+   */
+  std::shared_ptr<const DecodedSample> find(const SampleKey &key);
+
+  /**
+   * @brief Loads a sample in the background.
+   * @param key The sample to load.
+   * @param done Called once with the sample: at once on a hit, from a
+   * loader thread otherwise.
+   */
+  void loadAsync(const SampleKey &key, Callback done);
+
+  /**
+   * @brief Loads a sample and waits for it.
+   * @return The sample, or nullptr if the file failed to decode.
+   */
+  std::shared_ptr<const DecodedSample> load(const SampleKey &key);
+
+  /** @brief Sets the byte budget, evicting entries as needed. */
+  void setBudget(size_t budgetBytes);
+
+  /** @brief Returns the byte budget. */
+  size_t getBudget() const;
+
+  /** @brief Drops every entry not referenced outside the cache. */
+  void clear();
+
+  /** @brief Returns the current figures. */
+  SampleCacheStats getStats() const;
+
+private:
+  struct KeyHash {
+    size_t operator()(const SampleKey &key) const;
+  };
+
+  /** A resident sample and its place in the recency list. */
+  struct Entry {
+    std::shared_ptr<const DecodedSample> sample;
+    std::list<SampleKey>::iterator recency;
+  };
+
+  /** Decodes a file; returns nullptr on failure. */
+  static std::shared_ptr<DecodedSample> decode(const SampleKey &key);
+
+  /** Starts the loader threads, once. Called with mutex_ held. */
+  void startLoaders();
+
+  /** A loader thread: decodes queued keys and runs their callbacks. */
+  void loaderLoop();
+
+  /** Drops unreferenced entries, oldest first, down to the budget. */
+  void evict(size_t budgetBytes);
+
+  /** Moves an entry to the front of the recency list. */
+  void touch(Entry &entry);
+
+  int numLoaders_;
+  mutable std::mutex mutex_;
+  std::condition_variable queued_;
+  std::vector<std::thread> loaders_;
+  bool quit_ = false;
+
+  std::unordered_map<SampleKey, Entry, KeyHash> entries_;
+  /** Keys from most to least recently used. */
+  std::list<SampleKey> recency_;
+  /** Callbacks waiting for each key being decoded or queued. */
+  std::unordered_map<SampleKey, std::vector<Callback>, KeyHash> waiting_;
+  std::deque<SampleKey> queue_;
+
+  SampleCacheStats stats_;
+};
+
+} // namespace ms
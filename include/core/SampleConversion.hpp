@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @file SampleConversion.hpp
+ * @brief Conversion of planar float buffers into interleaved device buffers,
+ * and between single and double precision.
+ *
+ * The audio graph works on planar 32-bit float channels, while playback
+ * devices expect interleaved frames in the format negotiated with the
+ * backend. The functions declared here perform interleaving and format
+ * conversion in a single SIMD pass.
+ */
+
+namespace ms {
+
+/**
+ * @brief Sample formats supported for device output.
+ *
+ * The numeric values match miniaudio's ma_format so a device format can be
+ * converted with a static_cast.
+ */
+enum class SampleFormat { S16 = 2, S24 = 3, S32 = 4, F32 = 5 };
+
+/**
+ * @brief Returns the size in bytes of one sample in the given format.
+ * @param format The sample format.
+ * @return The number of bytes per sample (S24 is tightly packed).
+ */
+inline int bytesPerSample(SampleFormat format) {
+  switch (format) {
+  case SampleFormat::S16:
+    return 2;
+  case SampleFormat::S24:
+    return 3;
+  case SampleFormat::S32:
+  case SampleFormat::F32:
+    return 4;
+  }
+  return 4;
+}
+
+/**
+ * @brief State of the TPDF dither noise generator.
+ *
+ * Holds one xorshift32 generator per SIMD lane. Dither is only applied when
+ * converting to S16 or S24, where it decorrelates quantization error from
+ * the signal.
+ */
+struct DitherState {
+  /** Whether dither is added before quantization. */
+  bool enabled = false;
+
+  /** Per-lane generator state (must never be zero). */
+  uint32_t seeds[4] = {0x9E3779B9u, 0x7F4A7C15u, 0x85EBCA6Bu, 0xC2B2AE35u};
+};
+
+/**
+ * @brief Interleaves planar float channels into a device buffer.
+ *
+ * Samples are scaled, optionally dithered, clamped and rounded to the target
+ * format. Any channel count is supported; mono and stereo float output take
+ * dedicated fast paths.
+ *
+ * @param channels Array of numChannels planar buffers; nullptr entries
+ * produce silence on that device channel.
+ * @param numChannels The number of interleaved channels in the device buffer.
+ * @param destination The interleaved device buffer (numChannels * nFrames
+ * samples).
+ * @param format The sample format of the device buffer.
+ * @param nFrames The number of frames to write.
+ * @param dither Dither state, or nullptr to disable dithering.
+ */
+void interleaveToDevice(const float *const *channels, int numChannels,
+                        void *destination, SampleFormat format, int nFrames,
+                        DitherState *dither = nullptr);
+
+/**
+ * @brief Widens float samples to double.
+ * @param source The float samples.
+ * @param destination Receives nFrames doubles.
+ * @param nFrames The number of samples.
+ */
+void convertSamples(const float *source, double *destination, int nFrames);
+
+/**
+ * @brief Rounds double samples to float.
+ * @param source The double samples.
+ * @param destination Receives nFrames floats.
+ * @param nFrames The number of samples.
+ */
+void convertSamples(const double *source, float *destination, int nFrames);
+
+} // namespace ms
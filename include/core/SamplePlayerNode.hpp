@@ -0,0 +1,253 @@
+#pragma once
+#include "MappedAudioFile.hpp"
+#include "MpscQueue.hpp"
+#include "SampleCache.hpp"
+#include "StaticNode.hpp"
+#include "Symbol.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file SamplePlayerNode.hpp
+ * @brief Declares the built-in disk-streaming sample player node.
+ */
+
+namespace ms {
+
+/**
+ * @brief Memory and streaming figures of a SamplePlayerNode.
+ */
+struct SamplePlayerStats {
+  /** Number of samples loaded. */
+  int samples = 0;
+  /**
+   * Bytes held by the preloaded heads of all samples (samples added from a
+   * SampleCache are counted by the cache).
+   */
+  size_t preloadBytes = 0;
+  /** Bytes held by the voices' stream rings. */
+  size_t ringBytes = 0;
+  /** Voices playing at the end of the last block. */
+  int activeVoices = 0;
+  /**
+   * Blocks in which a voice ran out of streamed audio and played silence
+   * because the disk did not keep up.
+   */
+  uint64_t underruns = 0;
+  /** "play" events dropped because every voice was busy. */
+  uint64_t droppedTriggers = 0;
+  /** Streams that failed to open or seek; their voices end after the head. */
+  uint64_t streamErrors = 0;
+};
+
+/**
+ * @brief Plays audio files of any length from disk.
+ *
+ * loadSample() decodes only the head of a file (preloadFrames frames) into
+ * memory; addSample() instead plays a whole sample a SampleCache decoded,
+ * shared with other nodes, or a MappedAudioFile. When a voice starts, it
+ * plays from the head at once while a dedicated I/O thread opens the file
+ * with miniaudio's decoder, seeks past the head and streams the rest into
+ * a lock-free ring owned by the voice. Mapped files need no decoder: the
+ * I/O thread copies their frames into the ring, converting 16-bit data.
+ * The audio thread never reads a mapping, whose pages the kernel may evict
+ * at any time.
+ * The I/O thread keeps each ring filled kReadAheadMs ahead of playback,
+ * measured at the voice's current playback rate, so fast voices get deeper
+ * read-ahead. Decoders are only open while their voice plays, so any
+ * number of samples can be loaded.
+ *
+ * The audio thread never waits for the disk: if a voice catches up with
+ * its ring, it plays silence for the rest of the block, resumes where the
+ * data stops once the I/O thread catches up, and getStats() counts an
+ * underrun.
+ *
+ * Voices are triggered on the "trigger" event port: a "play" event
+ * whose value is a sample index (from loadSample() or addSample()) starts
+ * a free voice at the event's offset; a "stop" event releases the voices
+ * playing that sample, or every voice if its value is not a valid index,
+ * with a short fade.
+ * File channel c plays on outputs c, c + C, ... for a file of C channels;
+ * channels beyond the node's outputs are dropped. Files play at their own
+ * sample rate relative to the graph's, times the "rate" parameter
+ * (smoothed, clamped to (0, kMaxRate]), with linear interpolation.
+ *
+ * Ports: event input "trigger", audio outputs "out0" ... "out<O-1>".
+ * Parameters: "rate" (playback rate) and "gain" (linear, smoothed).
+ */
+class SamplePlayerNode : public StaticNode<SamplePlayerNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "sample_player";
+
+  /** Default number of voices. */
+  static constexpr int kDefaultVoices = 32;
+
+  /** Default length of the preloaded head, in frames of the file. */
+  static constexpr int kDefaultPreloadFrames = 16384;
+
+  /** Largest number of samples one node can load. */
+  static constexpr int kMaxSamples = 16384;
+
+  /** Highest playback rate. */
+  static constexpr float kMaxRate = 4.0f;
+
+  /** Audio kept decoded ahead of each voice, in ms of playback. */
+  static constexpr float kReadAheadMs = 250.0f;
+
+  /** Capacity of each voice's stream ring, in frames. */
+  static constexpr int kRingFrames = 65536;
+
+  /** Fade applied by "stop" events, in milliseconds. */
+  static constexpr float kReleaseMs = 5.0f;
+
+  /**
+   * @brief Constructs a node without samples.
+   * @param id The unique string identifier for the Node.
+   * @param numOutputs The number of output channels (at least 1).
+   * @param numVoices The number of voices (at least 1).
+   * @param preloadFrames Frames of each sample decoded by loadSample();
+   * the head must cover the time the I/O thread takes to open the file
+   * and fill the ring.
+   */
+  explicit SamplePlayerNode(const std::string &id, int numOutputs = 2,
+                            int numVoices = kDefaultVoices,
+                            int preloadFrames = kDefaultPreloadFrames);
+  ~SamplePlayerNode() override;
+
+  SamplePlayerNode(const SamplePlayerNode &) = delete;
+  SamplePlayerNode &operator=(const SamplePlayerNode &) = delete;
+
+  /** @brief Returns the number of output channels. */
+  int getNumOutputs() const { return numOutputs_; }
+
+  /** @brief Returns the number of voices. */
+  int getNumVoices() const { return static_cast<int>(voices_.size()); }
+
+  /**
+   * @brief Opens an audio file and decodes its head. Call from one control
+   * thread at a time, never from the audio thread. The file must stay in
+   * place while the node exists: voices reopen it to stream.
+   * @param path Path of a file miniaudio can decode (WAV, FLAC, MP3).
+   * @return The index "play" events refer to, or -1 if the file could not
+   * be decoded or kMaxSamples are loaded.
+   */
+  int loadSample(const std::string &path);
+
+  /**
+   * @brief Adds a sample decoded by a SampleCache. The node shares the
+   * data and plays it from memory, without streaming. Call from one
+   * control thread at a time, never from the audio thread.
+   * @param decoded A sample decoded to SampleFormat::F32.
+   * @return The index "play" events refer to, or -1 if decoded is null,
+   * not F32, or kMaxSamples are loaded.
+   */
+  int addSample(std::shared_ptr<const DecodedSample> decoded);
+
+  /**
+   * @brief Adds a memory-mapped file. Its first preloadFrames frames are
+   * copied into memory (16-bit data converted) before this returns; the
+   * rest is read as voices play. Call from one control thread at a time,
+   * never from the audio thread.
+   * @param file An open file; the node keeps it mapped.
+   * @return The index "play" events refer to, or -1 if file is null or
+   * closed, or kMaxSamples are loaded.
+   */
+  int addSample(std::shared_ptr<const MappedAudioFile> file);
+
+  /** @brief Returns the current figures. Safe to call from any thread. */
+  SamplePlayerStats getStats() const;
+
+  void prepare(int sampleRate, int blockSize) override;
+
+  void processEvent(const EventSpan *inputEvents,
+                    EventQueue *const *outputEvents) override;
+
+  /** @brief Renders the voices. */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    (void)inputs;
+    render(outputs, nFrames);
+  }
+
+private:
+  /** A loaded file and its preloaded head. */
+  struct Sample;
+  /** A voice: audio-thread playback state and its stream ring. */
+  struct Voice;
+
+  /** Asks the I/O thread to open (sample != nullptr) or close a stream. */
+  struct StreamCommand {
+    int voice;
+    const Sample *sample;
+  };
+
+  /** Makes a sample playable; returns its index. */
+  int publish(std::unique_ptr<Sample> sample);
+
+  /** Mixes the voices into the outputs. */
+  void render(float **outputs, int nFrames);
+
+  /** Starts a free voice on a sample. Audio thread. */
+  void startVoice(Voice &voice, const Sample &sample, int offset);
+
+  /** Hands a finished voice back to the I/O thread. Audio thread. */
+  void stopVoice(Voice &voice);
+
+  /** Ring frames to keep decoded ahead of a voice playing at rate. */
+  uint64_t readAheadFrames(float rate, const Sample &sample) const;
+
+  /** Posts a command and wakes the I/O thread without blocking. */
+  bool postCommand(const StreamCommand &command);
+
+  /** Allocates the rings and starts the I/O thread, once. */
+  void startStreaming();
+
+  /** The I/O thread: runs commands and keeps the rings filled. */
+  void ioLoop();
+
+  /** Reads one chunk ahead of a voice; false if it needs none. */
+  bool fillVoice(Voice &voice, std::vector<float> &scratch);
+
+  /** Closes a voice's decoder, if it has one. I/O thread. */
+  void closeStream(Voice &voice);
+
+  int numOutputs_;
+  int preloadFrames_;
+  ParamHandle rate_;
+  ParamHandle gain_;
+  Symbol playSymbol_;
+  Symbol stopSymbol_;
+
+  /** Loaded samples; the table entries below count are immutable. */
+  std::vector<std::unique_ptr<Sample>> samples_;
+  std::vector<const Sample *> sampleTable_;
+  std::atomic<int> sampleCount_{0};
+
+  std::vector<std::unique_ptr<Voice>> voices_;
+  MpscQueue<StreamCommand> commands_;
+  std::thread ioThread_;
+  std::mutex ioMutex_;
+  std::condition_variable ioWakeup_;
+  std::atomic<bool> ioPosted_{false};
+  std::atomic<bool> ioQuit_{false};
+
+  /** The block's playback rates, clamped; blockSize frames. */
+  std::vector<float> rates_;
+
+  std::atomic<size_t> preloadBytes_{0};
+  std::atomic<size_t> ringBytes_{0};
+  std::atomic<int> activeVoices_{0};
+  std::atomic<uint64_t> underruns_{0};
+  std::atomic<uint64_t> droppedTriggers_{0};
+  std::atomic<uint64_t> streamErrors_{0};
+};
+
+} // namespace ms
@@ -0,0 +1,605 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MS_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MS_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * @file Simd.hpp
+ * @brief Minimal 4-lane SIMD wrappers used by the MilliSuono DSP code.
+ *
+ * The wrappers map to SSE2 on x86, NEON on ARM and to a plain scalar
+ * fallback everywhere else, so DSP code can be written once against
+ * Float4/UInt4 and still compile on any target.
+ */
+
+namespace ms {
+namespace simd {
+
+/** Number of float lanes processed by one Float4. */
+constexpr int kWidth = 4;
+
+struct UInt4;
+
+/**
+ * @brief Four packed 32-bit floats.
+ */
+struct Float4 {
+#if MS_SIMD_SSE2
+  __m128 v;
+#elif MS_SIMD_NEON
+  float32x4_t v;
+#else
+  float v[4];
+#endif
+
+  /** @brief Broadcasts a scalar to all lanes. */
+  static Float4 set1(float x) {
+    Float4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_set1_ps(x);
+#elif MS_SIMD_NEON
+    r.v = vdupq_n_f32(x);
+#else
+    r.v[0] = r.v[1] = r.v[2] = r.v[3] = x;
+#endif
+    return r;
+  }
+
+  /** @brief Builds a vector from four scalars (lane 0 first). */
+  static Float4 set(float a, float b, float c, float d) {
+    Float4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_setr_ps(a, b, c, d);
+#elif MS_SIMD_NEON
+    const float tmp[4] = {a, b, c, d};
+    r.v = vld1q_f32(tmp);
+#else
+    r.v[0] = a;
+    r.v[1] = b;
+    r.v[2] = c;
+    r.v[3] = d;
+#endif
+    return r;
+  }
+
+  /** @brief Returns a vector with all lanes set to zero. */
+  static Float4 zero() { return set1(0.0f); }
+
+  /** @brief Loads four floats from an unaligned address. */
+  static Float4 load(const float *p) {
+    Float4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_loadu_ps(p);
+#elif MS_SIMD_NEON
+    r.v = vld1q_f32(p);
+#else
+    std::memcpy(r.v, p, sizeof(r.v));
+#endif
+    return r;
+  }
+
+  /** @brief Stores four floats to an unaligned address. */
+  void store(float *p) const {
+#if MS_SIMD_SSE2
+    _mm_storeu_ps(p, v);
+#elif MS_SIMD_NEON
+    vst1q_f32(p, v);
+#else
+    std::memcpy(p, v, sizeof(v));
+#endif
+  }
+
+  /** @brief Rounds each lane to the nearest integer and stores as int32. */
+  void storeRoundedInt(int32_t *p) const {
+#if MS_SIMD_SSE2
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvtps_epi32(v));
+#elif MS_SIMD_NEON && defined(__aarch64__)
+    vst1q_s32(p, vcvtnq_s32_f32(v));
+#else
+    float tmp[4];
+    store(tmp);
+    for (int i = 0; i < 4; ++i) {
+      p[i] = static_cast<int32_t>(std::lrintf(tmp[i]));
+    }
+#endif
+  }
+
+  /** @brief Loads four 16-bit integers, converted to float (unscaled). */
+  static Float4 loadInt16(const int16_t *p) {
+    Float4 r;
+#if MS_SIMD_SSE2
+    const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+    r.v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+#elif MS_SIMD_NEON
+    r.v = vcvtq_f32_s32(vmovl_s16(vld1_s16(p)));
+#else
+    for (int i = 0; i < 4; ++i) {
+      r.v[i] = static_cast<float>(p[i]);
+    }
+#endif
+    return r;
+  }
+
+  /** @brief Loads four doubles, rounding them to float. */
+  static Float4 loadDouble(const double *p) {
+    Float4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(p)),
+                        _mm_cvtpd_ps(_mm_loadu_pd(p + 2)));
+#elif MS_SIMD_NEON && defined(__aarch64__)
+    r.v = vcombine_f32(vcvt_f32_f64(vld1q_f64(p)),
+                       vcvt_f32_f64(vld1q_f64(p + 2)));
+#else
+    float tmp[4] = {static_cast<float>(p[0]), static_cast<float>(p[1]),
+                    static_cast<float>(p[2]), static_cast<float>(p[3])};
+    r = load(tmp);
+#endif
+    return r;
+  }
+
+  /** @brief Widens the lanes to double and stores them. */
+  void storeDouble(double *p) const {
+#if MS_SIMD_SSE2
+    _mm_storeu_pd(p, _mm_cvtps_pd(v));
+    _mm_storeu_pd(p + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+#elif MS_SIMD_NEON && defined(__aarch64__)
+    vst1q_f64(p, vcvt_f64_f32(vget_low_f32(v)));
+    vst1q_f64(p + 2, vcvt_high_f64_f32(v));
+#else
+    float tmp[4];
+    store(tmp);
+    for (int i = 0; i < 4; ++i) {
+      p[i] = tmp[i];
+    }
+#endif
+  }
+
+  /** @brief Reinterprets the lanes as unsigned integers. */
+  UInt4 asUInt() const;
+
+  friend Float4 operator+(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_add_ps(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = vaddq_f32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] += b.v[i];
+#endif
+    return a;
+  }
+
+  friend Float4 operator-(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_sub_ps(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = vsubq_f32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i];
+#endif
+    return a;
+  }
+
+  friend Float4 operator*(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_mul_ps(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = vmulq_f32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i];
+#endif
+    return a;
+  }
+
+  friend Float4 operator/(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_div_ps(a.v, b.v);
+#elif MS_SIMD_NEON && defined(__aarch64__)
+    a.v = vdivq_f32(a.v, b.v);
+#elif MS_SIMD_NEON
+    // No divide on ARMv7: reciprocal estimate refined by two Newton steps.
+    float32x4_t r = vrecpeq_f32(b.v);
+    r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+    r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+    a.v = vmulq_f32(a.v, r);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i];
+#endif
+    return a;
+  }
+
+  Float4 &operator+=(Float4 b) { return *this = *this + b; }
+  Float4 &operator-=(Float4 b) { return *this = *this - b; }
+  Float4 &operator*=(Float4 b) { return *this = *this * b; }
+};
+
+/**
+ * @brief Four packed 32-bit unsigned integers (bit manipulation only).
+ */
+struct UInt4 {
+#if MS_SIMD_SSE2
+  __m128i v;
+#elif MS_SIMD_NEON
+  uint32x4_t v;
+#else
+  uint32_t v[4];
+#endif
+
+  /** @brief Broadcasts a scalar to all lanes. */
+  static UInt4 set1(uint32_t x) {
+    UInt4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_set1_epi32(static_cast<int>(x));
+#elif MS_SIMD_NEON
+    r.v = vdupq_n_u32(x);
+#else
+    r.v[0] = r.v[1] = r.v[2] = r.v[3] = x;
+#endif
+    return r;
+  }
+
+  /** @brief Builds a vector from four scalars (lane 0 first). */
+  static UInt4 set(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    UInt4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_setr_epi32(static_cast<int>(a), static_cast<int>(b),
+                         static_cast<int>(c), static_cast<int>(d));
+#elif MS_SIMD_NEON
+    const uint32_t tmp[4] = {a, b, c, d};
+    r.v = vld1q_u32(tmp);
+#else
+    r.v[0] = a;
+    r.v[1] = b;
+    r.v[2] = c;
+    r.v[3] = d;
+#endif
+    return r;
+  }
+
+  /** @brief Loads four integers from an unaligned address. */
+  static UInt4 load(const uint32_t *p) {
+    UInt4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+#elif MS_SIMD_NEON
+    r.v = vld1q_u32(p);
+#else
+    std::memcpy(r.v, p, sizeof(r.v));
+#endif
+    return r;
+  }
+
+  /** @brief Stores four integers to an unaligned address. */
+  void store(uint32_t *p) const {
+#if MS_SIMD_SSE2
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+#elif MS_SIMD_NEON
+    vst1q_u32(p, v);
+#else
+    std::memcpy(p, v, sizeof(v));
+#endif
+  }
+
+  /** @brief Reinterprets the lanes as floats. */
+  Float4 asFloat() const {
+    Float4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_castsi128_ps(v);
+#elif MS_SIMD_NEON
+    r.v = vreinterpretq_f32_u32(v);
+#else
+    std::memcpy(r.v, v, sizeof(v));
+#endif
+    return r;
+  }
+
+  /** @brief Converts the lanes, read as signed integers, to floats. */
+  Float4 toFloat() const {
+    Float4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_cvtepi32_ps(v);
+#elif MS_SIMD_NEON
+    r.v = vcvtq_f32_s32(vreinterpretq_s32_u32(v));
+#else
+    for (int i = 0; i < 4; ++i) r.v[i] = static_cast<float>(static_cast<int32_t>(v[i]));
+#endif
+    return r;
+  }
+
+  /** @brief Lane-wise addition, wrapping around on overflow. */
+  friend UInt4 operator+(UInt4 a, UInt4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_add_epi32(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = vaddq_u32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] += b.v[i];
+#endif
+    return a;
+  }
+
+  friend UInt4 operator^(UInt4 a, UInt4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_xor_si128(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = veorq_u32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] ^= b.v[i];
+#endif
+    return a;
+  }
+
+  friend UInt4 operator|(UInt4 a, UInt4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_or_si128(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = vorrq_u32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] |= b.v[i];
+#endif
+    return a;
+  }
+
+  friend UInt4 operator&(UInt4 a, UInt4 b) {
+#if MS_SIMD_SSE2
+    a.v = _mm_and_si128(a.v, b.v);
+#elif MS_SIMD_NEON
+    a.v = vandq_u32(a.v, b.v);
+#else
+    for (int i = 0; i < 4; ++i) a.v[i] &= b.v[i];
+#endif
+    return a;
+  }
+
+  /** @brief Logical left shift of every lane by a constant. */
+  template <int N> UInt4 shl() const {
+    UInt4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_slli_epi32(v, N);
+#elif MS_SIMD_NEON
+    r.v = vshlq_n_u32(v, N);
+#else
+    for (int i = 0; i < 4; ++i) r.v[i] = v[i] << N;
+#endif
+    return r;
+  }
+
+  /** @brief Logical right shift of every lane by a constant. */
+  template <int N> UInt4 shr() const {
+    UInt4 r;
+#if MS_SIMD_SSE2
+    r.v = _mm_srli_epi32(v, N);
+#elif MS_SIMD_NEON
+    r.v = vshrq_n_u32(v, N);
+#else
+    for (int i = 0; i < 4; ++i) r.v[i] = v[i] >> N;
+#endif
+    return r;
+  }
+};
+
+inline UInt4 Float4::asUInt() const {
+  UInt4 r;
+#if MS_SIMD_SSE2
+  r.v = _mm_castps_si128(v);
+#elif MS_SIMD_NEON
+  r.v = vreinterpretq_u32_f32(v);
+#else
+  std::memcpy(r.v, v, sizeof(v));
+#endif
+  return r;
+}
+
+/** @brief Lane-wise minimum. */
+inline Float4 min(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_min_ps(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vminq_f32(a.v, b.v);
+#else
+  for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+#endif
+  return a;
+}
+
+/** @brief Lane-wise maximum. */
+inline Float4 max(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_max_ps(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vmaxq_f32(a.v, b.v);
+#else
+  for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+#endif
+  return a;
+}
+
+/** @brief Lane-wise a < b: all ones where true, zero where false. */
+inline UInt4 lessThan(Float4 a, Float4 b) {
+  UInt4 r;
+#if MS_SIMD_SSE2
+  r.v = _mm_castps_si128(_mm_cmplt_ps(a.v, b.v));
+#elif MS_SIMD_NEON
+  r.v = vcltq_f32(a.v, b.v);
+#else
+  for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? 0xFFFFFFFFu : 0u;
+#endif
+  return r;
+}
+
+/** @brief Picks a where mask is set and b elsewhere, lane by lane. */
+inline Float4 select(UInt4 mask, Float4 a, Float4 b) {
+  return (((a.asUInt() ^ b.asUInt()) & mask) ^ b.asUInt()).asFloat();
+}
+
+/** @brief Moves every lane up by one and inserts first: {first, x0, x1, x2}. */
+inline Float4 shiftIn(Float4 x, float first) {
+#if MS_SIMD_SSE2
+  x.v = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x.v), 4)),
+                    _mm_set_ss(first));
+#elif MS_SIMD_NEON
+  x.v = vextq_f32(vdupq_n_f32(first), x.v, 3);
+#else
+  x.v[3] = x.v[2];
+  x.v[2] = x.v[1];
+  x.v[1] = x.v[0];
+  x.v[0] = first;
+#endif
+  return x;
+}
+
+/** @brief Reverses the lanes: {x3, x2, x1, x0}. */
+inline Float4 reverse(Float4 x) {
+#if MS_SIMD_SSE2
+  x.v = _mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(0, 1, 2, 3));
+#elif MS_SIMD_NEON
+  const float32x4_t pairs = vrev64q_f32(x.v);
+  x.v = vcombine_f32(vget_high_f32(pairs), vget_low_f32(pairs));
+#else
+  const float r[4] = {x.v[3], x.v[2], x.v[1], x.v[0]};
+  std::memcpy(x.v, r, sizeof(r));
+#endif
+  return x;
+}
+
+/** @brief Transposes the 4x4 matrix whose rows are r0 ... r3. */
+inline void transpose(Float4 &r0, Float4 &r1, Float4 &r2, Float4 &r3) {
+#if MS_SIMD_SSE2
+  _MM_TRANSPOSE4_PS(r0.v, r1.v, r2.v, r3.v);
+#elif MS_SIMD_NEON
+  const float32x4x2_t a = vtrnq_f32(r0.v, r1.v);
+  const float32x4x2_t b = vtrnq_f32(r2.v, r3.v);
+  r0.v = vcombine_f32(vget_low_f32(a.val[0]), vget_low_f32(b.val[0]));
+  r1.v = vcombine_f32(vget_low_f32(a.val[1]), vget_low_f32(b.val[1]));
+  r2.v = vcombine_f32(vget_high_f32(a.val[0]), vget_high_f32(b.val[0]));
+  r3.v = vcombine_f32(vget_high_f32(a.val[1]), vget_high_f32(b.val[1]));
+#else
+  float m[4][4];
+  r0.store(m[0]);
+  r1.store(m[1]);
+  r2.store(m[2]);
+  r3.store(m[3]);
+  r0 = Float4::set(m[0][0], m[1][0], m[2][0], m[3][0]);
+  r1 = Float4::set(m[0][1], m[1][1], m[2][1], m[3][1]);
+  r2 = Float4::set(m[0][2], m[1][2], m[2][2], m[3][2]);
+  r3 = Float4::set(m[0][3], m[1][3], m[2][3], m[3][3]);
+#endif
+}
+
+/** @brief Interleaves the low halves: {a0, b0, a1, b1}. */
+inline Float4 zipLo(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_unpacklo_ps(a.v, b.v);
+#elif MS_SIMD_NEON && defined(__aarch64__)
+  a.v = vzip1q_f32(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vzipq_f32(a.v, b.v).val[0];
+#else
+  const float r[4] = {a.v[0], b.v[0], a.v[1], b.v[1]};
+  std::memcpy(a.v, r, sizeof(r));
+#endif
+  return a;
+}
+
+/** @brief Interleaves the high halves: {a2, b2, a3, b3}. */
+inline Float4 zipHi(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_unpackhi_ps(a.v, b.v);
+#elif MS_SIMD_NEON && defined(__aarch64__)
+  a.v = vzip2q_f32(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vzipq_f32(a.v, b.v).val[1];
+#else
+  const float r[4] = {a.v[2], b.v[2], a.v[3], b.v[3]};
+  std::memcpy(a.v, r, sizeof(r));
+#endif
+  return a;
+}
+
+/** @brief Joins the low halves: {a0, a1, b0, b1}. */
+inline Float4 lowHalves(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_movelh_ps(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vcombine_f32(vget_low_f32(a.v), vget_low_f32(b.v));
+#else
+  const float r[4] = {a.v[0], a.v[1], b.v[0], b.v[1]};
+  std::memcpy(a.v, r, sizeof(r));
+#endif
+  return a;
+}
+
+/** @brief Joins the high halves: {a2, a3, b2, b3}. */
+inline Float4 highHalves(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_movehl_ps(b.v, a.v);
+#elif MS_SIMD_NEON
+  a.v = vcombine_f32(vget_high_f32(a.v), vget_high_f32(b.v));
+#else
+  const float r[4] = {a.v[2], a.v[3], b.v[2], b.v[3]};
+  std::memcpy(a.v, r, sizeof(r));
+#endif
+  return a;
+}
+
+/** @brief Gathers the even lanes: {a0, a2, b0, b2}. */
+inline Float4 evenLanes(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0));
+#elif MS_SIMD_NEON && defined(__aarch64__)
+  a.v = vuzp1q_f32(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vuzpq_f32(a.v, b.v).val[0];
+#else
+  const float r[4] = {a.v[0], a.v[2], b.v[0], b.v[2]};
+  std::memcpy(a.v, r, sizeof(r));
+#endif
+  return a;
+}
+
+/** @brief Gathers the odd lanes: {a1, a3, b1, b3}. */
+inline Float4 oddLanes(Float4 a, Float4 b) {
+#if MS_SIMD_SSE2
+  a.v = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1));
+#elif MS_SIMD_NEON && defined(__aarch64__)
+  a.v = vuzp2q_f32(a.v, b.v);
+#elif MS_SIMD_NEON
+  a.v = vuzpq_f32(a.v, b.v).val[1];
+#else
+  const float r[4] = {a.v[1], a.v[3], b.v[1], b.v[3]};
+  std::memcpy(a.v, r, sizeof(r));
+#endif
+  return a;
+}
+
+/** @brief Clamps every lane to [lo, hi]. */
+inline Float4 clamp(Float4 x, Float4 lo, Float4 hi) {
+  return min(max(x, lo), hi);
+}
+
+/** @brief Returns the sum of the four lanes. */
+inline float horizontalSum(Float4 x) {
+#if MS_SIMD_SSE2
+  const __m128 pairs = _mm_add_ps(x.v, _mm_movehl_ps(x.v, x.v));
+  return _mm_cvtss_f32(
+      _mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+#elif MS_SIMD_NEON && defined(__aarch64__)
+  return vaddvq_f32(x.v);
+#elif MS_SIMD_NEON
+  const float32x2_t pairs = vadd_f32(vget_low_f32(x.v), vget_high_f32(x.v));
+  return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+#else
+  return (x.v[0] + x.v[1]) + (x.v[2] + x.v[3]);
+#endif
+}
+
+} // namespace simd
+} // namespace ms
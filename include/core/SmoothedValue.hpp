@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+
+/**
+ * @file SmoothedValue.hpp
+ * @brief Declares the per-sample parameter smoother used to avoid zipper
+ * noise.
+ */
+
+namespace ms {
+
+/**
+ * @brief Shape of the ramp used by SmoothedValue.
+ *
+ * - Linear: constant increment, reaches the target exactly after the ramp
+ *   time.
+ * - Exponential: one-pole approach, covers 99.9% of the distance within the
+ *   ramp time and then snaps to the target.
+ */
+enum class SmoothingType { Linear, Exponential };
+
+/**
+ * @brief A float value that ramps towards its target over a configurable
+ * time.
+ *
+ * Nodes either pull one value per sample with getNextValue() or fill a whole
+ * block at once with processBlock(), which uses SIMD. When the value is not
+ * ramping, isRamping() is false and processBlock() returns the already
+ * filled constant buffer without touching it again.
+ */
+class SmoothedValue {
+public:
+  /**
+   * @brief Constructs a smoother.
+   * @param initialValue The starting (and target) value.
+   * @param rampTimeMs The ramp time in milliseconds (0 = no smoothing).
+   * @param type The ramp shape.
+   */
+  SmoothedValue(float initialValue = 0.0f, float rampTimeMs = 20.0f,
+                SmoothingType type = SmoothingType::Linear);
+
+  /**
+   * @brief Prepares the smoother for processing.
+   * Allocates the ramp buffer; must not be called on the audio thread.
+   * @param sampleRate The sample rate in Hz.
+   * @param blockSize The maximum block size in samples.
+   */
+  void prepare(int sampleRate, int blockSize);
+
+  /**
+   * @brief Sets the ramp time used by subsequent setTarget() calls.
+   * @param rampTimeMs The ramp time in milliseconds (0 = no smoothing).
+   */
+  void setRampTime(float rampTimeMs);
+
+  /**
+   * @brief Sets the ramp shape used by subsequent setTarget() calls.
+   * @param type The ramp shape.
+   */
+  void setType(SmoothingType type);
+
+  /**
+   * @brief Starts a ramp from the current value towards a new target.
+   * @param target The value to ramp to.
+   */
+  void setTarget(float target);
+
+  /**
+   * @brief Jumps to a value immediately, cancelling any ramp.
+   * @param value The new current and target value.
+   */
+  void setCurrentAndTarget(float value);
+
+  /** @brief Returns true while the value is still moving. */
+  bool isRamping() const { return remaining_ > 0; }
+
+  /** @brief Returns the current value. */
+  float getCurrent() const { return current_; }
+
+  /** @brief Returns the target value. */
+  float getTarget() const { return target_; }
+
+  /**
+   * @brief Advances by one sample and returns the new value.
+   * @return The smoothed value for this sample.
+   */
+  float getNextValue();
+
+  /**
+   * @brief Advances by nFrames samples without producing output.
+   * @param nFrames The number of samples to skip.
+   */
+  void skip(int nFrames);
+
+  /**
+   * @brief Fills the internal ramp buffer for the next nFrames samples.
+   * Constant values cost nothing once the buffer holds the target.
+   * @param nFrames The number of samples (at most the prepared block size).
+   * @return Pointer to nFrames smoothed values.
+   */
+  const float *processBlock(int nFrames);
+
+private:
+  /** Recomputes the ramp length in samples from the time and sample rate. */
+  void updateRampSamples();
+
+  /** The value at the last produced sample. */
+  float current_;
+  /** The value being ramped to. */
+  float target_;
+  /** Linear increment per sample. */
+  float step_ = 0.0f;
+  /** Exponential decay of the remaining distance per sample. */
+  float coefficient_ = 0.0f;
+  /** Samples left in the current ramp (0 = not ramping). */
+  int remaining_ = 0;
+  /** Length of a full ramp in samples. */
+  int rampSamples_ = 0;
+  /** The ramp time in milliseconds. */
+  float rampTimeMs_;
+  /** The ramp shape. */
+  SmoothingType type_;
+  /** The sample rate in Hz. */
+  int sampleRate_ = 44100;
+  /** Per-block ramp buffer. */
+  std::vector<float> buffer_;
+  /** True when buffer_ is entirely filled with target_. */
+  bool bufferHoldsTarget_ = false;
+};
+
+} // namespace ms
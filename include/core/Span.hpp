@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file Span.hpp
+ * @brief A minimal non-owning view over a contiguous sequence.
+ *
+ * MilliSuono targets C++17, which has no std::span. Span provides the small
+ * subset needed to hand out contiguous data without copying it.
+ */
+
+namespace ms {
+
+/**
+ * @brief Non-owning view over count contiguous elements of type T.
+ *
+ * A Span never allocates and is cheap to copy. It does not extend the
+ * lifetime of the viewed data.
+ */
+template <typename T> class Span {
+public:
+  using element_type = T;
+  using iterator = T *;
+
+  /** @brief Constructs an empty span. */
+  Span() = default;
+
+  /**
+   * @brief Constructs a span over a pointer and an element count.
+   * @param data Pointer to the first element.
+   * @param size The number of elements.
+   */
+  Span(T *data, size_t size) : data_(data), size_(size) {}
+
+  /**
+   * @brief Constructs a span over the contents of a vector.
+   * @param vector The vector to view.
+   */
+  template <typename U, typename A,
+            typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+  Span(std::vector<U, A> &vector) : data_(vector.data()), size_(vector.size()) {}
+
+  /**
+   * @brief Constructs a read-only span over the contents of a vector.
+   * @param vector The vector to view.
+   */
+  template <typename U, typename A,
+            typename = std::enable_if_t<
+                std::is_convertible<const U *, T *>::value>>
+  Span(const std::vector<U, A> &vector)
+      : data_(vector.data()), size_(vector.size()) {}
+
+  T *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T &operator[](size_t index) const { return data_[index]; }
+  T &front() const { return data_[0]; }
+  T &back() const { return data_[size_ - 1]; }
+
+  iterator begin() const { return data_; }
+  iterator end() const { return data_ + size_; }
+
+  /**
+   * @brief Returns a view over a sub-range of this span.
+   * @param offset Index of the first element of the sub-range.
+   * @param count Number of elements in the sub-range.
+   */
+  Span subspan(size_t offset, size_t count) const {
+    return Span(data_ + offset, count);
+  }
+
+private:
+  T *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+} // namespace ms
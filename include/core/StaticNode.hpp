@@ -0,0 +1,81 @@
+#pragma once
+#include "Node.hpp"
+#include <string>
+#include <type_traits>
+
+/**
+ * @file StaticNode.hpp
+ * @brief CRTP base for built-in nodes the GraphManager can call without
+ * virtual dispatch.
+ */
+
+namespace ms {
+
+/**
+ * @brief Base class for nodes whose type is known to the GraphManager.
+ *
+ * Derived implements a non-virtual
+ * processBlock(const float *const *inputs, float **outputs, int nFrames).
+ * Node::process() forwards to it, so a StaticNode still works anywhere a
+ * Node does. When Derived is listed in BuiltinNodeTypes, the compiled plan
+ * groups consecutive steps of that type and calls processBlock() directly,
+ * which lets the compiler inline it into the processing loop. Define
+ * processBlock() in the header for the same reason. Nodes whose kernels
+ * are large enough that their cost dwarfs the call may instead forward
+ * from processBlock() to a function defined out of line.
+ *
+ * @tparam Derived The concrete node type.
+ */
+template <typename Derived> class StaticNode : public Node {
+  /** Detects a static Derived::processBatch with the BatchProcess signature. */
+  template <typename T, typename = void>
+  struct HasProcessBatch : std::false_type {};
+  template <typename T>
+  struct HasProcessBatch<
+      T, std::enable_if_t<std::is_convertible<decltype(&T::processBatch),
+                                              BatchProcess>::value>>
+      : std::true_type {};
+
+public:
+  /**
+   * @brief Constructs the node and records its static type. If Derived
+   * declares a static processBatch() it becomes the node's batch entry
+   * point (see Node::setBatchProcess()).
+   * @param id The unique string identifier for the Node.
+   */
+  explicit StaticNode(const std::string &id) : Node(id) {
+    staticType_ = typeKey();
+    if constexpr (HasProcessBatch<Derived>::value) {
+      batchProcess_ = &Derived::processBatch;
+    }
+  }
+
+  void process(const float *const *inputs, float **outputs,
+               int nFrames) final {
+    static_cast<Derived *>(this)->processBlock(inputs, outputs, nFrames);
+  }
+
+  /** @brief Returns a key that is unique to Derived. */
+  static const void *typeKey() {
+    static const char key = 0;
+    return &key;
+  }
+};
+
+/**
+ * @brief Compile-time list of node types.
+ */
+template <typename... Types> struct NodeTypeList {
+  /** @brief Wraps a type so it can be passed to a generic lambda. */
+  template <typename T> struct Tag {
+    using type = T;
+  };
+
+  /**
+   * @brief Calls f(Tag<T>()) for every type in the list.
+   * @param f A generic callable.
+   */
+  template <typename F> static void forEach(F &&f) { (f(Tag<Types>()), ...); }
+};
+
+} // namespace ms
@@ -0,0 +1,56 @@
+#pragma once
+#include "Simd.hpp"
+#include "StaticNode.hpp"
+#include <cstring>
+#include <string>
+
+/**
+ * @file SumNode.hpp
+ * @brief Declares the built-in node that adds its audio inputs.
+ */
+
+namespace ms {
+
+/**
+ * @brief Adds its audio inputs into one output.
+ *
+ * Ports: audio inputs "in0" ... "in<N-1>", audio output "out".
+ * Unconnected inputs read silence.
+ */
+class SumNode : public StaticNode<SumNode> {
+public:
+  /** The name the node is registered under. */
+  static constexpr const char *kTypeName = "sum";
+
+  /**
+   * @brief Constructs a sum node.
+   * @param id The unique string identifier for the Node.
+   * @param numInputs The number of audio inputs.
+   */
+  explicit SumNode(const std::string &id, int numInputs = 2);
+
+  /**
+   * @brief Adds the inputs. Defined inline so the GraphManager can inline it
+   * into its processing loop.
+   */
+  void processBlock(const float *const *inputs, float **outputs,
+                    int nFrames) {
+    float *out = outputs[0];
+    std::memcpy(out, inputs[0], sizeof(float) * nFrames);
+    for (int p = 1; p < numInputs_; ++p) {
+      const float *in = inputs[p];
+      int i = 0;
+      for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+        (simd::Float4::load(out + i) + simd::Float4::load(in + i)).store(out + i);
+      }
+      for (; i < nFrames; ++i) {
+        out[i] += in[i];
+      }
+    }
+  }
+
+private:
+  int numInputs_;
+};
+
+} // namespace ms
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @file Symbol.hpp
+ * @brief Declares interned strings used for event types and long string
+ * values.
+ */
+
+namespace ms {
+
+/**
+ * @brief Handle to a string interned in the process-wide symbol table.
+ *
+ * A Symbol is a 32-bit id: copying and comparing symbols never touches the
+ * string itself. Interning takes a lock and may allocate, so symbols should
+ * be created up front (e.g. in a node constructor), not on the audio
+ * thread. Resolving a symbol back to its text is lock-free.
+ */
+class Symbol {
+public:
+  /** @brief Constructs the empty symbol (""). */
+  Symbol() = default;
+
+  /**
+   * @brief Returns the symbol for a string, interning it on first use.
+   * @param name The text of the symbol.
+   * @return The symbol; equal strings always yield equal symbols.
+   */
+  static Symbol intern(std::string_view name);
+
+  /**
+   * @brief Rebuilds a symbol from an id previously returned by id().
+   * @param id The symbol id.
+   */
+  static Symbol fromId(uint32_t id) { return Symbol(id); }
+
+  /** @brief Returns the text of the symbol. The view stays valid forever. */
+  std::string_view str() const;
+
+  /** @brief Returns the numeric id of the symbol. */
+  uint32_t id() const { return id_; }
+
+  /** @brief Returns true for the empty symbol. */
+  bool empty() const { return id_ == 0; }
+
+  bool operator==(Symbol other) const { return id_ == other.id_; }
+  bool operator!=(Symbol other) const { return id_ != other.id_; }
+
+private:
+  explicit Symbol(uint32_t id) : id_(id) {}
+
+  uint32_t id_ = 0;
+};
+
+} // namespace ms
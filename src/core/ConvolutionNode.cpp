@@ -0,0 +1,697 @@
+#include "ConvolutionNode.hpp"
+#include "Denormals.hpp"
+#include "Fft.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ms {
+
+namespace {
+
+using simd::Float4;
+
+/** Growth of the partition size from one segment to the next. */
+constexpr int kGrowth = 8;
+
+/** Task states of a background segment. */
+enum TaskState : int { kIdle, kPending, kRunning, kDone };
+
+/**
+ * y += x h over split spectra of the given number of bins. Bin 0 holds
+ * two real bins (0 and Nyquist), which multiply separately.
+ */
+void multiplyAccumulate(const float *xr, const float *xi, const float *hr,
+                        const float *hi, float *yr, float *yi, int bins) {
+  const float dc = yr[0] + xr[0] * hr[0];
+  const float nyquist = yi[0] + xi[0] * hi[0];
+  for (int k = 0; k < bins; k += simd::kWidth) {
+    const Float4 ar = Float4::load(xr + k);
+    const Float4 ai = Float4::load(xi + k);
+    const Float4 br = Float4::load(hr + k);
+    const Float4 bi = Float4::load(hi + k);
+    (Float4::load(yr + k) + ar * br - ai * bi).store(yr + k);
+    (Float4::load(yi + k) + ar * bi + ai * br).store(yi + k);
+  }
+  yr[0] = dc;
+  yi[0] = nyquist;
+}
+
+/** out[i] += in[i]. */
+void accumulate(const float *in, float *out, int n) {
+  int i = 0;
+  for (; i + simd::kWidth <= n; i += simd::kWidth) {
+    (Float4::load(out + i) + Float4::load(in + i)).store(out + i);
+  }
+  for (; i < n; ++i) {
+    out[i] += in[i];
+  }
+}
+
+} // namespace
+
+/**
+ * The partitioned form of one impulse response, the input history and
+ * delay lines it convolves, and the worker that runs its background
+ * segments. Everything is allocated in the constructor.
+ */
+class ConvolutionNode::Instance {
+public:
+  Instance(const std::vector<std::vector<float>> &channels, int numInputs,
+           int numOutputs, int headSize, std::atomic<uint64_t> &lateTasks);
+  ~Instance();
+
+  Instance(const Instance &) = delete;
+  Instance &operator=(const Instance &) = delete;
+
+  int getLength() const { return length_; }
+  size_t getMemoryBytes() const { return memoryBytes_; }
+
+  /** Clears the history. Not on the audio thread, nor concurrently with it. */
+  void reset();
+
+  /** Writes the convolved block to outputs, running background segments
+   * inline if synchronous. Audio thread. */
+  void process(const float *const *inputs, float **outputs, int nFrames,
+               bool synchronous);
+
+private:
+  struct Path {
+    int input;
+    int output;
+  };
+
+  /** A run of equal partitions, starting at tap partition (foreground) or
+   * 2 * partition (background). */
+  struct Segment {
+    int partition = 0;
+    int numPartitions = 0;
+    bool background = false;
+    std::unique_ptr<RealFft> fft;
+    /** Kernel spectra: [((path * numPartitions + j) * 2 + part) * partition]
+     * with part 0 real and 1 imaginary, scaled by 1 / fft size. */
+    std::vector<float> kernel;
+    /** Frequency-domain delay line of input spectra, laid out as kernel
+     * with inputs for paths; slot newest holds the latest window. */
+    std::vector<float> spectra;
+    int newest = 0;
+    /** Time-domain window and spectrum sum, 2 * partition each. */
+    std::vector<float> window;
+    std::vector<float> sum;
+    /** Results per output, double-buffered for background segments:
+     * [(output * 2 + buffer) * partition]. */
+    std::vector<float> results;
+    int readBuffer = 0;
+    /** Background task: TaskState, and the ends of the input windows it
+     * pushes, every partition from windowBegin to windowEnd. Windows
+     * before windowValid have left the ring and are pushed as silence. */
+    std::atomic<int> state{kIdle};
+    int64_t windowBegin = 0;
+    int64_t windowEnd = 0;
+    int64_t windowValid = 0;
+    bool outstanding = false;
+    /** True while the worker is behind and the segment plays silence. */
+    bool muted = false;
+  };
+
+  /** Runs one period of a segment for the window ending at windowEnd. */
+  void runSegment(Segment &segment, int64_t windowEnd);
+  /** Pushes the spectrum of the window ending at windowEnd into the
+   * segment's delay line, or silence if valid is false. */
+  void pushWindow(Segment &segment, int64_t windowEnd, bool valid);
+  /** Convolves the delay line into the segment's results. */
+  void computeResults(Segment &segment);
+  /** Runs a background task: pushes its windows and computes results. */
+  void runTask(Segment &segment);
+  /** Runs, collects and posts (or runs, if synchronous) the segments due
+   * at the current time. */
+  void onBoundary(bool synchronous);
+  void workerLoop();
+  /** Runs the most urgent pending background task, if any. */
+  bool runPendingTask();
+
+  int numInputs_;
+  int numOutputs_;
+  int headSize_;
+  int length_ = 0;
+  std::vector<Path> paths_;
+  /** Direct-form taps, time-reversed: [path * headSize + j]. */
+  std::vector<float> headTaps_;
+  /** Per input: headSize - 1 samples of history, then the current chunk. */
+  std::vector<float> headHistory_;
+  /** Per input: a ring of recent input, read by the segments' windows. */
+  std::vector<float> rings_;
+  int ringSize_ = 0;
+  int64_t time_ = 0;
+  std::vector<std::unique_ptr<Segment>> segments_;
+  size_t memoryBytes_ = 0;
+  std::atomic<uint64_t> &lateTasks_;
+
+  std::thread worker_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::atomic<bool> posted_{false};
+  std::atomic<bool> quit_{false};
+};
+
+ConvolutionNode::Instance::Instance(
+    const std::vector<std::vector<float>> &channels, int numInputs,
+    int numOutputs, int headSize, std::atomic<uint64_t> &lateTasks)
+    : numInputs_(numInputs), numOutputs_(numOutputs), headSize_(headSize),
+      lateTasks_(lateTasks) {
+  for (const std::vector<float> &channel : channels) {
+    length_ = std::max(length_, static_cast<int>(channel.size()));
+  }
+  // One response per output, or one per input and output.
+  const bool trueStereo = static_cast<int>(channels.size()) != numOutputs;
+  for (int c = 0; c < static_cast<int>(channels.size()); ++c) {
+    paths_.push_back(trueStereo ? Path{c / numOutputs, c % numOutputs}
+                                : Path{c % numInputs, c});
+  }
+  auto tap = [&](size_t path, int index) {
+    const std::vector<float> &channel = channels[path];
+    return index < static_cast<int>(channel.size()) ? channel[index] : 0.0f;
+  };
+
+  headTaps_.assign(paths_.size() * headSize_, 0.0f);
+  for (size_t p = 0; p < paths_.size(); ++p) {
+    for (int j = 0; j < headSize_; ++j) {
+      headTaps_[p * headSize_ + (headSize_ - 1 - j)] = tap(p, j);
+    }
+  }
+  headHistory_.assign(static_cast<size_t>(numInputs_) * 2 * headSize_, 0.0f);
+
+  // Each segment ends where the next, with partitions kGrowth times
+  // larger, can start: at twice its partition.
+  int offset = headSize_;
+  int partition = headSize_;
+  bool background = false;
+  int largest = headSize_;
+  while (offset < length_) {
+    const int next = std::min(partition * kGrowth, kMaxPartition);
+    const int end = next > partition ? 2 * next : length_;
+    const int count =
+        (std::min(end, length_) - offset + partition - 1) / partition;
+
+    auto segment = std::make_unique<Segment>();
+    segment->partition = partition;
+    segment->numPartitions = count;
+    segment->background = background;
+    segment->fft = std::make_unique<RealFft>(2 * partition);
+    segment->kernel.assign(paths_.size() * count * 2 * partition, 0.0f);
+    segment->spectra.assign(
+        static_cast<size_t>(numInputs_) * count * 2 * partition, 0.0f);
+    segment->window.assign(2 * partition, 0.0f);
+    segment->sum.assign(2 * partition, 0.0f);
+    segment->results.assign(static_cast<size_t>(numOutputs_) * 2 * partition,
+                            0.0f);
+
+    const float scale = 1.0f / static_cast<float>(2 * partition);
+    for (size_t p = 0; p < paths_.size(); ++p) {
+      for (int j = 0; j < count; ++j) {
+        std::fill(segment->window.begin(), segment->window.end(), 0.0f);
+        for (int k = 0; k < partition; ++k) {
+          segment->window[k] = scale * tap(p, offset + j * partition + k);
+        }
+        float *spectrum =
+            segment->kernel.data() + (p * count + j) * 2 * partition;
+        segment->fft->forward(segment->window.data(), spectrum,
+                              spectrum + partition);
+      }
+    }
+    memoryBytes_ += segment->fft->getMemoryBytes();
+    for (const std::vector<float> *buffer :
+         {&segment->kernel, &segment->spectra, &segment->window,
+          &segment->sum, &segment->results}) {
+      memoryBytes_ += buffer->size() * sizeof(float);
+    }
+    segments_.push_back(std::move(segment));
+
+    largest = partition;
+    offset += count * partition;
+    partition = next;
+    background = true;
+  }
+
+  // The ring holds a window of two partitions plus the period a
+  // background task may take to read it.
+  ringSize_ = 1;
+  while (ringSize_ < 4 * largest) {
+    ringSize_ <<= 1;
+  }
+  rings_.assign(static_cast<size_t>(numInputs_) * ringSize_, 0.0f);
+  memoryBytes_ += (headTaps_.size() + headHistory_.size() + rings_.size()) *
+                  sizeof(float);
+
+  for (const auto &segment : segments_) {
+    if (segment->background) {
+      worker_ = std::thread([this] { workerLoop(); });
+      break;
+    }
+  }
+}
+
+ConvolutionNode::Instance::~Instance() {
+  if (worker_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_.store(true);
+    }
+    wakeup_.notify_one();
+    worker_.join();
+  }
+}
+
+void ConvolutionNode::Instance::reset() {
+  for (const auto &segment : segments_) {
+    // Cancel a task the worker has not started; let a running one finish.
+    for (;;) {
+      int expected = kPending;
+      if (segment->state.compare_exchange_strong(expected, kIdle) ||
+          expected != kRunning) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+    segment->state.store(kIdle);
+    segment->windowEnd = 0;
+    segment->outstanding = false;
+    segment->muted = false;
+    segment->readBuffer = 0;
+    segment->newest = 0;
+    std::fill(segment->spectra.begin(), segment->spectra.end(), 0.0f);
+    std::fill(segment->results.begin(), segment->results.end(), 0.0f);
+  }
+  std::fill(headHistory_.begin(), headHistory_.end(), 0.0f);
+  std::fill(rings_.begin(), rings_.end(), 0.0f);
+  time_ = 0;
+}
+
+void ConvolutionNode::Instance::process(const float *const *inputs,
+                                        float **outputs, int nFrames,
+                                        bool synchronous) {
+  const int history = headSize_ - 1;
+  // Chunks end on multiples of headSize, where partitions are due.
+  for (int done = 0; done < nFrames;) {
+    const int phase = static_cast<int>(time_ & (headSize_ - 1));
+    const int count = std::min(nFrames - done, headSize_ - phase);
+
+    for (int i = 0; i < numInputs_; ++i) {
+      const float *in = inputs[i] + done;
+      float *ring = rings_.data() + static_cast<size_t>(i) * ringSize_;
+      const int pos = static_cast<int>(time_ & (ringSize_ - 1));
+      const int first = std::min(count, ringSize_ - pos);
+      std::memcpy(ring + pos, in, first * sizeof(float));
+      std::memcpy(ring, in + first, (count - first) * sizeof(float));
+      std::memcpy(headHistory_.data() + i * 2 * headSize_ + history, in,
+                  count * sizeof(float));
+    }
+
+    // Direct-form head: four outputs per step, one accumulator per output,
+    // summed across lanes with a transpose.
+    for (int o = 0; o < numOutputs_; ++o) {
+      std::fill(outputs[o] + done, outputs[o] + done + count, 0.0f);
+    }
+    for (size_t p = 0; p < paths_.size(); ++p) {
+      const float *taps = headTaps_.data() + p * headSize_;
+      const float *x = headHistory_.data() + paths_[p].input * 2 * headSize_;
+      float *out = outputs[paths_[p].output] + done;
+      int i = 0;
+      for (; i + simd::kWidth <= count; i += simd::kWidth) {
+        Float4 a0 = Float4::zero();
+        Float4 a1 = Float4::zero();
+        Float4 a2 = Float4::zero();
+        Float4 a3 = Float4::zero();
+        for (int j = 0; j < headSize_; j += simd::kWidth) {
+          const Float4 t = Float4::load(taps + j);
+          a0 += t * Float4::load(x + i + j);
+          a1 += t * Float4::load(x + i + j + 1);
+          a2 += t * Float4::load(x + i + j + 2);
+          a3 += t * Float4::load(x + i + j + 3);
+        }
+        simd::transpose(a0, a1, a2, a3);
+        (Float4::load(out + i) + ((a0 + a1) + (a2 + a3))).store(out + i);
+      }
+      for (; i < count; ++i) {
+        float y = 0.0f;
+        for (int j = 0; j < headSize_; ++j) {
+          y += taps[j] * x[i + j];
+        }
+        out[i] += y;
+      }
+    }
+    for (int i = 0; i < numInputs_; ++i) {
+      float *x = headHistory_.data() + i * 2 * headSize_;
+      std::memmove(x, x + count, history * sizeof(float));
+    }
+
+    for (const auto &segment : segments_) {
+      if (segment->muted) {
+        continue;
+      }
+      const int partition = segment->partition;
+      const int pos = static_cast<int>(time_ & (partition - 1));
+      for (int o = 0; o < numOutputs_; ++o) {
+        accumulate(segment->results.data() +
+                       (o * 2 + segment->readBuffer) * partition + pos,
+                   outputs[o] + done, count);
+      }
+    }
+
+    time_ += count;
+    done += count;
+    if ((time_ & (headSize_ - 1)) == 0) {
+      onBoundary(synchronous);
+    }
+  }
+}
+
+void ConvolutionNode::Instance::onBoundary(bool synchronous) {
+  bool posted = false;
+  for (const auto &pointer : segments_) {
+    Segment &segment = *pointer;
+    if ((time_ & (segment.partition - 1)) != 0) {
+      continue;
+    }
+    if (!segment.background) {
+      runSegment(segment, time_);
+      continue;
+    }
+    // The task posted one period ago is due now. If the worker has not
+    // started it, run it here. If the worker is still running it, do not
+    // wait: the segment plays silence, and the windows it misses are
+    // posted with the next task.
+    if (segment.outstanding) {
+      int expected = kPending;
+      if (segment.state.compare_exchange_strong(expected, kRunning,
+                                                std::memory_order_acquire)) {
+        runTask(segment);
+        lateTasks_.fetch_add(1, std::memory_order_relaxed);
+      } else if (segment.state.load(std::memory_order_acquire) != kDone) {
+        lateTasks_.fetch_add(1, std::memory_order_relaxed);
+        segment.muted = true;
+        continue;
+      }
+      segment.outstanding = false;
+      // Results of a task that caught up on missed windows are already
+      // out of date; the next task's are not.
+      if (segment.windowEnd + segment.partition == time_) {
+        segment.readBuffer ^= 1;
+        segment.muted = false;
+      }
+    }
+    // Only the current and previous windows are sure to still be in the
+    // ring when the worker reads them.
+    segment.windowBegin = segment.windowEnd + segment.partition;
+    segment.windowEnd = time_;
+    segment.windowValid = time_ - segment.partition;
+    segment.outstanding = true;
+    if (synchronous) {
+      // Done now, read from the next period as if the worker had run it.
+      runTask(segment);
+      segment.state.store(kDone, std::memory_order_relaxed);
+      continue;
+    }
+    segment.state.store(kPending, std::memory_order_release);
+    posted = true;
+  }
+  if (posted) {
+    // Passing through the mutex orders the flag before the worker's check
+    // or after its wait, so the notification cannot be lost. The audio
+    // thread never blocks on it; if the mutex is busy the worker's timeout
+    // covers the rare miss, and onBoundary() any deadline that slips.
+    posted_.store(true, std::memory_order_release);
+    if (mutex_.try_lock()) {
+      mutex_.unlock();
+    }
+    wakeup_.notify_one();
+  }
+}
+
+void ConvolutionNode::Instance::runSegment(Segment &segment,
+                                           int64_t windowEnd) {
+  pushWindow(segment, windowEnd, true);
+  computeResults(segment);
+}
+
+void ConvolutionNode::Instance::runTask(Segment &segment) {
+  for (int64_t end = segment.windowBegin; end <= segment.windowEnd;
+       end += segment.partition) {
+    pushWindow(segment, end, end >= segment.windowValid);
+  }
+  computeResults(segment);
+}
+
+void ConvolutionNode::Instance::pushWindow(Segment &segment,
+                                           int64_t windowEnd, bool valid) {
+  const int partition = segment.partition;
+  const int count = segment.numPartitions;
+  const size_t spectrumSize = 2 * static_cast<size_t>(partition);
+  float *window = segment.window.data();
+
+  // Transform the last two partitions of every input into the newest slot
+  // of the delay line.
+  segment.newest = segment.newest + 1 == count ? 0 : segment.newest + 1;
+  const int start =
+      static_cast<int>((windowEnd - 2 * partition) & (ringSize_ - 1));
+  const int first = std::min(2 * partition, ringSize_ - start);
+  for (int i = 0; i < numInputs_; ++i) {
+    float *slot =
+        segment.spectra.data() + (i * count + segment.newest) * spectrumSize;
+    if (!valid) {
+      std::fill(slot, slot + spectrumSize, 0.0f);
+      continue;
+    }
+    const float *ring = rings_.data() + static_cast<size_t>(i) * ringSize_;
+    std::memcpy(window, ring + start, first * sizeof(float));
+    std::memcpy(window + first, ring, (2 * partition - first) * sizeof(float));
+    segment.fft->forward(window, slot, slot + partition);
+  }
+}
+
+void ConvolutionNode::Instance::computeResults(Segment &segment) {
+  const int partition = segment.partition;
+  const int count = segment.numPartitions;
+  const size_t spectrumSize = 2 * static_cast<size_t>(partition);
+  float *window = segment.window.data();
+
+  // Sum input spectrum j periods old times kernel partition j over every
+  // path to an output, and keep the valid (second) half of the inverse.
+  const int buffer = segment.background ? segment.readBuffer ^ 1
+                                        : segment.readBuffer;
+  float *sumRe = segment.sum.data();
+  float *sumIm = sumRe + partition;
+  for (int o = 0; o < numOutputs_; ++o) {
+    std::fill(segment.sum.begin(), segment.sum.end(), 0.0f);
+    for (size_t p = 0; p < paths_.size(); ++p) {
+      if (paths_[p].output != o) {
+        continue;
+      }
+      const float *kernel = segment.kernel.data() + p * count * spectrumSize;
+      const float *spectra =
+          segment.spectra.data() + paths_[p].input * count * spectrumSize;
+      for (int j = 0; j < count; ++j) {
+        const int slot = segment.newest >= j ? segment.newest - j
+                                             : segment.newest - j + count;
+        const float *x = spectra + slot * spectrumSize;
+        const float *h = kernel + j * spectrumSize;
+        multiplyAccumulate(x, x + partition, h, h + partition, sumRe, sumIm,
+                           partition);
+      }
+    }
+    segment.fft->inverse(sumRe, sumIm, window);
+    std::memcpy(segment.results.data() + (o * 2 + buffer) * partition,
+                window + partition, partition * sizeof(float));
+  }
+}
+
+bool ConvolutionNode::Instance::runPendingTask() {
+  // Segments are ordered by partition, so the first pending one has the
+  // nearest deadline.
+  for (const auto &segment : segments_) {
+    int expected = kPending;
+    if (segment->background &&
+        segment->state.compare_exchange_strong(expected, kRunning,
+                                               std::memory_order_acquire)) {
+      runTask(*segment);
+      segment->state.store(kDone, std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ConvolutionNode::Instance::workerLoop() {
+  const ScopedFlushDenormals flushDenormals;
+  while (!quit_.load(std::memory_order_acquire)) {
+    if (runPendingTask()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeup_.wait_for(lock, std::chrono::milliseconds(10), [this] {
+      return quit_.load() || posted_.exchange(false);
+    });
+  }
+}
+
+ConvolutionNode::ConvolutionNode(const std::string &id, int numInputs,
+                                 int numOutputs, int headSize)
+    : StaticNode<ConvolutionNode>(id), numInputs_(std::max(numInputs, 1)),
+      numOutputs_(std::max(numOutputs, 1)), headSize_(16) {
+  while (headSize_ < std::min(headSize, 1024)) {
+    headSize_ <<= 1;
+  }
+  for (int i = 0; i < numInputs_; ++i) {
+    addInputPort("in" + std::to_string(i), PortType::Audio);
+  }
+  for (int o = 0; o < numOutputs_; ++o) {
+    addOutputPort("out" + std::to_string(o), PortType::Audio);
+  }
+  wet_ = addSmoothedParam("wet", 1.0f);
+  dry_ = addSmoothedParam("dry", 0.0f);
+  // Without a response the output is the dry input alone.
+  setTailLength(0);
+}
+
+ConvolutionNode::~ConvolutionNode() {
+  delete pending_.exchange(nullptr);
+  delete current_;
+  delete fading_;
+  collectRetired();
+}
+
+bool ConvolutionNode::setImpulseResponse(
+    const std::vector<std::vector<float>> &channels) {
+  const int count = static_cast<int>(channels.size());
+  if (count != numOutputs_ && count != numInputs_ * numOutputs_) {
+    return false;
+  }
+  size_t length = 0;
+  for (const std::vector<float> &channel : channels) {
+    length = std::max(length, channel.size());
+  }
+  if (length == 0) {
+    return false;
+  }
+  collectRetired();
+  auto *instance =
+      new Instance(channels, numInputs_, numOutputs_, headSize_, lateTasks_);
+  impulseLength_.store(instance->getLength(), std::memory_order_relaxed);
+  memoryBytes_.store(instance->getMemoryBytes(), std::memory_order_relaxed);
+  // A response the audio thread has not picked up yet was never used.
+  delete pending_.exchange(instance, std::memory_order_acq_rel);
+  return true;
+}
+
+ConvolutionStats ConvolutionNode::getStats() const {
+  ConvolutionStats stats;
+  stats.impulseLength = impulseLength_.load(std::memory_order_relaxed);
+  stats.memoryBytes = memoryBytes_.load(std::memory_order_relaxed);
+  stats.lateTasks = lateTasks_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ConvolutionNode::collectRetired() {
+  Instance *instance = nullptr;
+  while (retired_.pop(instance)) {
+    delete instance;
+  }
+}
+
+void ConvolutionNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  fadeLength_ = std::max(
+      1, static_cast<int>(sampleRate * kSwapFadeMs / 1000.0f));
+  fadeBuffer_.assign(static_cast<size_t>(numOutputs_) * blockSize, 0.0f);
+  fadeOutputs_.resize(numOutputs_);
+  for (int o = 0; o < numOutputs_; ++o) {
+    fadeOutputs_[o] = fadeBuffer_.data() + static_cast<size_t>(o) * blockSize;
+  }
+  // The graph never processes a node while preparing it, so the audio
+  // thread's instances can be touched here.
+  delete fading_;
+  fading_ = nullptr;
+  collectRetired();
+  if (current_) {
+    current_->reset();
+  }
+}
+
+void ConvolutionNode::render(const float *const *inputs, float **outputs,
+                             int nFrames) {
+  // Take a new response once the previous crossfade is over.
+  if (!fading_) {
+    if (Instance *next = pending_.exchange(nullptr, std::memory_order_acquire)) {
+      fading_ = current_;
+      fadePosition_ = 0;
+      current_ = next;
+      // The graph reads the tail every block; the old response keeps
+      // ringing until the crossfade is over.
+      setTailLength(std::max(next->getLength(),
+                             fading_ ? fading_->getLength() : 0));
+    }
+  }
+
+  const bool synchronous = synchronous_.load(std::memory_order_relaxed);
+  if (current_) {
+    current_->process(inputs, outputs, nFrames, synchronous);
+  } else {
+    for (int o = 0; o < numOutputs_; ++o) {
+      std::fill(outputs[o], outputs[o] + nFrames, 0.0f);
+    }
+  }
+
+  if (fading_) {
+    if (fadePosition_ < fadeLength_) {
+      fading_->process(inputs, fadeOutputs_.data(), nFrames, synchronous);
+      const float step = 1.0f / static_cast<float>(fadeLength_);
+      for (int o = 0; o < numOutputs_; ++o) {
+        const float *old = fadeOutputs_[o];
+        float *out = outputs[o];
+        for (int i = 0; i < nFrames; ++i) {
+          const float gain =
+              std::min(static_cast<float>(fadePosition_ + i) * step, 1.0f);
+          out[i] = old[i] + (out[i] - old[i]) * gain;
+        }
+      }
+      fadePosition_ += nFrames;
+    }
+    if (fadePosition_ >= fadeLength_ && retired_.push(fading_)) {
+      fading_ = nullptr;
+      setTailLength(current_->getLength());
+    }
+  }
+
+  SmoothedValue &wet = *getSmoother(wet_);
+  SmoothedValue &dry = *getSmoother(dry_);
+  if (!wet.isRamping() && !dry.isRamping() && wet.getCurrent() == 1.0f &&
+      dry.getCurrent() == 0.0f) {
+    return;
+  }
+  const float *wetRamp = wet.isRamping() ? wet.processBlock(nFrames) : nullptr;
+  const float *dryRamp = dry.isRamping() ? dry.processBlock(nFrames) : nullptr;
+  const Float4 wetGain = Float4::set1(wet.getCurrent());
+  const Float4 dryGain = Float4::set1(dry.getCurrent());
+  for (int o = 0; o < numOutputs_; ++o) {
+    const float *in = inputs[o % numInputs_];
+    float *out = outputs[o];
+    int i = 0;
+    for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+      const Float4 w = wetRamp ? Float4::load(wetRamp + i) : wetGain;
+      const Float4 d = dryRamp ? Float4::load(dryRamp + i) : dryGain;
+      (Float4::load(out + i) * w + Float4::load(in + i) * d).store(out + i);
+    }
+    for (; i < nFrames; ++i) {
+      const float w = wetRamp ? wetRamp[i] : wet.getCurrent();
+      const float d = dryRamp ? dryRamp[i] : dry.getCurrent();
+      out[i] = out[i] * w + in[i] * d;
+    }
+  }
+}
+
+} // namespace ms
@@ -0,0 +1,360 @@
+#include "DelayNode.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace ms {
+
+namespace {
+
+using simd::Float4;
+
+/** Level the feedback echoes must decay to before the node may sleep. */
+constexpr float kTailLevel = 1e-4f;
+
+/** Allpass fractions below this borrow a frame, keeping the pole off -1. */
+constexpr float kMinAllPassFraction = 0.1f;
+
+// The taps below read relative to x, where frame 0 of the block is
+// written: x[i - k] is frame i delayed by k whole frames. Frames
+// [begin, end) read nothing at or after begin while end - begin is less
+// than floor(delay); the delay is at least kMinDelayFrames.
+
+/** Linear taps at a fixed delay, four frames per vector. */
+void readLinearFixed(const float *x, float delay, float *out, int begin,
+                     int end) {
+  const int k = static_cast<int>(delay);
+  const float fraction = delay - static_cast<float>(k);
+  const float *newer = x - k;
+  const float *older = x - k - 1;
+  const Float4 f = Float4::set1(fraction);
+  int i = begin;
+  for (; i + simd::kWidth <= end; i += simd::kWidth) {
+    const Float4 a = Float4::load(newer + i);
+    (a + f * (Float4::load(older + i) - a)).store(out + i);
+  }
+  for (; i < end; ++i) {
+    out[i] = newer[i] + fraction * (older[i] - newer[i]);
+  }
+}
+
+/** Linear taps at a delay per frame. */
+void readLinear(const float *x, const float *delays, float *out, int begin,
+                int end) {
+  for (int i = begin; i < end; ++i) {
+    const int k = static_cast<int>(delays[i]);
+    const float fraction = delays[i] - static_cast<float>(k);
+    const float *tap = x + i - k;
+    out[i] = tap[0] + fraction * (tap[-1] - tap[0]);
+  }
+}
+
+/**
+ * Weights of the 4-point Hermite interpolator for the frames one newer
+ * than the tap, the tap, and one and two older, at a fraction from the
+ * tap towards the older frame.
+ */
+struct HermiteWeights {
+  float newer, tap, older, oldest;
+};
+
+HermiteWeights hermiteWeights(float f) {
+  const float f2 = f * f;
+  const float f3 = f2 * f;
+  return {-0.5f * f + f2 - 0.5f * f3, 1.0f - 2.5f * f2 + 1.5f * f3,
+          0.5f * f + 2.0f * f2 - 1.5f * f3, 0.5f * (f3 - f2)};
+}
+
+/** Cubic taps at a fixed delay, four frames per vector. */
+void readCubicFixed(const float *x, float delay, float *out, int begin,
+                    int end) {
+  const int k = static_cast<int>(delay);
+  const HermiteWeights w = hermiteWeights(delay - static_cast<float>(k));
+  const float *tap = x - k;
+  const Float4 w0 = Float4::set1(w.newer);
+  const Float4 w1 = Float4::set1(w.tap);
+  const Float4 w2 = Float4::set1(w.older);
+  const Float4 w3 = Float4::set1(w.oldest);
+  int i = begin;
+  for (; i + simd::kWidth <= end; i += simd::kWidth) {
+    (w0 * Float4::load(tap + i + 1) + w1 * Float4::load(tap + i) +
+     w2 * Float4::load(tap + i - 1) + w3 * Float4::load(tap + i - 2))
+        .store(out + i);
+  }
+  for (; i < end; ++i) {
+    out[i] = w.newer * tap[i + 1] + w.tap * tap[i] + w.older * tap[i - 1] +
+             w.oldest * tap[i - 2];
+  }
+}
+
+/**
+ * Cubic taps at a delay per frame. The weights are computed four frames
+ * per vector; the frames each lane reads are gathered.
+ */
+void readCubic(const float *x, const float *delays, float *out, int begin,
+               int end) {
+  int i = begin;
+  for (; i + simd::kWidth <= end; i += simd::kWidth) {
+    float newer[simd::kWidth];
+    float tap[simd::kWidth];
+    float older[simd::kWidth];
+    float oldest[simd::kWidth];
+    float whole[simd::kWidth];
+    for (int l = 0; l < simd::kWidth; ++l) {
+      const int k = static_cast<int>(delays[i + l]);
+      const float *p = x + i + l - k;
+      newer[l] = p[1];
+      tap[l] = p[0];
+      older[l] = p[-1];
+      oldest[l] = p[-2];
+      whole[l] = static_cast<float>(k);
+    }
+    const Float4 f = Float4::load(delays + i) - Float4::load(whole);
+    const Float4 f2 = f * f;
+    const Float4 f3 = f2 * f;
+    const Float4 half = Float4::set1(0.5f);
+    const Float4 w0 = f2 - half * (f + f3);
+    const Float4 w1 =
+        Float4::set1(1.0f) - Float4::set1(2.5f) * f2 + Float4::set1(1.5f) * f3;
+    const Float4 w2 =
+        half * f + Float4::set1(2.0f) * f2 - Float4::set1(1.5f) * f3;
+    const Float4 w3 = half * (f3 - f2);
+    (w0 * Float4::load(newer) + w1 * Float4::load(tap) +
+     w2 * Float4::load(older) + w3 * Float4::load(oldest))
+        .store(out + i);
+  }
+  for (; i < end; ++i) {
+    const int k = static_cast<int>(delays[i]);
+    const HermiteWeights w = hermiteWeights(delays[i] - static_cast<float>(k));
+    const float *tap = x + i - k;
+    out[i] = w.newer * tap[1] + w.tap * tap[0] + w.older * tap[-1] +
+             w.oldest * tap[-2];
+  }
+}
+
+/**
+ * First-order allpass taps: y[i] = a * x[i - k] + x[i - k - 1] - a * y[i - 1]
+ * with a = (1 - f) / (1 + f) for delay k + f. The recursion is serial;
+ * Fixed computes a once.
+ */
+template <bool Fixed>
+void readAllPass(const float *x, const float *delays, float *out, int begin,
+                 int end, float &state) {
+  int k = 0;
+  float a = 0.0f;
+  auto coefficient = [&](float delay) {
+    k = static_cast<int>(delay);
+    float fraction = delay - static_cast<float>(k);
+    if (fraction < kMinAllPassFraction) {
+      --k;
+      fraction += 1.0f;
+    }
+    a = (1.0f - fraction) / (1.0f + fraction);
+  };
+  if (Fixed) {
+    coefficient(delays[begin]);
+  }
+  float y = state;
+  for (int i = begin; i < end; ++i) {
+    if (!Fixed) {
+      coefficient(delays[i]);
+    }
+    const float *tap = x + i - k;
+    y = a * (tap[0] - y) + tap[-1];
+    out[i] = y;
+  }
+  state = y;
+}
+
+} // namespace
+
+DelayNode::DelayNode(const std::string &id, int numChannels,
+                     float maxDelayMs, DelayInterpolation interpolation)
+    : StaticNode<DelayNode>(id), numChannels_(std::max(numChannels, 1)),
+      maxDelayMs_(std::max(maxDelayMs, 0.0f)),
+      cachedInterpolation_(interpolation) {
+  for (int c = 0; c < numChannels_; ++c) {
+    addInputPort("in" + std::to_string(c), PortType::Audio);
+  }
+  addInputPort("mod", PortType::Audio);
+  for (int c = 0; c < numChannels_; ++c) {
+    addOutputPort("out" + std::to_string(c), PortType::Audio);
+  }
+  time_ = addSmoothedParam("time", std::min(250.0f, maxDelayMs_), 50.0f);
+  feedback_ = addSmoothedParam("feedback", 0.0f);
+  mix_ = addSmoothedParam("mix", 1.0f);
+  interpolation_ = addParam("interpolation", static_cast<int>(interpolation));
+  lines_.resize(numChannels_);
+  allPassState_.assign(numChannels_, 0.0f);
+}
+
+void DelayNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  maxDelayFrames_ = std::max(maxDelayMs_ * sampleRate / 1000.0f,
+                             kMinDelayFrames);
+  reach_ = static_cast<size_t>(maxDelayFrames_) + 2;
+  // A block is written past the reach, and the window it reads from must
+  // fit in the ring.
+  for (MirroredRingBuffer &line : lines_) {
+    line.allocate(reach_ + blockSize);
+  }
+  delays_.assign(blockSize, 0.0f);
+  updateTail(getParam(feedback_)->asFloat());
+  reset();
+}
+
+void DelayNode::reset() {
+  for (MirroredRingBuffer &line : lines_) {
+    line.clear();
+  }
+  writePosition_ = 0;
+  std::fill(allPassState_.begin(), allPassState_.end(), 0.0f);
+  if (tailHoldFrames_ > 0) {
+    tailHoldFrames_ = 0;
+    updateTail(cachedFeedback_);
+  }
+}
+
+void DelayNode::updateTail(float feedback) {
+  cachedFeedback_ = feedback;
+  const float gain = std::min(std::fabs(feedback), kMaxFeedback);
+  // One pass through the line, then one per echo until they fade out.
+  const double echoes =
+      gain > kTailLevel ? std::ceil(std::log(kTailLevel) / std::log(gain))
+                        : 0.0;
+  const double tail = std::ceil(maxDelayFrames_) * (1.0 + echoes);
+  setTailLength(tail < INT_MAX ? static_cast<int>(tail) : kInfiniteTail);
+}
+
+void DelayNode::render(const float *const *inputs, float **outputs,
+                       int nFrames) {
+  SmoothedValue &timeSmoother = *getSmoother(time_);
+  SmoothedValue &feedbackSmoother = *getSmoother(feedback_);
+  const bool feedbackActive =
+      feedbackSmoother.isRamping() || feedbackSmoother.getCurrent() != 0.0f;
+  const float *times = timeSmoother.processBlock(nFrames);
+  const float *feedbacks = feedbackSmoother.processBlock(nFrames);
+  const float *mixes = getSmoother(mix_)->processBlock(nFrames);
+  const float *mod = inputs[numChannels_];
+  if (feedbackSmoother.getTarget() != cachedFeedback_) {
+    // Echoes already in the line were declared with the previous tail:
+    // keep a longer one until they have had that long to fade.
+    const int previous = getTailLength();
+    updateTail(feedbackSmoother.getTarget());
+    const int tail = getTailLength();
+    if (previous == kInfiniteTail ||
+        (tail != kInfiniteTail && previous > tail)) {
+      setTailLength(previous);
+      tailHoldFrames_ = previous == kInfiniteTail ? INT_MAX : previous;
+    } else {
+      tailHoldFrames_ = 0;
+    }
+  } else if (tailHoldFrames_ > 0) {
+    tailHoldFrames_ -= std::min(tailHoldFrames_, nFrames);
+    if (tailHoldFrames_ == 0) {
+      updateTail(cachedFeedback_);
+    }
+  }
+
+  const DelayInterpolation interpolation = static_cast<DelayInterpolation>(
+      std::min(std::max(getParam(interpolation_)->asInt(), 0),
+               static_cast<int>(DelayInterpolation::AllPass)));
+  if (interpolation != cachedInterpolation_) {
+    cachedInterpolation_ = interpolation;
+    std::fill(allPassState_.begin(), allPassState_.end(), 0.0f);
+  }
+
+  // Delays in frames, shared by the channels.
+  float *delays = delays_.data();
+  const float framesPerMs = static_cast<float>(sampleRate_) / 1000.0f;
+  {
+    const Float4 scale = Float4::set1(framesPerMs);
+    const Float4 lo = Float4::set1(kMinDelayFrames);
+    const Float4 hi = Float4::set1(maxDelayFrames_);
+    int i = 0;
+    for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+      simd::clamp((Float4::load(times + i) + Float4::load(mod + i)) * scale,
+                  lo, hi)
+          .store(delays + i);
+    }
+    for (; i < nFrames; ++i) {
+      delays[i] = std::min(std::max((times[i] + mod[i]) * framesPerMs,
+                                    kMinDelayFrames),
+                           maxDelayFrames_);
+    }
+  }
+  bool fixed = true;
+  float shortest = delays[0];
+  for (int i = 1; i < nFrames; ++i) {
+    fixed = fixed && delays[i] == delays[0];
+    shortest = std::min(shortest, delays[i]);
+  }
+  // With feedback, a run may only read frames written before it starts.
+  const int run = feedbackActive ? static_cast<int>(shortest) - 1 : nFrames;
+
+  // The taps reach back from the write position; start the window in the
+  // second copy of the ring when they would reach before the first.
+  const size_t capacity = lines_[0].getCapacity();
+  const size_t origin = writePosition_ >= reach_ ? writePosition_
+                                                 : writePosition_ + capacity;
+
+  for (int c = 0; c < numChannels_; ++c) {
+    const float *in = inputs[c];
+    float *out = outputs[c];
+    MirroredRingBuffer &line = lines_[c];
+    float *x = line.data() + origin;
+    if (!feedbackActive) {
+      std::copy(in, in + nFrames, x);
+    }
+    for (int begin = 0; begin < nFrames; begin += run) {
+      const int end = std::min(begin + run, nFrames);
+      switch (interpolation) {
+      case DelayInterpolation::Cubic:
+        if (fixed) {
+          readCubicFixed(x, delays[0], out, begin, end);
+        } else {
+          readCubic(x, delays, out, begin, end);
+        }
+        break;
+      case DelayInterpolation::AllPass:
+        if (fixed) {
+          readAllPass<true>(x, delays, out, begin, end, allPassState_[c]);
+        } else {
+          readAllPass<false>(x, delays, out, begin, end, allPassState_[c]);
+        }
+        break;
+      case DelayInterpolation::Linear:
+      default:
+        if (fixed) {
+          readLinearFixed(x, delays[0], out, begin, end);
+        } else {
+          readLinear(x, delays, out, begin, end);
+        }
+        break;
+      }
+      if (feedbackActive) {
+        for (int i = begin; i < end; ++i) {
+          const float feedback =
+              std::min(std::max(feedbacks[i], -kMaxFeedback), kMaxFeedback);
+          x[i] = in[i] + feedback * out[i];
+        }
+      }
+    }
+    line.commit(origin, nFrames);
+
+    // out = in + mix * (wet - in).
+    int i = 0;
+    for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+      const Float4 dry = Float4::load(in + i);
+      (dry + Float4::load(mixes + i) * (Float4::load(out + i) - dry))
+          .store(out + i);
+    }
+    for (; i < nFrames; ++i) {
+      out[i] = in[i] + mixes[i] * (out[i] - in[i]);
+    }
+  }
+  writePosition_ = (writePosition_ + nFrames) % capacity;
+}
+
+} // namespace ms
@@ -0,0 +1,43 @@
+#include "Denormals.hpp"
+#include <cstring>
+
+namespace ms {
+
+namespace {
+
+/**
+ * Counts the samples whose exponent field is all zeros with a non-zero
+ * mantissa (subnormal) or all ones (infinite or NaN). Branch-free, so the
+ * loop vectorizes.
+ */
+template <typename Sample, typename Bits>
+SampleFaults scan(const Sample *samples, int count, Bits exponentMask,
+                  Bits mantissaMask) {
+  static_assert(sizeof(Sample) == sizeof(Bits), "bit type must match");
+  uint64_t subnormal = 0;
+  uint64_t nonFinite = 0;
+  for (int i = 0; i < count; ++i) {
+    Bits bits;
+    std::memcpy(&bits, samples + i, sizeof(bits));
+    const Bits exponent = bits & exponentMask;
+    subnormal += (exponent == 0) & ((bits & mantissaMask) != 0);
+    nonFinite += exponent == exponentMask;
+  }
+  SampleFaults faults;
+  faults.subnormal = subnormal;
+  faults.nonFinite = nonFinite;
+  return faults;
+}
+
+} // namespace
+
+SampleFaults scanSamples(const float *samples, int count) {
+  return scan<float, uint32_t>(samples, count, 0x7F800000u, 0x007FFFFFu);
+}
+
+SampleFaults scanSamples(const double *samples, int count) {
+  return scan<double, uint64_t>(samples, count, 0x7FF0000000000000ull,
+                                0x000FFFFFFFFFFFFFull);
+}
+
+} // namespace ms
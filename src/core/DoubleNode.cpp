@@ -0,0 +1,40 @@
+#include "DoubleNode.hpp"
+#include "SampleConversion.hpp"
+
+namespace ms {
+
+void DoubleNode::process(const float *const *inputs, float **outputs,
+                         int nFrames) {
+  int numInputs = 0;
+  int numOutputs = 0;
+  for (const auto &port : inputPorts_) {
+    numInputs += port.type == PortType::Audio;
+  }
+  for (const auto &port : outputPorts_) {
+    numOutputs += port.type == PortType::Audio;
+  }
+
+  scratch_.resize(numInputs + numOutputs);
+  scratchInputs_.resize(numInputs);
+  scratchOutputs_.resize(numOutputs);
+  for (int p = 0; p < numInputs + numOutputs; ++p) {
+    if (static_cast<int>(scratch_[p].size()) < nFrames) {
+      scratch_[p].resize(nFrames);
+    }
+  }
+  for (int p = 0; p < numInputs; ++p) {
+    convertSamples(inputs[p], scratch_[p].data(), nFrames);
+    scratchInputs_[p] = scratch_[p].data();
+  }
+  for (int p = 0; p < numOutputs; ++p) {
+    scratchOutputs_[p] = scratch_[numInputs + p].data();
+  }
+
+  processDouble(scratchInputs_.data(), scratchOutputs_.data(), nFrames);
+
+  for (int p = 0; p < numOutputs; ++p) {
+    convertSamples(scratchOutputs_[p], outputs[p], nFrames);
+  }
+}
+
+} // namespace ms
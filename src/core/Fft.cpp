@@ -0,0 +1,220 @@
+#include "Fft.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace ms {
+
+namespace {
+
+using simd::Float4;
+
+constexpr double kTwoPi = 6.283185307179586;
+
+} // namespace
+
+RealFft::RealFft(int size) : size_(kMinSize) {
+  while (size_ < size) {
+    size_ <<= 1;
+  }
+  half_ = size_ / 2;
+
+  twiddleRe_.resize(half_ / 2);
+  twiddleIm_.resize(half_ / 2);
+  for (int j = 0; j < half_ / 2; ++j) {
+    const double angle = -kTwoPi * j / half_;
+    twiddleRe_[j] = static_cast<float>(std::cos(angle));
+    twiddleIm_[j] = static_cast<float>(std::sin(angle));
+  }
+  pairedRe_.resize(half_ / 2);
+  pairedIm_.resize(half_ / 2);
+  for (int i = 0; i < half_ / 2; ++i) {
+    pairedRe_[i] = twiddleRe_[i & ~1];
+    pairedIm_[i] = twiddleIm_[i & ~1];
+  }
+  splitRe_.resize(half_);
+  splitIm_.resize(half_);
+  for (int k = 0; k < half_; ++k) {
+    const double angle = kTwoPi * k / size_;
+    splitRe_[k] = static_cast<float>(std::cos(angle));
+    splitIm_[k] = static_cast<float>(-std::sin(angle));
+  }
+  for (int b = 0; b < 2; ++b) {
+    bufferRe_[b].assign(half_ + 1, 0.0f);
+    bufferIm_[b].assign(half_ + 1, 0.0f);
+  }
+}
+
+size_t RealFft::getMemoryBytes() const {
+  size_t floats = twiddleRe_.size() + twiddleIm_.size() + pairedRe_.size() +
+                  pairedIm_.size() + splitRe_.size() + splitIm_.size();
+  for (int b = 0; b < 2; ++b) {
+    floats += bufferRe_[b].size() + bufferIm_[b].size();
+  }
+  return floats * sizeof(float);
+}
+
+void RealFft::transform(float *&re, float *&im, float *&otherRe,
+                        float *&otherIm) {
+  // Stockham, decimation in frequency: the stage with stride s reads
+  // a = x[q + s p] and b = x[q + s (p + m)] and writes a + b to
+  // y[q + 2 s p] and (a - b) w^p to y[q + 2 s p + s].
+
+  // Stride 1: the butterflies of one vector write interleaved outputs.
+  const int firstHalf = half_ / 2;
+  for (int p = 0; p < firstHalf; p += simd::kWidth) {
+    const Float4 ar = Float4::load(re + p);
+    const Float4 ai = Float4::load(im + p);
+    const Float4 br = Float4::load(re + p + firstHalf);
+    const Float4 bi = Float4::load(im + p + firstHalf);
+    const Float4 wr = Float4::load(twiddleRe_.data() + p);
+    const Float4 wi = Float4::load(twiddleIm_.data() + p);
+    const Float4 sr = ar + br;
+    const Float4 si = ai + bi;
+    const Float4 dr = ar - br;
+    const Float4 di = ai - bi;
+    const Float4 tr = dr * wr - di * wi;
+    const Float4 ti = dr * wi + di * wr;
+    simd::zipLo(sr, tr).store(otherRe + 2 * p);
+    simd::zipHi(sr, tr).store(otherRe + 2 * p + 4);
+    simd::zipLo(si, ti).store(otherIm + 2 * p);
+    simd::zipHi(si, ti).store(otherIm + 2 * p + 4);
+  }
+  std::swap(re, otherRe);
+  std::swap(im, otherIm);
+
+  // Stride 2: one vector holds two butterflies of two points each.
+  const int secondHalf = half_ / 4;
+  for (int p = 0; p < secondHalf; p += 2) {
+    const Float4 ar = Float4::load(re + 2 * p);
+    const Float4 ai = Float4::load(im + 2 * p);
+    const Float4 br = Float4::load(re + 2 * (p + secondHalf));
+    const Float4 bi = Float4::load(im + 2 * (p + secondHalf));
+    const Float4 wr = Float4::load(pairedRe_.data() + 2 * p);
+    const Float4 wi = Float4::load(pairedIm_.data() + 2 * p);
+    const Float4 sr = ar + br;
+    const Float4 si = ai + bi;
+    const Float4 dr = ar - br;
+    const Float4 di = ai - bi;
+    const Float4 tr = dr * wr - di * wi;
+    const Float4 ti = dr * wi + di * wr;
+    simd::lowHalves(sr, tr).store(otherRe + 4 * p);
+    simd::highHalves(sr, tr).store(otherRe + 4 * p + 4);
+    simd::lowHalves(si, ti).store(otherIm + 4 * p);
+    simd::highHalves(si, ti).store(otherIm + 4 * p + 4);
+  }
+  std::swap(re, otherRe);
+  std::swap(im, otherIm);
+
+  // Stride 4 and up: vectors run along q with one twiddle per p.
+  for (int s = 4; s < half_; s *= 2) {
+    const int m = half_ / (2 * s);
+    for (int p = 0; p < m; ++p) {
+      const Float4 wr = Float4::set1(twiddleRe_[p * s]);
+      const Float4 wi = Float4::set1(twiddleIm_[p * s]);
+      const float *xr0 = re + s * p;
+      const float *xi0 = im + s * p;
+      const float *xr1 = re + s * (p + m);
+      const float *xi1 = im + s * (p + m);
+      float *yr0 = otherRe + 2 * s * p;
+      float *yi0 = otherIm + 2 * s * p;
+      for (int q = 0; q < s; q += simd::kWidth) {
+        const Float4 ar = Float4::load(xr0 + q);
+        const Float4 ai = Float4::load(xi0 + q);
+        const Float4 br = Float4::load(xr1 + q);
+        const Float4 bi = Float4::load(xi1 + q);
+        const Float4 dr = ar - br;
+        const Float4 di = ai - bi;
+        (ar + br).store(yr0 + q);
+        (ai + bi).store(yi0 + q);
+        (dr * wr - di * wi).store(yr0 + s + q);
+        (dr * wi + di * wr).store(yi0 + s + q);
+      }
+    }
+    std::swap(re, otherRe);
+    std::swap(im, otherIm);
+  }
+}
+
+void RealFft::forward(const float *input, float *re, float *im) {
+  float *zr = bufferRe_[0].data();
+  float *zi = bufferIm_[0].data();
+  float *otherRe = bufferRe_[1].data();
+  float *otherIm = bufferIm_[1].data();
+
+  // z[n] = x[2n] + i x[2n + 1].
+  for (int n = 0; n < half_; n += simd::kWidth) {
+    const Float4 a = Float4::load(input + 2 * n);
+    const Float4 b = Float4::load(input + 2 * n + 4);
+    simd::evenLanes(a, b).store(zr + n);
+    simd::oddLanes(a, b).store(zi + n);
+  }
+  transform(zr, zi, otherRe, otherIm);
+  zr[half_] = zr[0];
+  zi[half_] = zi[0];
+
+  // X[k] = (Z[k] + conj Z[M - k]) / 2 + w^k (Z[k] - conj Z[M - k]) / 2i,
+  // with M = N / 2 and Z[M] = Z[0]. One reversed load fetches Z[M - k].
+  const Float4 half = Float4::set1(0.5f);
+  for (int k = 0; k < half_; k += simd::kWidth) {
+    const Float4 ar = Float4::load(zr + k);
+    const Float4 ai = Float4::load(zi + k);
+    const Float4 br = simd::reverse(Float4::load(zr + half_ - k - 3));
+    const Float4 bi = simd::reverse(Float4::load(zi + half_ - k - 3));
+    const Float4 c = Float4::load(splitRe_.data() + k);
+    const Float4 s = Float4::load(splitIm_.data() + k);
+    const Float4 sumRe = ar + br;
+    const Float4 diffIm = ai - bi;
+    const Float4 sumIm = ai + bi;
+    const Float4 diffRe = ar - br;
+    (half * (sumRe + c * sumIm + s * diffRe)).store(re + k);
+    (half * (diffIm - c * diffRe + s * sumIm)).store(im + k);
+  }
+  re[0] = zr[0] + zi[0];
+  im[0] = zr[0] - zi[0];
+}
+
+void RealFft::inverse(const float *re, const float *im, float *output) {
+  float *xr = bufferRe_[1].data();
+  float *xi = bufferIm_[1].data();
+  float *zr = bufferRe_[0].data();
+  float *zi = bufferIm_[0].data();
+
+  // Unpack bin 0 and the Nyquist bin so that X[M - k] is one load away.
+  std::copy(re, re + half_, xr);
+  std::copy(im, im + half_, xi);
+  xr[half_] = im[0];
+  xi[half_] = 0.0f;
+  xi[0] = 0.0f;
+
+  // 2 Z[k] = (X[k] + conj X[M - k]) + i w^-k (X[k] - conj X[M - k]).
+  for (int k = 0; k < half_; k += simd::kWidth) {
+    const Float4 ar = Float4::load(xr + k);
+    const Float4 ai = Float4::load(xi + k);
+    const Float4 br = simd::reverse(Float4::load(xr + half_ - k - 3));
+    const Float4 bi = simd::reverse(Float4::load(xi + half_ - k - 3));
+    const Float4 c = Float4::load(splitRe_.data() + k);
+    const Float4 s = Float4::load(splitIm_.data() + k);
+    const Float4 sumRe = ar + br;
+    const Float4 diffIm = ai - bi;
+    const Float4 sumIm = ai + bi;
+    const Float4 diffRe = ar - br;
+    (sumRe - c * sumIm + s * diffRe).store(zr + k);
+    (diffIm + c * diffRe + s * sumIm).store(zi + k);
+  }
+
+  // The inverse is the forward transform with real and imaginary parts
+  // exchanged on the way in and out.
+  float *swappedRe = zi;
+  float *swappedIm = zr;
+  transform(swappedRe, swappedIm, xr, xi);
+  for (int n = 0; n < half_; n += simd::kWidth) {
+    const Float4 even = Float4::load(swappedIm + n);
+    const Float4 odd = Float4::load(swappedRe + n);
+    simd::zipLo(even, odd).store(output + 2 * n);
+    simd::zipHi(even, odd).store(output + 2 * n + 4);
+  }
+}
+
+} // namespace ms
@@ -0,0 +1,585 @@
+#include "FilterNode.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace ms {
+
+namespace {
+
+using simd::Float4;
+
+constexpr float kPi = 3.14159265358979f;
+
+/** Lowest cutoff, and highest as a fraction of the sample rate. */
+constexpr float kMinCutoff = 1.0f;
+constexpr float kMaxCutoffRatio = 0.49f;
+
+/**
+ * tan(x) for x in (0, pi/2). A [5/4] Pade approximant on [0, pi/4]
+ * (relative error about 1e-8), and tan(x) = 1 / tan(pi/2 - x) above.
+ */
+inline Float4 fastTan(Float4 x) {
+  const simd::UInt4 upper = simd::lessThan(Float4::set1(0.25f * kPi), x);
+  const Float4 z = simd::select(upper, Float4::set1(0.5f * kPi) - x, x);
+  const Float4 z2 = z * z;
+  const Float4 num =
+      z * (Float4::set1(945.0f) + z2 * (z2 - Float4::set1(105.0f)));
+  const Float4 den = Float4::set1(945.0f) +
+                     z2 * (z2 * Float4::set1(15.0f) - Float4::set1(420.0f));
+  return simd::select(upper, den, num) / simd::select(upper, num, den);
+}
+
+/**
+ * Output mix of a mode: m0 * input + (kScale * k) * band + m2 * low, for
+ * damping k = 1 / Q.
+ */
+struct ModeMix {
+  float m0, kScale, m2;
+};
+
+ModeMix mixFor(FilterMode mode) {
+  switch (mode) {
+  case FilterMode::HighPass:
+    return {1.0f, -1.0f, -1.0f};
+  case FilterMode::BandPass:
+    return {0.0f, 1.0f, 0.0f};
+  case FilterMode::Notch:
+    return {1.0f, -1.0f, 0.0f};
+  case FilterMode::AllPass:
+    return {1.0f, -2.0f, 0.0f};
+  case FilterMode::LowPass:
+  default:
+    return {0.0f, 0.0f, 1.0f};
+  }
+}
+
+/** Coefficients of a lane without a section: output = input. */
+constexpr float kPassThrough[6] = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+
+/** One trapezoidal SVF step on four lanes. */
+inline Float4 tick(Float4 x, Float4 &s1, Float4 &s2, Float4 a1, Float4 a2,
+                   Float4 a3, Float4 m0, Float4 m1, Float4 m2) {
+  const Float4 v3 = x - s2;
+  const Float4 v1 = a1 * s1 + a2 * v3;
+  const Float4 v2 = s2 + a2 * s1 + a3 * v3;
+  s1 = v1 + v1 - s1;
+  s2 = v2 + v2 - s2;
+  return m0 * x + m1 * v1 + m2 * v2;
+}
+
+/**
+ * Runs four lanes through run(x, frame), one frame per call. Four frames
+ * at a time are transposed so that each vector holds one frame of every
+ * lane.
+ */
+template <typename Run>
+inline void runTransposed(const float *const *in, float *const *out,
+                          int nFrames, Run &&run) {
+  int i = 0;
+  for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+    Float4 x0 = Float4::load(in[0] + i);
+    Float4 x1 = Float4::load(in[1] + i);
+    Float4 x2 = Float4::load(in[2] + i);
+    Float4 x3 = Float4::load(in[3] + i);
+    simd::transpose(x0, x1, x2, x3);
+    x0 = run(x0, i);
+    x1 = run(x1, i + 1);
+    x2 = run(x2, i + 2);
+    x3 = run(x3, i + 3);
+    simd::transpose(x0, x1, x2, x3);
+    x0.store(out[0] + i);
+    x1.store(out[1] + i);
+    x2.store(out[2] + i);
+    x3.store(out[3] + i);
+  }
+  for (; i < nFrames; ++i) {
+    float lanes[simd::kWidth];
+    run(Float4::set(in[0][i], in[1][i], in[2][i], in[3][i]), i).store(lanes);
+    for (int l = 0; l < simd::kWidth; ++l) {
+      out[l][i] = lanes[l];
+    }
+  }
+}
+
+} // namespace
+
+FilterNode::FilterNode(const std::string &id, int numChannels,
+                       int numSections, FilterMode mode)
+    : StaticNode<FilterNode>(id), numChannels_(std::max(numChannels, 1)),
+      numSections_(std::min(std::max(numSections, 1), kMaxSections)),
+      sectionsInLanes_(numChannels_ < simd::kWidth &&
+                       numSections_ > numChannels_) {
+  for (int c = 0; c < numChannels_; ++c) {
+    addInputPort("in" + std::to_string(c), PortType::Audio);
+  }
+  for (int c = 0; c < numChannels_; ++c) {
+    addOutputPort("out" + std::to_string(c), PortType::Audio);
+  }
+  cutoff_ = addSmoothedParam("cutoff", 1000.0f, 20.0f,
+                             SmoothingType::Exponential);
+  q_ = addSmoothedParam("q", 0.7071f);
+  mode_ = addParam("mode", static_cast<int>(mode));
+
+  // Butterworth poles of order 2n: Q_s = 1 / (2 cos((2s + 1) pi / 4n)).
+  for (int s = 0; s < numSections_; ++s) {
+    const double theta = (2 * s + 1) * 3.14159265358979 / (4 * numSections_);
+    sectionQ_[s] =
+        static_cast<float>(1.0 / (2.0 * std::cos(theta)) / std::sqrt(0.5));
+  }
+
+  const size_t groups = (numChannels_ + simd::kWidth - 1) / simd::kWidth;
+  state_.assign(groups * numSections_ * 2 * simd::kWidth, 0.0f);
+}
+
+void FilterNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  if (sectionsInLanes_) {
+    const size_t passes = (numSections_ + simd::kWidth - 1) / simd::kWidth;
+    skewedCoefficients_.assign(passes * kCoefficientCount *
+                                   (blockSize + simd::kWidth - 1) *
+                                   simd::kWidth,
+                               0.0f);
+    paddedCutoff_.assign(blockSize + 2 * (simd::kWidth - 1), 0.0f);
+    paddedQ_.assign(blockSize + 2 * (simd::kWidth - 1), 0.0f);
+  } else {
+    modulatedCoefficients_.assign(
+        static_cast<size_t>(numSections_) * kCoefficientCount * blockSize,
+        0.0f);
+  }
+  silence_.assign(blockSize, 0.0f);
+  scratch_.assign(blockSize, 0.0f);
+  cachedSampleRate_ = 0;
+  // Resonances decay below the sleep threshold well within 50 ms unless
+  // q is extreme; the output level is checked as well before sleeping.
+  setTailLength(sampleRate / 20);
+  reset();
+}
+
+void FilterNode::reset() { std::fill(state_.begin(), state_.end(), 0.0f); }
+
+FilterMode FilterNode::currentMode() const {
+  return static_cast<FilterMode>(
+      std::min(std::max(getParam(mode_)->asInt(), 0),
+               static_cast<int>(FilterMode::AllPass)));
+}
+
+bool FilterNode::updateFixedCoefficients() {
+  const SmoothedValue &cutoff = *getSmoother(cutoff_);
+  const SmoothedValue &q = *getSmoother(q_);
+  if (cutoff.isRamping() || q.isRamping()) {
+    return false;
+  }
+  updateCoefficients(cutoff.getCurrent(), q.getCurrent(), currentMode());
+  return true;
+}
+
+void FilterNode::updateCoefficients(float cutoff, float q, FilterMode mode) {
+  if (cutoff == cachedCutoff_ && q == cachedQ_ && mode == cachedMode_ &&
+      sampleRate_ == cachedSampleRate_) {
+    return;
+  }
+  cachedCutoff_ = cutoff;
+  cachedQ_ = q;
+  cachedMode_ = mode;
+  cachedSampleRate_ = sampleRate_;
+
+  const float rate = static_cast<float>(sampleRate_);
+  const float fc = std::min(std::max(cutoff, kMinCutoff), kMaxCutoffRatio * rate);
+  const float g = std::tan(kPi * fc / rate);
+  const ModeMix mix = mixFor(mode);
+  for (int s = 0; s < numSections_; ++s) {
+    Coefficients &c = coefficients_[s];
+    const float k = 1.0f / std::max(q * sectionQ_[s], 1e-3f);
+    c.a1 = 1.0f / (1.0f + g * (g + k));
+    c.a2 = g * c.a1;
+    c.a3 = g * c.a2;
+    c.m0 = mix.m0;
+    c.m1 = mix.kScale * k;
+    c.m2 = mix.m2;
+  }
+}
+
+void FilterNode::computeModulatedCoefficients(const float *cutoff,
+                                              const float *q, int nFrames,
+                                              FilterMode mode) {
+  const float rate = static_cast<float>(sampleRate_);
+  const Float4 minCutoff = Float4::set1(kMinCutoff);
+  const Float4 maxCutoff = Float4::set1(kMaxCutoffRatio * rate);
+  const Float4 piOverRate = Float4::set1(kPi / rate);
+  const Float4 one = Float4::set1(1.0f);
+  const Float4 minQ = Float4::set1(1e-3f);
+  const size_t stride = static_cast<size_t>(blockSize_);
+  const ModeMix mix = mixFor(mode);
+
+  // A partial last vector repeats the last frame in its spare lanes and
+  // only stores the frames that exist.
+  for (int i = 0; i < nFrames; i += simd::kWidth) {
+    const int count = std::min(simd::kWidth, nFrames - i);
+    Float4 fc;
+    Float4 qv;
+    if (count == simd::kWidth) {
+      fc = Float4::load(cutoff + i);
+      qv = Float4::load(q + i);
+    } else {
+      float fcIn[simd::kWidth];
+      float qIn[simd::kWidth];
+      for (int l = 0; l < simd::kWidth; ++l) {
+        fcIn[l] = cutoff[i + std::min(l, count - 1)];
+        qIn[l] = q[i + std::min(l, count - 1)];
+      }
+      fc = Float4::load(fcIn);
+      qv = Float4::load(qIn);
+    }
+    const Float4 g = fastTan(simd::clamp(fc, minCutoff, maxCutoff) * piOverRate);
+    for (int s = 0; s < numSections_; ++s) {
+      const Float4 k =
+          one / simd::max(qv * Float4::set1(sectionQ_[s]), minQ);
+      Float4 c[kCoefficientCount];
+      c[0] = one / (one + g * (g + k));
+      c[1] = g * c[0];
+      c[2] = g * c[1];
+      c[3] = Float4::set1(mix.m0);
+      c[4] = Float4::set1(mix.kScale) * k;
+      c[5] = Float4::set1(mix.m2);
+      for (int n = 0; n < kCoefficientCount; ++n) {
+        float *dst = modulatedCoefficients_.data() +
+                     (s * kCoefficientCount + n) * stride + i;
+        if (count == simd::kWidth) {
+          c[n].store(dst);
+        } else {
+          float lanes[simd::kWidth];
+          c[n].store(lanes);
+          std::copy(lanes, lanes + count, dst);
+        }
+      }
+    }
+  }
+}
+
+void FilterNode::computeSkewedCoefficients(const float *cutoff,
+                                           const float *q, int nFrames,
+                                           FilterMode mode) {
+  // Pad the ramps so that, at every pipeline step j, one reversed load
+  // yields frames j, j - 1, j - 2 and j - 3 for lanes 0 ... 3.
+  const int pad = simd::kWidth - 1;
+  for (int i = -pad; i < nFrames + pad; ++i) {
+    const int frame = std::min(std::max(i, 0), nFrames - 1);
+    paddedCutoff_[i + pad] = cutoff[frame];
+    paddedQ_[i + pad] = q[frame];
+  }
+
+  const float rate = static_cast<float>(sampleRate_);
+  const Float4 minCutoff = Float4::set1(kMinCutoff);
+  const Float4 maxCutoff = Float4::set1(kMaxCutoffRatio * rate);
+  const Float4 piOverRate = Float4::set1(kPi / rate);
+  const Float4 one = Float4::set1(1.0f);
+  const Float4 minQ = Float4::set1(1e-3f);
+  const ModeMix mix = mixFor(mode);
+  const size_t stride =
+      static_cast<size_t>(blockSize_ + pad) * simd::kWidth;
+  const int steps = nFrames + pad;
+
+  for (int base = 0; base < numSections_; base += simd::kWidth) {
+    const int lanes = std::min(simd::kWidth, numSections_ - base);
+    const simd::UInt4 used = simd::lessThan(
+        Float4::set(0.0f, 1.0f, 2.0f, 3.0f),
+        Float4::set1(static_cast<float>(lanes)));
+    const Float4 sectionQ = Float4::load(sectionQ_ + base);
+    Float4 passThrough[kCoefficientCount];
+    for (int n = 0; n < kCoefficientCount; ++n) {
+      passThrough[n] = Float4::set1(kPassThrough[n]);
+    }
+    float *row = skewedCoefficients_.data() +
+                 (base / simd::kWidth) * kCoefficientCount * stride;
+
+    for (int j = 0; j < steps; ++j) {
+      const Float4 fc = simd::reverse(Float4::load(paddedCutoff_.data() + j));
+      const Float4 qv = simd::reverse(Float4::load(paddedQ_.data() + j));
+      const Float4 g =
+          fastTan(simd::clamp(fc, minCutoff, maxCutoff) * piOverRate);
+      const Float4 k = one / simd::max(qv * sectionQ, minQ);
+      Float4 c[kCoefficientCount];
+      c[0] = one / (one + g * (g + k));
+      c[1] = g * c[0];
+      c[2] = g * c[1];
+      c[3] = Float4::set1(mix.m0);
+      c[4] = Float4::set1(mix.kScale) * k;
+      c[5] = Float4::set1(mix.m2);
+      for (int n = 0; n < kCoefficientCount; ++n) {
+        simd::select(used, c[n], passThrough[n])
+            .store(row + n * stride + j * simd::kWidth);
+      }
+    }
+  }
+}
+
+void FilterNode::render(const float *const *inputs, float **outputs,
+                        int nFrames) {
+  if (updateFixedCoefficients()) {
+    if (sectionsInLanes_) {
+      filterSections<false>(inputs, outputs, nFrames);
+    } else {
+      filterChannels<false>(inputs, outputs, nFrames);
+    }
+    return;
+  }
+  const float *cutoffs = getSmoother(cutoff_)->processBlock(nFrames);
+  const float *qs = getSmoother(q_)->processBlock(nFrames);
+  const FilterMode mode = currentMode();
+  if (sectionsInLanes_) {
+    computeSkewedCoefficients(cutoffs, qs, nFrames, mode);
+    filterSections<true>(inputs, outputs, nFrames);
+  } else {
+    computeModulatedCoefficients(cutoffs, qs, nFrames, mode);
+    filterChannels<true>(inputs, outputs, nFrames);
+  }
+}
+
+void FilterNode::processBatch(Node *const *nodes, int count,
+                              const float *const *const *inputs,
+                              float **const *outputs, int nFrames) {
+  // Steady mono filters wait in a group per cascade length until four of
+  // them fill a vector.
+  FilterNode *group[kMaxSections][simd::kWidth];
+  const float *groupInputs[kMaxSections][simd::kWidth];
+  float *groupOutputs[kMaxSections][simd::kWidth];
+  int filled[kMaxSections] = {};
+  for (int i = 0; i < count; ++i) {
+    FilterNode *node = static_cast<FilterNode *>(nodes[i]);
+    if (node->numChannels_ != 1 || !node->updateFixedCoefficients()) {
+      node->render(inputs[i], outputs[i], nFrames);
+      continue;
+    }
+    const int s = node->numSections_ - 1;
+    group[s][filled[s]] = node;
+    groupInputs[s][filled[s]] = inputs[i][0];
+    groupOutputs[s][filled[s]] = outputs[i][0];
+    if (++filled[s] == simd::kWidth) {
+      filterNodes(group[s], groupInputs[s], groupOutputs[s], simd::kWidth,
+                  nFrames);
+      filled[s] = 0;
+    }
+  }
+  // A filter left alone runs its own kernel, which keeps a long cascade
+  // in the lanes instead of leaving three of them idle.
+  for (int s = 0; s < kMaxSections; ++s) {
+    if (filled[s] > 1) {
+      filterNodes(group[s], groupInputs[s], groupOutputs[s], filled[s],
+                  nFrames);
+    } else if (filled[s] == 1) {
+      group[s][0]->render(&groupInputs[s][0], &groupOutputs[s][0], nFrames);
+    }
+  }
+}
+
+template <bool Modulated>
+void FilterNode::filterChannels(const float *const *inputs, float **outputs,
+                                int nFrames) {
+  const int numSections = numSections_;
+  const size_t stride = static_cast<size_t>(blockSize_);
+  const float *modulated = modulatedCoefficients_.data();
+
+  Float4 fixed[kMaxSections][kCoefficientCount];
+  if (!Modulated) {
+    for (int s = 0; s < numSections; ++s) {
+      const Coefficients &c = coefficients_[s];
+      fixed[s][0] = Float4::set1(c.a1);
+      fixed[s][1] = Float4::set1(c.a2);
+      fixed[s][2] = Float4::set1(c.a3);
+      fixed[s][3] = Float4::set1(c.m0);
+      fixed[s][4] = Float4::set1(c.m1);
+      fixed[s][5] = Float4::set1(c.m2);
+    }
+  }
+
+  // Runs one frame (four channels) through the cascade.
+  Float4 s1[kMaxSections];
+  Float4 s2[kMaxSections];
+  auto run = [&](Float4 x, int frame) {
+    for (int s = 0; s < numSections; ++s) {
+      if (Modulated) {
+        const float *c = modulated + s * kCoefficientCount * stride + frame;
+        x = tick(x, s1[s], s2[s], Float4::set1(c[0]),
+                 Float4::set1(c[stride]), Float4::set1(c[2 * stride]),
+                 Float4::set1(c[3 * stride]), Float4::set1(c[4 * stride]),
+                 Float4::set1(c[5 * stride]));
+      } else {
+        x = tick(x, s1[s], s2[s], fixed[s][0], fixed[s][1], fixed[s][2],
+                 fixed[s][3], fixed[s][4], fixed[s][5]);
+      }
+    }
+    return x;
+  };
+
+  for (int c0 = 0; c0 < numChannels_; c0 += simd::kWidth) {
+    const float *in[simd::kWidth];
+    float *out[simd::kWidth];
+    for (int l = 0; l < simd::kWidth; ++l) {
+      const bool used = c0 + l < numChannels_;
+      in[l] = used ? inputs[c0 + l] : silence_.data();
+      out[l] = used ? outputs[c0 + l] : scratch_.data();
+    }
+    float *state = state_.data() + static_cast<size_t>(c0) * numSections * 2;
+    for (int s = 0; s < numSections; ++s) {
+      s1[s] = Float4::load(state + (2 * s) * simd::kWidth);
+      s2[s] = Float4::load(state + (2 * s + 1) * simd::kWidth);
+    }
+
+    runTransposed(in, out, nFrames, run);
+
+    for (int s = 0; s < numSections; ++s) {
+      s1[s].store(state + (2 * s) * simd::kWidth);
+      s2[s].store(state + (2 * s + 1) * simd::kWidth);
+    }
+  }
+}
+
+template <bool Modulated>
+void FilterNode::filterSections(const float *const *inputs, float **outputs,
+                                int nFrames) {
+  const size_t stride =
+      static_cast<size_t>(blockSize_ + simd::kWidth - 1) * simd::kWidth;
+
+  for (int c = 0; c < numChannels_; ++c) {
+    const float *src = inputs[c];
+    float *dst = outputs[c];
+    // Cascades longer than the vector run in passes of four sections; later
+    // passes filter the output in place (each step writes behind its read).
+    for (int base = 0; base < numSections_; base += simd::kWidth) {
+      const int lanes = std::min(simd::kWidth, numSections_ - base);
+
+      float lane1[simd::kWidth] = {};
+      float lane2[simd::kWidth] = {};
+      float fixed[kCoefficientCount][simd::kWidth];
+      for (int l = 0; l < simd::kWidth; ++l) {
+        const bool used = l < lanes;
+        if (used) {
+          lane1[l] = state_[stateIndex(c, base + l, 0)];
+          lane2[l] = state_[stateIndex(c, base + l, 1)];
+        }
+        const Coefficients &k = coefficients_[used ? base + l : 0];
+        const float values[kCoefficientCount] = {k.a1, k.a2, k.a3,
+                                                 k.m0, k.m1, k.m2};
+        for (int n = 0; n < kCoefficientCount; ++n) {
+          fixed[n][l] = used ? values[n] : kPassThrough[n];
+        }
+      }
+      Float4 s1 = Float4::load(lane1);
+      Float4 s2 = Float4::load(lane2);
+      Float4 a[kCoefficientCount];
+      for (int n = 0; n < kCoefficientCount; ++n) {
+        a[n] = Float4::load(fixed[n]);
+      }
+
+      // At step j, lane l filters sample j - l. The first and last
+      // lanes - 1 steps have lanes without a sample; their state is kept.
+      Float4 y = Float4::zero();
+      const int steps = nFrames + lanes - 1;
+      for (int j = 0; j < steps; ++j) {
+        const Float4 x = simd::shiftIn(y, j < nFrames ? src[j] : 0.0f);
+        if (Modulated) {
+          const float *skewed =
+              skewedCoefficients_.data() +
+              (base / simd::kWidth) * kCoefficientCount * stride +
+              j * simd::kWidth;
+          for (int n = 0; n < kCoefficientCount; ++n) {
+            a[n] = Float4::load(skewed + n * stride);
+          }
+        }
+        Float4 n1 = s1;
+        Float4 n2 = s2;
+        y = tick(x, n1, n2, a[0], a[1], a[2], a[3], a[4], a[5]);
+        if (j >= lanes - 1 && j < nFrames) {
+          s1 = n1;
+          s2 = n2;
+        } else {
+          const uint32_t on = 0xFFFFFFFFu;
+          const simd::UInt4 valid = simd::UInt4::set(
+              j < nFrames ? on : 0u, j >= 1 && j - 1 < nFrames ? on : 0u,
+              j >= 2 && j - 2 < nFrames ? on : 0u,
+              j >= 3 && j - 3 < nFrames ? on : 0u);
+          s1 = simd::select(valid, n1, s1);
+          s2 = simd::select(valid, n2, s2);
+        }
+        if (j >= lanes - 1) {
+          float out[simd::kWidth];
+          y.store(out);
+          dst[j - lanes + 1] = out[lanes - 1];
+        }
+      }
+
+      s1.store(lane1);
+      s2.store(lane2);
+      for (int l = 0; l < lanes; ++l) {
+        state_[stateIndex(c, base + l, 0)] = lane1[l];
+        state_[stateIndex(c, base + l, 1)] = lane2[l];
+      }
+      src = dst;
+    }
+  }
+}
+
+void FilterNode::filterNodes(FilterNode *const *nodes,
+                             const float *const *inputs,
+                             float *const *outputs, int count, int nFrames) {
+  const int numSections = nodes[0]->numSections_;
+  Float4 a[kMaxSections][kCoefficientCount];
+  Float4 s1[kMaxSections];
+  Float4 s2[kMaxSections];
+  for (int s = 0; s < numSections; ++s) {
+    float values[kCoefficientCount][simd::kWidth];
+    float lane1[simd::kWidth] = {};
+    float lane2[simd::kWidth] = {};
+    for (int l = 0; l < simd::kWidth; ++l) {
+      if (l < count) {
+        const FilterNode &node = *nodes[l];
+        const Coefficients &k = node.coefficients_[s];
+        const float own[kCoefficientCount] = {k.a1, k.a2, k.a3,
+                                              k.m0, k.m1, k.m2};
+        for (int n = 0; n < kCoefficientCount; ++n) {
+          values[n][l] = own[n];
+        }
+        lane1[l] = node.state_[node.stateIndex(0, s, 0)];
+        lane2[l] = node.state_[node.stateIndex(0, s, 1)];
+      } else {
+        for (int n = 0; n < kCoefficientCount; ++n) {
+          values[n][l] = kPassThrough[n];
+        }
+      }
+    }
+    for (int n = 0; n < kCoefficientCount; ++n) {
+      a[s][n] = Float4::load(values[n]);
+    }
+    s1[s] = Float4::load(lane1);
+    s2[s] = Float4::load(lane2);
+  }
+
+  const float *in[simd::kWidth];
+  float *out[simd::kWidth];
+  for (int l = 0; l < simd::kWidth; ++l) {
+    in[l] = l < count ? inputs[l] : nodes[0]->silence_.data();
+    out[l] = l < count ? outputs[l] : nodes[0]->scratch_.data();
+  }
+  runTransposed(in, out, nFrames, [&](Float4 x, int) {
+    for (int s = 0; s < numSections; ++s) {
+      x = tick(x, s1[s], s2[s], a[s][0], a[s][1], a[s][2], a[s][3], a[s][4],
+               a[s][5]);
+    }
+    return x;
+  });
+
+  for (int s = 0; s < numSections; ++s) {
+    float lane1[simd::kWidth];
+    float lane2[simd::kWidth];
+    s1[s].store(lane1);
+    s2[s].store(lane2);
+    for (int l = 0; l < count; ++l) {
+      FilterNode &node = *nodes[l];
+      node.state_[node.stateIndex(0, s, 0)] = lane1[l];
+      node.state_[node.stateIndex(0, s, 1)] = lane2[l];
+    }
+  }
+}
+
+} // namespace ms
@@ -0,0 +1,185 @@
+#include "GainEnvelope.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ms {
+
+namespace {
+
+/** Frames whose gains are generated before being applied to all channels. */
+constexpr int kTileFrames = 64;
+
+/** Curvature of the exponential fade: e^K is about 60 dB. */
+constexpr float kExponentialCurvature = 6.907755f;
+
+constexpr float kHalfPi = 1.57079633f;
+
+/** out = dry + gain * (out - dry), or out *= gain without a dry signal. */
+void applyGains(float *out, const float *dry, const float *gains, int n) {
+  int i = 0;
+  if (dry) {
+    for (; i + simd::kWidth <= n; i += simd::kWidth) {
+      const simd::Float4 d = simd::Float4::load(dry + i);
+      (d + simd::Float4::load(gains + i) * (simd::Float4::load(out + i) - d))
+          .store(out + i);
+    }
+    for (; i < n; ++i) {
+      out[i] = dry[i] + gains[i] * (out[i] - dry[i]);
+    }
+    return;
+  }
+  for (; i + simd::kWidth <= n; i += simd::kWidth) {
+    (simd::Float4::load(out + i) * simd::Float4::load(gains + i)).store(out + i);
+  }
+  for (; i < n; ++i) {
+    out[i] *= gains[i];
+  }
+}
+
+/** Double-precision applyGains(); gains are generated in float. */
+void applyGains(double *out, const double *dry, const float *gains, int n) {
+  if (dry) {
+    for (int i = 0; i < n; ++i) {
+      out[i] = dry[i] + gains[i] * (out[i] - dry[i]);
+    }
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    out[i] *= gains[i];
+  }
+}
+
+} // namespace
+
+void GainEnvelope::startFadeIn(int lengthSamples, FadeCurve curve) {
+  curve_ = curve;
+  fadingOut_ = false;
+  length_ = lengthSamples;
+  position_ = 0;
+  state_ = lengthSamples > 0 ? State::Ramping : State::Idle;
+}
+
+void GainEnvelope::startFadeOut(int lengthSamples, FadeCurve curve) {
+  curve_ = curve;
+  fadingOut_ = true;
+  length_ = lengthSamples;
+  position_ = 0;
+  state_ = lengthSamples > 0 ? State::Ramping : State::Silent;
+}
+
+void GainEnvelope::nextGains(float *gains, int n) {
+  const int ramp = std::min(n, length_ - position_);
+  const float invLength = 1.0f / static_cast<float>(length_);
+  // Fade-outs run the fade-in curve backwards.
+  const float direction = fadingOut_ ? -1.0f : 1.0f;
+  const float t0 = fadingOut_ ? 1.0f - position_ * invLength
+                              : position_ * invLength;
+  const simd::Float4 t =
+      simd::Float4::set1(t0) +
+      simd::Float4::set(0.0f, 1.0f, 2.0f, 3.0f) *
+          simd::Float4::set1(direction * invLength);
+
+  switch (curve_) {
+  case FadeCurve::Linear: {
+    simd::Float4 g = t;
+    const simd::Float4 step = simd::Float4::set1(4.0f * direction * invLength);
+    for (int i = 0; i < ramp; i += simd::kWidth) {
+      g.store(gains + i);
+      g += step;
+    }
+    break;
+  }
+  case FadeCurve::EqualPower: {
+    // Rotate (sin, cos) of the quarter-sine phase four samples at a time.
+    alignas(16) float lanes[4];
+    t.store(lanes);
+    simd::Float4 s = simd::Float4::set(
+        std::sin(lanes[0] * kHalfPi), std::sin(lanes[1] * kHalfPi),
+        std::sin(lanes[2] * kHalfPi), std::sin(lanes[3] * kHalfPi));
+    simd::Float4 c = simd::Float4::set(
+        std::cos(lanes[0] * kHalfPi), std::cos(lanes[1] * kHalfPi),
+        std::cos(lanes[2] * kHalfPi), std::cos(lanes[3] * kHalfPi));
+    const float delta = 4.0f * direction * kHalfPi * invLength;
+    const simd::Float4 cosDelta = simd::Float4::set1(std::cos(delta));
+    const simd::Float4 sinDelta = simd::Float4::set1(std::sin(delta));
+    for (int i = 0; i < ramp; i += simd::kWidth) {
+      s.store(gains + i);
+      const simd::Float4 nextS = s * cosDelta + c * sinDelta;
+      c = c * cosDelta - s * sinDelta;
+      s = nextS;
+    }
+    break;
+  }
+  case FadeCurve::Exponential: {
+    alignas(16) float lanes[4];
+    t.store(lanes);
+    simd::Float4 u = simd::Float4::set(
+        std::exp(kExponentialCurvature * lanes[0]),
+        std::exp(kExponentialCurvature * lanes[1]),
+        std::exp(kExponentialCurvature * lanes[2]),
+        std::exp(kExponentialCurvature * lanes[3]));
+    const simd::Float4 ratio = simd::Float4::set1(
+        std::exp(4.0f * direction * kExponentialCurvature * invLength));
+    const simd::Float4 one = simd::Float4::set1(1.0f);
+    const simd::Float4 norm =
+        simd::Float4::set1(1.0f / (std::exp(kExponentialCurvature) - 1.0f));
+    for (int i = 0; i < ramp; i += simd::kWidth) {
+      ((u - one) * norm).store(gains + i);
+      u *= ratio;
+    }
+    break;
+  }
+  }
+
+  const float finalGain = fadingOut_ ? 0.0f : 1.0f;
+  std::fill(gains + ramp, gains + n, finalGain);
+
+  position_ += ramp;
+  if (position_ >= length_) {
+    state_ = fadingOut_ ? State::Silent : State::Idle;
+  }
+}
+
+void GainEnvelope::apply(float *const *buffers, const float *const *dry,
+                         int numChannels, int nFrames) {
+  applyTo(buffers, dry, numChannels, nFrames);
+}
+
+void GainEnvelope::apply(double *const *buffers, const double *const *dry,
+                         int numChannels, int nFrames) {
+  applyTo(buffers, dry, numChannels, nFrames);
+}
+
+template <typename T>
+void GainEnvelope::applyTo(T *const *buffers, const T *const *dry,
+                           int numChannels, int nFrames) {
+  // Vector stores may run up to three lanes past the ramp end.
+  alignas(16) float gains[kTileFrames + simd::kWidth];
+
+  int frame0 = 0;
+  while (frame0 < nFrames && state_ == State::Ramping) {
+    const int n = std::min(kTileFrames, nFrames - frame0);
+    nextGains(gains, n);
+    for (int c = 0; c < numChannels; ++c) {
+      const T *d = (dry && dry[c]) ? dry[c] + frame0 : nullptr;
+      applyGains(buffers[c] + frame0, d, gains, n);
+    }
+    frame0 += n;
+  }
+
+  if (state_ != State::Silent || frame0 >= nFrames) {
+    return;
+  }
+  const int n = nFrames - frame0;
+  for (int c = 0; c < numChannels; ++c) {
+    if (dry && dry[c]) {
+      std::memcpy(buffers[c] + frame0, dry[c] + frame0, sizeof(T) * n);
+    } else {
+      std::memset(buffers[c] + frame0, 0, sizeof(T) * n);
+    }
+  }
+}
+
+} // namespace ms
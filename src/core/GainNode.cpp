@@ -0,0 +1,12 @@
+#include "GainNode.hpp"
+
+namespace ms {
+
+GainNode::GainNode(const std::string &id) : StaticNode<GainNode>(id) {
+  addInputPort("in", PortType::Audio);
+  addOutputPort("out", PortType::Audio);
+  gain_ = addSmoothedParam("gain", 1.0f);
+  setTailLength(0);
+}
+
+} // namespace ms
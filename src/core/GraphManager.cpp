@@ -0,0 +1,1820 @@
+#include "GraphManager.hpp"
+#include "BuiltinNodes.hpp"
+#include "DoubleNode.hpp"
+#include "NodeRegistry.hpp"
+#include "PhysicalOutputNode.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+
+namespace ms {
+
+namespace {
+
+/**
+ * Returns the index of the named port among the ports of the given type, or
+ * -1 if no such port exists.
+ */
+int portIndex(const std::vector<Port> &ports, const std::string &name,
+              PortType type) {
+  int index = 0;
+  for (const auto &port : ports) {
+    if (port.type != type) {
+      continue;
+    }
+    if (port.name == name) {
+      return index;
+    }
+    ++index;
+  }
+  return -1;
+}
+
+/** Returns the named port, or nullptr if it does not exist. */
+const Port *findPort(const std::vector<Port> &ports, const std::string &name) {
+  for (const auto &port : ports) {
+    if (port.name == name) {
+      return &port;
+    }
+  }
+  return nullptr;
+}
+
+/** Returns the type of the named port, or nullptr if it does not exist. */
+const PortType *findPortType(const std::vector<Port> &ports,
+                             const std::string &name) {
+  const Port *port = findPort(ports, name);
+  return port ? &port->type : nullptr;
+}
+
+int countPorts(const std::vector<Port> &ports, PortType type) {
+  return static_cast<int>(std::count_if(
+      ports.begin(), ports.end(),
+      [type](const Port &port) { return port.type == type; }));
+}
+
+/** dst = sum of sources (each read from offset), vectorized. */
+void sumBuffers(const std::vector<const float *> &sources, int offset,
+                float *dst, int nFrames) {
+  std::memcpy(dst, sources[0] + offset, sizeof(float) * nFrames);
+  for (size_t s = 1; s < sources.size(); ++s) {
+    const float *src = sources[s] + offset;
+    int i = 0;
+    for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+      (simd::Float4::load(dst + i) + simd::Float4::load(src + i)).store(dst + i);
+    }
+    for (; i < nFrames; ++i) {
+      dst[i] += src[i];
+    }
+  }
+}
+
+/** Double-precision sumBuffers(). */
+void sumBuffers(const std::vector<const double *> &sources, int offset,
+                double *dst, int nFrames) {
+  std::memcpy(dst, sources[0] + offset, sizeof(double) * nFrames);
+  for (size_t s = 1; s < sources.size(); ++s) {
+    const double *src = sources[s] + offset;
+    for (int i = 0; i < nFrames; ++i) {
+      dst[i] += src[i];
+    }
+  }
+}
+
+/** Returns the largest magnitude among samples, vectorized. */
+float peakOf(const float *samples, int nFrames) {
+  simd::Float4 hi = simd::Float4::zero();
+  simd::Float4 lo = simd::Float4::zero();
+  int i = 0;
+  for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+    const simd::Float4 x = simd::Float4::load(samples + i);
+    hi = simd::max(hi, x);
+    lo = simd::min(lo, x);
+  }
+  float lanes[2 * simd::kWidth];
+  hi.store(lanes);
+  lo.store(lanes + simd::kWidth);
+  float peak = 0.0f;
+  for (int l = 0; l < simd::kWidth; ++l) {
+    peak = std::max(peak, std::max(lanes[l], -lanes[simd::kWidth + l]));
+  }
+  for (; i < nFrames; ++i) {
+    peak = std::max(peak, std::abs(samples[i]));
+  }
+  return peak;
+}
+
+/** Returns a start timestamp when the node is being profiled. */
+inline uint64_t profileBegin(const NodeProfile *profile) {
+#if MS_PROFILING
+  return profile ? ProfileClock::now() : 0;
+#else
+  (void)profile;
+  return 0;
+#endif
+}
+
+/** Records the time since start into one of the node's counters. */
+inline void profileEnd(NodeProfile *profile, ProfileCounter NodeProfile::*counter,
+                       uint64_t start) {
+#if MS_PROFILING
+  if (profile) {
+    (profile->*counter).record(ProfileClock::now() - start);
+  }
+#else
+  (void)profile;
+  (void)counter;
+  (void)start;
+#endif
+}
+
+/** Records the time since start as one process() call of the node. */
+inline void profileProcess(NodeProfile *profile, uint64_t start) {
+#if MS_PROFILING
+  if (profile) {
+    profile->recordProcess(ProfileClock::now() - start);
+  }
+#else
+  (void)profile;
+  (void)start;
+#endif
+}
+
+/**
+ * Merges sorted source queues into dst, keeping sampleOffset order.
+ * heads must hold at least sources.size() entries.
+ */
+void mergeEvents(const std::vector<const EventQueue *> &sources,
+                 size_t *heads, EventQueue &dst) {
+  dst.clear();
+  const size_t count = sources.size();
+  std::fill(heads, heads + count, size_t(0));
+  // Sources are few; a linear scan for the earliest head beats a heap.
+  for (;;) {
+    size_t best = count;
+    for (size_t s = 0; s < count; ++s) {
+      const EventSpan events = sources[s]->events();
+      if (heads[s] < events.size() &&
+          (best == count ||
+           events[heads[s]].sampleOffset <
+               sources[best]->events()[heads[best]].sampleOffset)) {
+        best = s;
+      }
+    }
+    if (best == count) {
+      return;
+    }
+    dst.push(sources[best]->events()[heads[best]++]);
+  }
+}
+
+/** Calls Node::process() through the vtable. */
+struct VirtualDispatch {
+  static void process(Node *node, const float *const *inputs, float **outputs,
+                      int nFrames) {
+    node->process(inputs, outputs, nFrames);
+  }
+};
+
+/** Calls the processBlock() of a built-in node type directly. */
+template <typename T> struct StaticDispatch {
+  static void process(Node *node, const float *const *inputs, float **outputs,
+                      int nFrames) {
+    static_cast<T *>(node)->processBlock(inputs, outputs, nFrames);
+  }
+};
+
+} // namespace
+
+GraphManager::GraphManager() {
+  pendingParamChanges_.reserve(paramChangeQueue_.capacity());
+}
+
+GraphManager::~GraphManager() {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  for (auto &entry : nodes_) {
+    entry.second->graph_ = nullptr;
+  }
+}
+
+NodePtr GraphManager::createNode(const std::string &id, NodePtr node) {
+  if (!node) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  purgeRetiredNodes();
+  if (nodes_.count(id)) {
+    return nullptr;
+  }
+
+  if (freeNodeSlots_.empty() &&
+      numNodeSlots_.load(std::memory_order_relaxed) ==
+          kNodeSlotsPerPage * kMaxNodeSlotPages) {
+    return nullptr;
+  }
+
+  node->graph_ = this;
+  if (isPrepared_) {
+    node->prepare(sampleRate_, blockSize_);
+    node->resetFadeIn();
+  }
+  nodes_[id] = node;
+
+  uint32_t slot;
+  if (!freeNodeSlots_.empty()) {
+    slot = freeNodeSlots_.back();
+    freeNodeSlots_.pop_back();
+  } else {
+    slot = numNodeSlots_.load(std::memory_order_relaxed);
+    if (slot % kNodeSlotsPerPage == 0) {
+      nodeSlotStorage_.emplace_back(new NodeSlot[kNodeSlotsPerPage]);
+      nodeSlotPages_[slot / kNodeSlotsPerPage].store(
+          nodeSlotStorage_.back().get(), std::memory_order_release);
+    }
+    numNodeSlots_.store(slot + 1, std::memory_order_release);
+  }
+  nodeSlot(slot).node.store(node.get(), std::memory_order_release);
+  nodeSlotIndex_[id] = slot;
+
+  needsBufferReallocation_ = true;
+  rebuildIfPrepared();
+  return node;
+}
+
+NodePtr GraphManager::createNode(const std::string &id,
+                                 const std::string &typeName) {
+  NodeRegistry::Entry entry;
+  if (!NodeRegistry::instance().find(typeName, entry)) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(graphMutex_);
+    if (nodes_.count(id)) {
+      return nullptr;
+    }
+  }
+
+  void *memory = nodePool_->allocate(entry.size, entry.alignment);
+  Node *node;
+  try {
+    node = entry.construct(memory, id);
+  } catch (...) {
+    nodePool_->deallocate(memory, entry.size, entry.alignment);
+    throw;
+  }
+  std::shared_ptr<NodePool> pool = nodePool_;
+  NodePtr owner(node, [pool, memory, entry](Node *n) {
+    n->~Node();
+    pool->deallocate(memory, entry.size, entry.alignment);
+  });
+  return createNode(id, owner);
+}
+
+bool GraphManager::removeNode(const std::string &id) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  purgeRetiredNodes();
+  auto it = nodes_.find(id);
+  if (it == nodes_.end()) {
+    return false;
+  }
+
+  // Keep the node in the plan until its fade-out has completed; it is
+  // released by the next graph edit or collectRetiredNodes().
+  Node *node = it->second.get();
+  if (node->retiring_) {
+    return true;
+  }
+  if (isPrepared_ && node->getFadeOutDuration() > 0.0f &&
+      !node->envelope_.isSilent()) {
+    node->retiring_ = true;
+    node->fadeAgainstDry_ = false;
+    node->startFadeOut();
+    return true;
+  }
+
+  eraseNode(id);
+  rebuildIfPrepared();
+  return true;
+}
+
+bool GraphManager::setBypassed(const std::string &id, bool bypassed) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  auto it = nodes_.find(id);
+  if (it == nodes_.end() || it->second->retiring_) {
+    return false;
+  }
+
+  Node *node = it->second.get();
+  if (node->bypassed_ == bypassed) {
+    return true;
+  }
+  node->bypassed_ = bypassed;
+  node->fadeAgainstDry_ = true;
+  if (bypassed) {
+    node->startFadeOut();
+  } else {
+    node->resetFadeIn();
+  }
+  return true;
+}
+
+int GraphManager::collectRetiredNodes() {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return purgeRetiredNodes();
+}
+
+int GraphManager::purgeRetiredNodes() {
+  std::vector<std::string> retired;
+  for (const auto &entry : nodes_) {
+    if (entry.second->retiring_ && entry.second->envelope_.isSilent()) {
+      retired.push_back(entry.first);
+    }
+  }
+  if (retired.empty()) {
+    return 0;
+  }
+  for (const auto &id : retired) {
+    eraseNode(id);
+  }
+  rebuildIfPrepared();
+  return static_cast<int>(retired.size());
+}
+
+void GraphManager::eraseNode(const std::string &id) {
+  auto it = nodes_.find(id);
+  connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                     [&id](const Connection &c) {
+                                       return c.fromNodeId == id ||
+                                              c.toNodeId == id;
+                                     }),
+                     connections_.end());
+  it->second->graph_ = nullptr;
+  nodes_.erase(it);
+
+  auto slot = nodeSlotIndex_.find(id);
+  if (slot != nodeSlotIndex_.end()) {
+    NodeSlot &freed = nodeSlot(slot->second);
+    freed.generation.fetch_add(1, std::memory_order_release);
+    freed.node.store(nullptr, std::memory_order_release);
+    freed.planStep = UINT32_MAX;
+    freeNodeSlots_.push_back(slot->second);
+    nodeSlotIndex_.erase(slot);
+  }
+  audioBuffers_.erase(id);
+  doubleBuffers_.erase(id);
+  {
+    std::lock_guard<std::mutex> profileLock(profileMutex_);
+    profiles_.erase(id);
+  }
+  controlLayouts_.erase(id);
+  eventBuffers_.erase(id);
+  needsBufferReallocation_ = true;
+}
+
+NodePtr GraphManager::getNode(const std::string &id) const {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  auto it = nodes_.find(id);
+  return it != nodes_.end() ? it->second : nullptr;
+}
+
+NodeHandle GraphManager::getNodeHandle(const std::string &id) const {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  auto it = nodeSlotIndex_.find(id);
+  if (it == nodeSlotIndex_.end()) {
+    return NodeHandle{};
+  }
+  return NodeHandle{it->second, nodeSlot(it->second).generation.load(
+                                    std::memory_order_relaxed)};
+}
+
+GraphManager::NodeSlot *GraphManager::findNodeSlot(uint32_t index) const {
+  if (index >= numNodeSlots_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return nodeSlotPages_[index / kNodeSlotsPerPage].load(
+             std::memory_order_acquire) +
+         index % kNodeSlotsPerPage;
+}
+
+Node *GraphManager::getNode(NodeHandle handle) const {
+  const NodeSlot *slot = findNodeSlot(handle.index);
+  if (!slot) {
+    return nullptr;
+  }
+  // A slot is freed by bumping its generation before clearing the node, so
+  // a node read between two matching generations belongs to the handle.
+  if (slot->generation.load(std::memory_order_acquire) != handle.generation) {
+    return nullptr;
+  }
+  Node *node = slot->node.load(std::memory_order_acquire);
+  if (slot->generation.load(std::memory_order_acquire) != handle.generation) {
+    return nullptr;
+  }
+  return node;
+}
+
+bool GraphManager::postParamChange(NodeHandle node, ParamHandle param,
+                                   const ControlValue &value,
+                                   uint64_t sampleTime) {
+  ParamChange change;
+  change.node = node;
+  change.param = param;
+  change.value = value;
+  change.sampleTime = sampleTime;
+
+  if (!paramChangeQueue_.push(change)) {
+    droppedParamChanges_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void GraphManager::applyParamChange(const ParamChange &change) {
+  const NodeSlot *slot = findNodeSlot(change.node.index);
+  if (!slot || slot->generation != change.node.generation) {
+    return;
+  }
+  if (Node *node = slot->node.load(std::memory_order_relaxed)) {
+    node->setParam(change.param, change.value);
+  }
+}
+
+void GraphManager::connect(const std::string &fromId,
+                           const std::string &fromPort,
+                           const std::string &toId, const std::string &toPort) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  purgeRetiredNodes();
+  auto from = nodes_.find(fromId);
+  auto to = nodes_.find(toId);
+  if (from == nodes_.end() || to == nodes_.end()) {
+    return;
+  }
+
+  const Port *fromPortInfo = findPort(from->second->getOutputPorts(), fromPort);
+  const Port *toPortInfo = findPort(to->second->getInputPorts(), toPort);
+  if (!fromPortInfo || !toPortInfo || fromPortInfo->type != toPortInfo->type ||
+      (fromPortInfo->type == PortType::Control &&
+       fromPortInfo->controlType != toPortInfo->controlType)) {
+    return;
+  }
+
+  for (const auto &c : connections_) {
+    if (c.fromNodeId == fromId && c.fromPortName == fromPort &&
+        c.toNodeId == toId && c.toPortName == toPort) {
+      return;
+    }
+  }
+
+  connections_.push_back({fromId, toId, fromPort, toPort});
+  needsBufferReallocation_ = true;
+  rebuildIfPrepared();
+}
+
+bool GraphManager::disconnect(const std::string &fromId,
+                              const std::string &fromPort,
+                              const std::string &toId,
+                              const std::string &toPort) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  purgeRetiredNodes();
+  auto it = std::find_if(connections_.begin(), connections_.end(),
+                         [&](const Connection &c) {
+                           return c.fromNodeId == fromId &&
+                                  c.fromPortName == fromPort &&
+                                  c.toNodeId == toId && c.toPortName == toPort;
+                         });
+  if (it == connections_.end()) {
+    return false;
+  }
+
+  connections_.erase(it);
+  needsBufferReallocation_ = true;
+  rebuildIfPrepared();
+  return true;
+}
+
+void GraphManager::disconnectAll(const std::string &nodeId) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  purgeRetiredNodes();
+  connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                     [&nodeId](const Connection &c) {
+                                       return c.fromNodeId == nodeId ||
+                                              c.toNodeId == nodeId;
+                                     }),
+                     connections_.end());
+  needsBufferReallocation_ = true;
+  rebuildIfPrepared();
+}
+
+void GraphManager::clear() {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  for (auto &entry : nodes_) {
+    entry.second->graph_ = nullptr;
+  }
+  nodes_.clear();
+  freeNodeSlots_.clear();
+  const uint32_t numSlots = numNodeSlots_.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < numSlots; ++i) {
+    NodeSlot &slot = nodeSlot(i);
+    slot.generation.fetch_add(1, std::memory_order_release);
+    slot.node.store(nullptr, std::memory_order_release);
+    slot.planStep = UINT32_MAX;
+    freeNodeSlots_.push_back(i);
+  }
+  nodeSlotIndex_.clear();
+  orderedNodes_.clear();
+  nodeLevels_.clear();
+  connections_.clear();
+  audioBuffers_.clear();
+  doubleBuffers_.clear();
+  {
+    std::lock_guard<std::mutex> profileLock(profileMutex_);
+    profiles_.clear();
+  }
+  controlSlots_.clear();
+  controlLayouts_.clear();
+  controlRoutes_.clear();
+  eventBuffers_.clear();
+  plan_.clear();
+  planGroups_.clear();
+  deviceChannelSources_.clear();
+  deviceMixBuffers_.clear();
+  deviceChannelPointers_.clear();
+  needsBufferReallocation_ = false;
+}
+
+void GraphManager::prepare(int sampleRate, int blockSize,
+                           int numDeviceChannels) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  sampleRate_ = sampleRate;
+  blockSize_ = blockSize;
+  numDeviceChannels_ = std::max(numDeviceChannels, 0);
+
+  // Nodes fade in when they enter a running graph. Preparing again keeps
+  // their envelopes, so retiring nodes still reach silence and bypassed
+  // nodes stay muted.
+  for (auto &entry : nodes_) {
+    entry.second->prepare(sampleRate_, blockSize_);
+    if (!isPrepared_) {
+      entry.second->resetFadeIn();
+    }
+  }
+  for (auto &channel : physicalInputBuffers_) {
+    channel.assign(blockSize_, 0.0f);
+  }
+  silence_.assign(blockSize_, 0.0f);
+  doubleSilence_.assign(blockSize_, 0.0);
+  sampleTime_ = 0;
+
+  isPrepared_ = true;
+  needsBufferReallocation_ = true;
+  rebuildIfPrepared();
+}
+
+void GraphManager::rebuildIfPrepared() {
+  if (!isPrepared_) {
+    return;
+  }
+  sortNodes();
+  allocateBuffers();
+  compilePlan();
+  needsBufferReallocation_ = false;
+}
+
+void GraphManager::sortNodes() {
+  // Kahn's algorithm over the connection list.
+  std::unordered_map<std::string, int> inDegree;
+  std::unordered_map<std::string, std::vector<std::string>> successors;
+  for (const auto &entry : nodes_) {
+    inDegree[entry.first] = 0;
+  }
+  for (const auto &c : connections_) {
+    if (c.fromNodeId == c.toNodeId) {
+      continue;
+    }
+    successors[c.fromNodeId].push_back(c.toNodeId);
+    ++inDegree[c.toNodeId];
+  }
+
+  std::deque<std::string> ready;
+  for (const auto &entry : inDegree) {
+    if (entry.second == 0) {
+      ready.push_back(entry.first);
+    }
+  }
+
+  std::unordered_map<std::string, uint32_t> level;
+  orderedNodes_.clear();
+  orderedNodes_.reserve(nodes_.size());
+  nodeLevels_.clear();
+  while (!ready.empty()) {
+    const std::string id = ready.front();
+    ready.pop_front();
+    const uint32_t depth = level[id];
+    orderedNodes_.push_back(nodes_[id]);
+    nodeLevels_.push_back(depth);
+    for (const auto &next : successors[id]) {
+      level[next] = std::max(level[next], depth + 1);
+      if (--inDegree[next] == 0) {
+        ready.push_back(next);
+      }
+    }
+  }
+
+  // Every connection goes to a deeper level, so ordering by level keeps the
+  // order valid. Within a level, nodes of the same kind are placed next to
+  // each other so that the plan can batch them or call them directly.
+  std::vector<size_t> order(orderedNodes_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  auto kind = [this](size_t i) {
+    const Node *node = orderedNodes_[i].get();
+    return std::make_pair(reinterpret_cast<uintptr_t>(node->batchProcess_),
+                          reinterpret_cast<uintptr_t>(node->staticType_));
+  };
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (nodeLevels_[a] != nodeLevels_[b]) {
+      return nodeLevels_[a] < nodeLevels_[b];
+    }
+    return kind(a) < kind(b);
+  });
+  std::vector<NodePtr> sorted;
+  std::vector<uint32_t> sortedLevels;
+  sorted.reserve(nodes_.size());
+  sortedLevels.reserve(nodes_.size());
+  for (size_t i : order) {
+    sorted.push_back(orderedNodes_[i]);
+    sortedLevels.push_back(nodeLevels_[i]);
+  }
+  orderedNodes_.swap(sorted);
+  nodeLevels_.swap(sortedLevels);
+
+  // Nodes on a cycle are appended last; they read their cyclic inputs with
+  // one block of delay.
+  if (orderedNodes_.size() < nodes_.size()) {
+    for (const auto &entry : inDegree) {
+      if (entry.second > 0) {
+        orderedNodes_.push_back(nodes_[entry.first]);
+        nodeLevels_.push_back(kNoLevel);
+      }
+    }
+  }
+}
+
+void GraphManager::allocateBuffers() {
+  for (const auto &entry : nodes_) {
+    allocateBuffersForNode(entry.first);
+  }
+}
+
+void GraphManager::allocateBuffersForNode(const std::string &nodeId) {
+  const NodePtr &node = nodes_[nodeId];
+  const auto &outputs = node->getOutputPorts();
+
+  auto &audio = audioBuffers_[nodeId];
+  audio.resize(countPorts(outputs, PortType::Audio));
+  for (auto &channel : audio) {
+    channel.assign(blockSize_, 0.0f);
+  }
+
+  // Storage is bound when the plan is compiled.
+  eventBuffers_[nodeId].resize(countPorts(outputs, PortType::Event));
+}
+
+void GraphManager::layoutControlSlots() {
+  std::vector<ControlSlot> previousSlots = std::move(controlSlots_);
+  std::unordered_map<std::string, ControlLayout> previousLayouts =
+      std::move(controlLayouts_);
+  controlSlots_.clear();
+  controlLayouts_.clear();
+
+  for (const auto &nodePtr : orderedNodes_) {
+    const std::string &id = nodePtr->getId();
+    ControlLayout layout;
+    layout.base = static_cast<uint32_t>(controlSlots_.size());
+
+    for (const auto &port : nodePtr->getInputPorts()) {
+      if (port.type == PortType::Control) {
+        controlSlots_.push_back(port.defaultValue);
+        ++layout.numInputs;
+      }
+    }
+    layout.numOutputs = static_cast<uint32_t>(
+        countPorts(nodePtr->getOutputPorts(), PortType::Control));
+
+    auto previous = previousLayouts.find(id);
+    if (previous != previousLayouts.end() &&
+        previous->second.numOutputs == layout.numOutputs) {
+      const ControlSlot *values = previousSlots.data() + previous->second.base +
+                                  previous->second.numInputs;
+      controlSlots_.insert(controlSlots_.end(), values,
+                           values + layout.numOutputs);
+    } else {
+      controlSlots_.resize(controlSlots_.size() + layout.numOutputs,
+                           ControlSlot::fromInt(0));
+    }
+    controlLayouts_[id] = layout;
+  }
+
+  // Every node re-evaluates once after compilation, so stamps can restart.
+  controlStamps_.assign(controlSlots_.size(), 0);
+  controlChangeCounter_ = 0;
+  uint32_t maxOutputs = 0;
+  for (const auto &entry : controlLayouts_) {
+    maxOutputs = std::max(maxOutputs, entry.second.numOutputs);
+  }
+  controlScratch_.resize(maxOutputs);
+}
+
+void GraphManager::compilePlan() {
+  plan_.clear();
+  plan_.reserve(orderedNodes_.size());
+  deviceChannelSources_.clear();
+  controlRoutes_.clear();
+  layoutControlSlots();
+
+  // Size the event arena: one region per event output port plus one per
+  // event input port that merges several connections.
+  size_t eventQueues = 0;
+  for (const auto &entry : eventBuffers_) {
+    eventQueues += entry.second.size();
+  }
+  std::unordered_map<std::string, int> eventFanIn;
+  for (const auto &c : connections_) {
+    const PortType *type =
+        findPortType(nodes_[c.toNodeId]->getInputPorts(), c.toPortName);
+    if (type && *type == PortType::Event &&
+        ++eventFanIn[c.toNodeId + '\n' + c.toPortName] == 2) {
+      ++eventQueues;
+    }
+  }
+  const size_t capacity = static_cast<size_t>(std::max(1, eventQueueCapacity_));
+  eventArena_.assign(eventQueues * capacity, Event());
+  Event *arena = eventArena_.data();
+  for (auto &entry : eventBuffers_) {
+    for (auto &queue : entry.second) {
+      queue.bind(arena, capacity);
+      arena += capacity;
+    }
+  }
+
+  // DoubleNodes and the float nodes feeding them get double buffers; the
+  // float side is converted once, right after its node runs.
+  std::unordered_map<std::string, bool> needsDouble;
+  for (const auto &entry : nodes_) {
+    if (entry.second->sampleType_ == SampleType::Float64) {
+      needsDouble[entry.first] = true;
+    }
+  }
+  for (const auto &c : connections_) {
+    const PortType *type =
+        findPortType(nodes_[c.toNodeId]->getInputPorts(), c.toPortName);
+    if (type && *type == PortType::Audio &&
+        nodes_[c.toNodeId]->sampleType_ == SampleType::Float64) {
+      needsDouble[c.fromNodeId] = true;
+    }
+  }
+  for (auto it = doubleBuffers_.begin(); it != doubleBuffers_.end();) {
+    it = needsDouble.count(it->first) ? std::next(it) : doubleBuffers_.erase(it);
+  }
+  for (const auto &entry : needsDouble) {
+    auto &channels = doubleBuffers_[entry.first];
+    channels.resize(audioBuffers_[entry.first].size());
+    for (auto &channel : channels) {
+      channel.resize(blockSize_);
+    }
+  }
+
+  for (const auto &nodePtr : orderedNodes_) {
+    Node *node = nodePtr.get();
+    const std::string &id = node->getId();
+    const auto &inputPorts = node->getInputPorts();
+
+    PlanStep step;
+    step.node = node;
+    step.level = nodeLevels_[plan_.size()];
+    step.tail = node->getTailLength();
+    step.profile = profilingEnabled_ || signalCheckEnabled_ ? profileFor(id)
+                                                            : nullptr;
+
+    const ControlLayout &controls = controlLayouts_[id];
+    step.controlBase = controls.base;
+    step.numControlInputs = static_cast<int>(controls.numInputs);
+    step.numControlOutputs = static_cast<int>(controls.numOutputs);
+    step.controlRouteBegin = static_cast<uint32_t>(controlRoutes_.size());
+
+    const int numAudioInputs = countPorts(inputPorts, PortType::Audio);
+    const int numEventInputs = countPorts(inputPorts, PortType::Event);
+    step.eventSources.resize(numEventInputs);
+    step.eventMerges.resize(numEventInputs);
+    step.eventInputs.resize(numEventInputs);
+    step.inputs.assign(numAudioInputs, silence_.data());
+    step.fanInSources.resize(numAudioInputs);
+    step.fanInBuffers.resize(numAudioInputs);
+
+    for (auto &channel : audioBuffers_[id]) {
+      step.outputs.push_back(channel.data());
+    }
+    if (node->sampleType_ == SampleType::Float64) {
+      step.isDouble = true;
+      step.doubleIO.reset(new PlanStep::DoubleIO);
+      PlanStep::DoubleIO &io = *step.doubleIO;
+      io.inputs.assign(numAudioInputs, doubleSilence_.data());
+      io.fanInSources.resize(numAudioInputs);
+      io.fanInBuffers.resize(numAudioInputs);
+      for (auto &channel : doubleBuffers_[id]) {
+        io.outputs.push_back(channel.data());
+      }
+    } else if (doubleBuffers_.count(id)) {
+      for (auto &channel : doubleBuffers_[id]) {
+        step.doubleOutputs.push_back(channel.data());
+      }
+    }
+
+    for (const auto &c : connections_) {
+      if (c.toNodeId != id) {
+        continue;
+      }
+      const NodePtr &source = nodes_[c.fromNodeId];
+      const PortType *type =
+          findPortType(source->getOutputPorts(), c.fromPortName);
+      if (!type) {
+        continue;
+      }
+
+      if (*type == PortType::Audio) {
+        const int from = portIndex(source->getOutputPorts(), c.fromPortName,
+                                   PortType::Audio);
+        const int to = portIndex(inputPorts, c.toPortName, PortType::Audio);
+        if (from >= 0 && to >= 0) {
+          step.fanInSources[to].push_back(
+              audioBuffers_[c.fromNodeId][from].data());
+          if (step.isDouble) {
+            step.doubleIO->fanInSources[to].push_back(
+                doubleBuffers_[c.fromNodeId][from].data());
+          }
+        }
+      } else if (*type == PortType::Control) {
+        const int from = portIndex(source->getOutputPorts(), c.fromPortName,
+                                   PortType::Control);
+        const int to = portIndex(inputPorts, c.toPortName, PortType::Control);
+        if (from >= 0 && to >= 0) {
+          const ControlLayout &src = controlLayouts_[c.fromNodeId];
+          controlRoutes_.push_back(
+              {step.controlBase + static_cast<uint32_t>(to),
+               src.base + src.numInputs + static_cast<uint32_t>(from)});
+        }
+      } else {
+        const int from = portIndex(source->getOutputPorts(), c.fromPortName,
+                                   PortType::Event);
+        const int to = portIndex(inputPorts, c.toPortName, PortType::Event);
+        if (from >= 0 && to >= 0) {
+          step.eventSources[to].push_back(&eventBuffers_[c.fromNodeId][from]);
+        }
+      }
+    }
+
+    for (int p = 0; p < numAudioInputs; ++p) {
+      auto &sources = step.fanInSources[p];
+      if (step.isDouble) {
+        // DoubleNodes only read their double inputs.
+        sources.clear();
+      } else if (sources.size() == 1) {
+        step.inputs[p] = sources[0];
+        sources.clear();
+      } else if (sources.size() > 1) {
+        step.fanInBuffers[p].assign(blockSize_, 0.0f);
+        step.inputs[p] = step.fanInBuffers[p].data();
+      }
+    }
+
+    step.dryInputs.assign(step.outputs.size(), nullptr);
+    for (size_t p = 0; p < step.outputs.size() && p < step.inputs.size(); ++p) {
+      step.dryInputs[p] = step.inputs[p];
+    }
+    step.segmentInputs.resize(step.inputs.size());
+    step.segmentOutputs.resize(step.outputs.size());
+    step.segmentDry.resize(step.dryInputs.size());
+    if (step.isDouble) {
+      PlanStep::DoubleIO &io = *step.doubleIO;
+      for (int p = 0; p < numAudioInputs; ++p) {
+        auto &sources = io.fanInSources[p];
+        if (sources.size() == 1) {
+          io.inputs[p] = sources[0];
+          sources.clear();
+        } else if (sources.size() > 1) {
+          io.fanInBuffers[p].assign(blockSize_, 0.0);
+          io.inputs[p] = io.fanInBuffers[p].data();
+        }
+      }
+      io.dryInputs.assign(io.outputs.size(), nullptr);
+      for (size_t p = 0; p < io.outputs.size() && p < io.inputs.size(); ++p) {
+        io.dryInputs[p] = io.inputs[p];
+      }
+      io.segmentInputs.resize(io.inputs.size());
+      io.segmentOutputs.resize(io.outputs.size());
+      io.segmentDry.resize(io.dryInputs.size());
+    }
+    for (int p = 0; p < numEventInputs; ++p) {
+      if (step.eventSources[p].size() > 1) {
+        step.eventMerges[p].bind(arena, capacity);
+        arena += capacity;
+        step.eventMergeHeads.resize(
+            std::max(step.eventMergeHeads.size(), step.eventSources[p].size()));
+      }
+    }
+    for (auto &queue : eventBuffers_[id]) {
+      step.eventOutputs.push_back(&queue);
+    }
+
+    step.controlRouteEnd = static_cast<uint32_t>(controlRoutes_.size());
+
+    step.hasFanIn = std::any_of(
+        step.fanInSources.begin(), step.fanInSources.end(),
+        [](const std::vector<const float *> &s) { return !s.empty(); });
+    if (step.isDouble) {
+      step.hasFanIn = std::any_of(
+          step.doubleIO->fanInSources.begin(),
+          step.doubleIO->fanInSources.end(),
+          [](const std::vector<const double *> &s) { return !s.empty(); });
+    }
+    step.hasControl = step.numControlInputs || step.numControlOutputs;
+    step.hasEvents = !step.eventInputs.empty() || !step.eventOutputs.empty();
+
+    if (auto *sink = dynamic_cast<PhysicalOutputNode *>(node)) {
+      const auto &channels = sink->getDeviceChannels();
+      for (int p = 0; p < numAudioInputs; ++p) {
+        const int channel = channels[p];
+        if (channel < 0 || step.inputs[p] == silence_.data()) {
+          continue;
+        }
+        if (channel >= static_cast<int>(deviceChannelSources_.size())) {
+          deviceChannelSources_.resize(channel + 1);
+        }
+        deviceChannelSources_[channel].push_back(step.inputs[p]);
+      }
+    }
+
+    plan_.push_back(std::move(step));
+  }
+
+  // Steps that may sleep watch the outputs of their audio sources.
+  sleepingSteps_ = 0;
+  std::unordered_map<std::string, uint32_t> stepIndex;
+  const uint32_t numSlots = numNodeSlots_.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < numSlots; ++i) {
+    nodeSlot(i).planStep = UINT32_MAX;
+  }
+  for (uint32_t i = 0; i < plan_.size(); ++i) {
+    stepIndex[plan_[i].node->getId()] = i;
+    nodeSlot(nodeSlotIndex_[plan_[i].node->getId()]).planStep = i;
+  }
+  for (const auto &c : connections_) {
+    PlanStep &step = plan_[stepIndex[c.toNodeId]];
+    const PortType *type =
+        findPortType(step.node->getInputPorts(), c.toPortName);
+    if (step.tail < 0 || !type || *type != PortType::Audio) {
+      continue;
+    }
+    const uint32_t source = stepIndex[c.fromNodeId];
+    plan_[source].trackSilence = true;
+    step.audioSources.push_back(source);
+  }
+  for (PlanStep &step : plan_) {
+    step.trackSilence = step.trackSilence || step.tail >= 0;
+  }
+
+  // Same-kind nodes at the same level are batched; other runs of steps
+  // share a dispatch.
+  planGroups_.clear();
+  size_t maxBatch = 0;
+  for (size_t i = 0; i < plan_.size();) {
+    const PlanStep &first = plan_[i];
+    const Node::BatchProcess batch = first.node->batchProcess_;
+    size_t end = i + 1;
+    if (batch && first.level != kNoLevel && !first.isDouble) {
+      while (end < plan_.size() && plan_[end].node->batchProcess_ == batch &&
+             plan_[end].level == first.level) {
+        ++end;
+      }
+    }
+    const uint32_t begin = static_cast<uint32_t>(i);
+    if (end - i > 1) {
+      planGroups_.push_back(
+          {begin, static_cast<uint32_t>(end), &GraphManager::runBatch});
+      maxBatch = std::max(maxBatch, end - i);
+    } else {
+      const RunSteps run = dispatchFor(first.node);
+      if (!planGroups_.empty() && planGroups_.back().run == run) {
+        ++planGroups_.back().end;
+      } else {
+        planGroups_.push_back({begin, begin + 1, run});
+      }
+    }
+    i = end;
+  }
+  batchSteps_.resize(maxBatch);
+  batchNodes_.resize(maxBatch);
+  batchInputs_.resize(maxBatch);
+  batchOutputs_.resize(maxBatch);
+  batchIO_.resize(maxBatch);
+
+  deviceMixBuffers_.assign(deviceChannelSources_.size(), {});
+  for (size_t c = 0; c < deviceChannelSources_.size(); ++c) {
+    if (deviceChannelSources_[c].size() > 1) {
+      deviceMixBuffers_[c].assign(blockSize_, 0.0f);
+    }
+  }
+  deviceChannelPointers_.assign(
+      std::max<size_t>(numDeviceChannels_, deviceChannelSources_.size()),
+      nullptr);
+}
+
+NodeProfile *GraphManager::profileFor(const std::string &nodeId) {
+  std::lock_guard<std::mutex> lock(profileMutex_);
+  std::unique_ptr<NodeProfile> &profile = profiles_[nodeId];
+  if (!profile) {
+    profile.reset(new NodeProfile);
+    profile->nodeId = nodeId;
+  }
+  return profile.get();
+}
+
+void GraphManager::assignProfiles() {
+  const bool needed = profilingEnabled_ || signalCheckEnabled_;
+  for (auto &step : plan_) {
+    step.profile = needed ? profileFor(step.node->getId()) : nullptr;
+  }
+}
+
+void GraphManager::setProfilingEnabled(bool enabled) {
+#if MS_PROFILING
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  profilingEnabled_ = enabled;
+  assignProfiles();
+#else
+  (void)enabled;
+#endif
+}
+
+void GraphManager::setSignalCheckEnabled(bool enabled) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  signalCheckEnabled_ = enabled;
+  assignProfiles();
+}
+
+std::vector<NodeProfileStats> GraphManager::getProfileSnapshot() const {
+  double nsPerTick = 1.0;
+#if MS_PROFILING_RDTSC
+  const uint64_t ticks = ProfileClock::now() - profileStartTicks_;
+  const double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - profileStartTime_)
+                        .count();
+  nsPerTick = ticks > 0 ? ns / static_cast<double>(ticks) : 0.0;
+#endif
+
+  std::vector<NodeProfileStats> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(profileMutex_);
+    snapshot.reserve(profiles_.size());
+    for (const auto &entry : profiles_) {
+      snapshot.push_back(makeProfileStats(*entry.second, nsPerTick));
+    }
+  }
+  std::sort(snapshot.begin(), snapshot.end(),
+            [](const NodeProfileStats &a, const NodeProfileStats &b) {
+              return a.processMeanNs * a.processCalls >
+                     b.processMeanNs * b.processCalls;
+            });
+  return snapshot;
+}
+
+void GraphManager::resetProfile() {
+  std::lock_guard<std::mutex> lock(profileMutex_);
+  for (auto &entry : profiles_) {
+    entry.second->reset();
+  }
+}
+
+void GraphManager::runBlock(int nFrames) {
+  const ScopedFlushDenormals flushDenormals(
+      flushDenormals_.load(std::memory_order_relaxed));
+
+  ParamChange change;
+  while (paramChangeQueue_.pop(change)) {
+    if (pendingParamChanges_.size() == pendingParamChanges_.capacity()) {
+      droppedParamChanges_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    change.sequence = paramChangeSequence_++;
+    pendingParamChanges_.push_back(change);
+  }
+
+  const uint64_t blockStart = sampleTime_.load(std::memory_order_relaxed);
+  const uint64_t blockEnd = blockStart + static_cast<uint64_t>(nFrames);
+
+  // Move the changes due in this block to the front: first those due at
+  // its start, then those inside it. std::partition and std::sort work in
+  // place.
+  auto dueEnd = std::partition(
+      pendingParamChanges_.begin(), pendingParamChanges_.end(),
+      [blockEnd](const ParamChange &c) { return c.sampleTime < blockEnd; });
+  auto timedBegin = std::partition(
+      pendingParamChanges_.begin(), dueEnd,
+      [blockStart](const ParamChange &c) { return c.sampleTime <= blockStart; });
+  auto byTime = [](const ParamChange &a, const ParamChange &b) {
+    return a.sampleTime != b.sampleTime ? a.sampleTime < b.sampleTime
+                                        : a.sequence < b.sequence;
+  };
+  std::sort(pendingParamChanges_.begin(), timedBegin, byTime);
+  for (auto it = pendingParamChanges_.begin(); it != timedBegin; ++it) {
+    applyParamChange(*it);
+  }
+
+  // Changes inside the block only split the step of their node: group them
+  // by step, in time order. Stale handles have no step and are dropped.
+  auto stepOf = [this](const ParamChange &c) {
+    const NodeSlot *slot = findNodeSlot(c.node.index);
+    return slot && slot->node && slot->generation == c.node.generation
+               ? slot->planStep
+               : UINT32_MAX;
+  };
+  std::sort(timedBegin, dueEnd,
+            [&stepOf, &byTime](const ParamChange &a, const ParamChange &b) {
+              const uint32_t stepA = stepOf(a);
+              const uint32_t stepB = stepOf(b);
+              return stepA != stepB ? stepA < stepB : byTime(a, b);
+            });
+  for (auto it = timedBegin; it != dueEnd;) {
+    const uint32_t step = stepOf(*it);
+    auto last = it + 1;
+    while (last != dueEnd && stepOf(*last) == step) {
+      ++last;
+    }
+    if (step != UINT32_MAX) {
+      plan_[step].changeBegin =
+          static_cast<uint32_t>(it - pendingParamChanges_.begin());
+      plan_[step].changeEnd =
+          static_cast<uint32_t>(last - pendingParamChanges_.begin());
+    }
+    it = last;
+  }
+
+  blockControlEvaluated_ = 0;
+  blockControlSkipped_ = 0;
+  blockNonFinite_ = false;
+  const float sleepThreshold = sleepThreshold_.load(std::memory_order_relaxed);
+  if (sleepThreshold == 0.0f && blockSleepThreshold_ != 0.0f) {
+    // Sleeping was just disabled: wake every step and restart its count,
+    // so nothing sleeps on silence measured before it was re-enabled.
+    for (PlanStep &step : plan_) {
+      if (step.asleep) {
+        step.asleep = false;
+        ++wakeups_;
+      }
+      step.quietFrames = 0;
+    }
+    sleepingSteps_ = 0;
+  }
+  blockSleepThreshold_ = sleepThreshold;
+
+#if MS_PROFILING
+  profileBlock_ = false;
+  if (profilingEnabled_ && --profileCountdown_ <= 0) {
+    profileBlock_ = true;
+    profileCountdown_ = profileInterval_.load(std::memory_order_relaxed);
+  }
+#endif
+
+  runPlan(nFrames);
+
+  for (auto it = timedBegin; it != dueEnd; ++it) {
+    const uint32_t step = stepOf(*it);
+    if (step != UINT32_MAX) {
+      plan_[step].changeBegin = plan_[step].changeEnd = 0;
+    }
+  }
+  pendingParamChanges_.erase(pendingParamChanges_.begin(), dueEnd);
+  sampleTime_.store(blockEnd, std::memory_order_relaxed);
+  controlEvaluated_.store(blockControlEvaluated_, std::memory_order_relaxed);
+  controlSkipped_.store(blockControlSkipped_, std::memory_order_relaxed);
+  sleepingNodes_.store(sleepingSteps_, std::memory_order_relaxed);
+  sleepWakeups_.store(wakeups_, std::memory_order_relaxed);
+}
+
+bool GraphManager::beginStep(PlanStep &step, int offset, int nFrames,
+                             bool firstSegment, StepIO &io) {
+  Node *node = step.node;
+  GainEnvelope &envelope = node->envelope_;
+
+  if (step.tail >= 0 && blockSleepThreshold_ > 0.0f &&
+      sleepThrough(step, firstSegment)) {
+    return false;
+  }
+
+  if (step.hasFanIn) {
+    for (size_t p = 0; p < step.fanInSources.size(); ++p) {
+      if (!step.fanInSources[p].empty()) {
+        sumBuffers(step.fanInSources[p], offset,
+                   step.fanInBuffers[p].data() + offset, nFrames);
+      }
+    }
+  }
+
+  io.inputs = step.inputs.data();
+  io.outputs = step.outputs.data();
+  io.dry = step.dryInputs.data();
+  if (offset != 0) {
+    for (size_t p = 0; p < step.inputs.size(); ++p) {
+      step.segmentInputs[p] = step.inputs[p] + offset;
+    }
+    for (size_t p = 0; p < step.outputs.size(); ++p) {
+      step.segmentOutputs[p] = step.outputs[p] + offset;
+      step.segmentDry[p] = step.dryInputs[p] ? step.dryInputs[p] + offset
+                                             : nullptr;
+    }
+    io.inputs = step.segmentInputs.data();
+    io.outputs = step.segmentOutputs.data();
+    io.dry = step.segmentDry.data();
+  }
+  io.numOutputs = static_cast<int>(step.outputs.size());
+
+  // Faded-out nodes are not processed: bypassed nodes pass their inputs
+  // through, retiring nodes stay silent until they are released.
+  if (envelope.isSilent()) {
+    if (node->fadeAgainstDry_) {
+      envelope.apply(io.outputs, io.dry, io.numOutputs, nFrames);
+    }
+    for (auto *queue : step.eventOutputs) {
+      queue->clear();
+    }
+    if (!step.doubleOutputs.empty()) {
+      convertOutputs(step, offset, nFrames);
+    }
+    step.outputQuiet = !node->fadeAgainstDry_;
+    return false;
+  }
+
+  runControlAndEvents(step, firstSegment);
+  return true;
+}
+
+bool GraphManager::sleepThrough(PlanStep &step, bool firstSegment) {
+  const Node *node = step.node;
+  bool quiet = !node->envelope_.isActive() && !node->fadeAgainstDry_;
+  for (size_t i = 0; quiet && i < step.audioSources.size(); ++i) {
+    quiet = plan_[step.audioSources[i]].outputQuiet;
+  }
+  if (quiet && firstSegment) {
+    for (const auto &sources : step.eventSources) {
+      for (const EventQueue *queue : sources) {
+        quiet = quiet && queue->events().empty();
+      }
+    }
+  }
+  step.inputsQuiet = quiet;
+
+  if (!quiet) {
+    step.quietFrames = 0;
+    if (step.asleep) {
+      step.asleep = false;
+      --sleepingSteps_;
+      ++wakeups_;
+    }
+    return false;
+  }
+  if (!step.asleep) {
+    return false;
+  }
+
+  // Asleep: the outputs already hold silence. Control still runs so that
+  // control outputs follow parameter changes.
+  if (firstSegment && step.hasControl) {
+    runControl(step);
+  }
+  if (firstSegment) {
+    for (auto *queue : step.eventOutputs) {
+      queue->clear();
+    }
+  }
+  return true;
+}
+
+void GraphManager::trackSilence(PlanStep &step, int offset, int nFrames) {
+  float peak = 0.0f;
+  for (const float *output : step.outputs) {
+    peak = std::max(peak, peakOf(output + offset, nFrames));
+  }
+  step.outputQuiet = peak < blockSleepThreshold_;
+  // The node may have changed its tail since the plan was compiled.
+  const int tail = step.node->getTailLength();
+  if (step.tail < 0 || tail < 0 || !step.inputsQuiet) {
+    return;
+  }
+  step.quietFrames += nFrames;
+
+  // Sleep only starts at a block boundary, so the outputs can be cleared
+  // whole before anything reads them.
+  if (offset != 0 || !step.outputQuiet || step.quietFrames <= tail) {
+    return;
+  }
+  for (float *output : step.outputs) {
+    std::fill(output, output + blockSize_, 0.0f);
+  }
+  for (double *output : step.doubleOutputs) {
+    std::fill(output, output + blockSize_, 0.0);
+  }
+  if (step.isDouble) {
+    for (double *output : step.doubleIO->outputs) {
+      std::fill(output, output + blockSize_, 0.0);
+    }
+  }
+  step.asleep = true;
+  ++sleepingSteps_;
+}
+
+void GraphManager::runControlAndEvents(PlanStep &step, bool firstSegment) {
+  if (firstSegment && step.hasControl) {
+    runControl(step);
+  }
+
+  if (firstSegment && step.hasEvents) {
+    for (size_t p = 0; p < step.eventInputs.size(); ++p) {
+      const auto &sources = step.eventSources[p];
+      if (sources.size() == 1) {
+        step.eventInputs[p] = sources[0]->events();
+      } else if (sources.size() > 1) {
+        mergeEvents(sources, step.eventMergeHeads.data(),
+                    step.eventMerges[p]);
+        step.eventInputs[p] = step.eventMerges[p].events();
+      } else {
+        step.eventInputs[p] = EventSpan();
+      }
+    }
+    for (auto *queue : step.eventOutputs) {
+      queue->clear();
+    }
+    NodeProfile *profile = activeProfile(step);
+    const uint64_t start = profileBegin(profile);
+    step.node->processEvent(step.eventInputs.data(),
+                            step.eventOutputs.data());
+    profileEnd(profile, &NodeProfile::event, start);
+  }
+}
+
+void GraphManager::endStep(PlanStep &step, const StepIO &io, int offset,
+                           int nFrames) {
+  Node *node = step.node;
+  GainEnvelope &envelope = node->envelope_;
+  if (envelope.isActive()) {
+    envelope.apply(io.outputs, node->fadeAgainstDry_ ? io.dry : nullptr,
+                   io.numOutputs, nFrames);
+  } else if (node->fadeAgainstDry_ && !node->bypassed_) {
+    node->fadeAgainstDry_ = false;
+  }
+  if (!step.doubleOutputs.empty()) {
+    convertOutputs(step, offset, nFrames);
+  }
+  if (signalCheckEnabled_) {
+    checkOutputs(step, offset, nFrames);
+  }
+  if (step.trackSilence && blockSleepThreshold_ > 0.0f) {
+    trackSilence(step, offset, nFrames);
+  }
+}
+
+void GraphManager::checkOutputs(PlanStep &step, int offset, int nFrames) {
+  SampleFaults faults;
+  if (step.isDouble) {
+    for (double *output : step.doubleIO->outputs) {
+      faults += scanSamples(output + offset, nFrames);
+    }
+  } else {
+    for (float *output : step.outputs) {
+      faults += scanSamples(output + offset, nFrames);
+    }
+  }
+  if (!faults.any() || !step.profile) {
+    return;
+  }
+  // Steps run in dependency order, so the first node with a non-finite
+  // output in a block is where the fault originates.
+  step.profile->recordFaults(faults.subnormal, faults.nonFinite,
+                             !blockNonFinite_);
+  if (faults.nonFinite != 0) {
+    blockNonFinite_ = true;
+  }
+}
+
+void GraphManager::convertOutputs(PlanStep &step, int offset, int nFrames) {
+  if (step.isDouble) {
+    const auto &outputs = step.doubleIO->outputs;
+    for (size_t p = 0; p < outputs.size(); ++p) {
+      convertSamples(outputs[p] + offset, step.outputs[p] + offset, nFrames);
+    }
+    return;
+  }
+  for (size_t p = 0; p < step.doubleOutputs.size(); ++p) {
+    convertSamples(step.outputs[p] + offset, step.doubleOutputs[p] + offset,
+                   nFrames);
+  }
+}
+
+template <typename Run>
+void GraphManager::runSplit(PlanStep &step, int nFrames, Run run) {
+  const uint64_t blockStart = sampleTime_.load(std::memory_order_relaxed);
+  const ParamChange *next = pendingParamChanges_.data() + step.changeBegin;
+  const ParamChange *last = pendingParamChanges_.data() + step.changeEnd;
+  const int inputBase = physicalInputOffset_;
+  // Readers of the step see the whole block, so it is quiet only if every
+  // segment was.
+  bool quiet = true;
+  int offset = 0;
+  while (offset < nFrames) {
+    const uint64_t now = blockStart + static_cast<uint64_t>(offset);
+    while (next != last && next->sampleTime <= now) {
+      applyParamChange(*next++);
+    }
+    const int segmentEnd =
+        next != last ? static_cast<int>(next->sampleTime - blockStart)
+                     : nFrames;
+    physicalInputOffset_ = inputBase + offset;
+    run(offset, segmentEnd - offset, offset == 0);
+    quiet = quiet && step.outputQuiet;
+    offset = segmentEnd;
+  }
+  physicalInputOffset_ = inputBase;
+  step.outputQuiet = quiet;
+}
+
+void GraphManager::runDoubleSteps(PlanStep *begin, PlanStep *end,
+                                  int nFrames) {
+  for (PlanStep *step = begin; step != end; ++step) {
+    if (step->changeBegin != step->changeEnd) {
+      runSplit(*step, nFrames, [this, step](int o, int n, bool first) {
+        runDoubleStep(*step, o, n, first);
+      });
+    } else {
+      runDoubleStep(*step, 0, nFrames, true);
+    }
+  }
+}
+
+void GraphManager::runDoubleStep(PlanStep &step, int offset, int nFrames,
+                                 bool firstSegment) {
+  PlanStep::DoubleIO &io = *step.doubleIO;
+  Node *node = step.node;
+  GainEnvelope &envelope = node->envelope_;
+
+  if (step.tail >= 0 && blockSleepThreshold_ > 0.0f &&
+      sleepThrough(step, firstSegment)) {
+    return;
+  }
+
+  if (step.hasFanIn) {
+    for (size_t p = 0; p < io.fanInSources.size(); ++p) {
+      if (!io.fanInSources[p].empty()) {
+        sumBuffers(io.fanInSources[p], offset,
+                   io.fanInBuffers[p].data() + offset, nFrames);
+      }
+    }
+  }
+
+  const double *const *inputs = io.inputs.data();
+  double **outputs = io.outputs.data();
+  const double *const *dry = io.dryInputs.data();
+  if (offset != 0) {
+    for (size_t p = 0; p < io.inputs.size(); ++p) {
+      io.segmentInputs[p] = io.inputs[p] + offset;
+    }
+    for (size_t p = 0; p < io.outputs.size(); ++p) {
+      io.segmentOutputs[p] = io.outputs[p] + offset;
+      io.segmentDry[p] = io.dryInputs[p] ? io.dryInputs[p] + offset
+                                         : nullptr;
+    }
+    inputs = io.segmentInputs.data();
+    outputs = io.segmentOutputs.data();
+    dry = io.segmentDry.data();
+  }
+  const int numOutputs = static_cast<int>(io.outputs.size());
+
+  if (envelope.isSilent()) {
+    if (node->fadeAgainstDry_) {
+      envelope.apply(outputs, dry, numOutputs, nFrames);
+    }
+    for (auto *queue : step.eventOutputs) {
+      queue->clear();
+    }
+    step.outputQuiet = !node->fadeAgainstDry_;
+  } else {
+    runControlAndEvents(step, firstSegment);
+    NodeProfile *profile = activeProfile(step);
+    const uint64_t start = profileBegin(profile);
+    static_cast<DoubleNode *>(node)->processDouble(inputs, outputs, nFrames);
+    profileProcess(profile, start);
+    if (envelope.isActive()) {
+      envelope.apply(outputs, node->fadeAgainstDry_ ? dry : nullptr,
+                     numOutputs, nFrames);
+    } else if (node->fadeAgainstDry_ && !node->bypassed_) {
+      node->fadeAgainstDry_ = false;
+    }
+    if (signalCheckEnabled_) {
+      checkOutputs(step, offset, nFrames);
+    }
+  }
+  convertOutputs(step, offset, nFrames);
+  if (step.trackSilence && blockSleepThreshold_ > 0.0f &&
+      !envelope.isSilent()) {
+    trackSilence(step, offset, nFrames);
+  }
+}
+
+template <typename Dispatch>
+void GraphManager::runSteps(PlanStep *begin, PlanStep *end, int nFrames) {
+  for (PlanStep *step = begin; step != end; ++step) {
+    if (step->changeBegin != step->changeEnd) {
+      runSplit(*step, nFrames, [this, step](int o, int n, bool first) {
+        runStep<Dispatch>(*step, o, n, first);
+      });
+    } else {
+      runStep<Dispatch>(*step, 0, nFrames, true);
+    }
+  }
+}
+
+template <typename Dispatch>
+void GraphManager::runStep(PlanStep &step, int offset, int nFrames,
+                           bool firstSegment) {
+  StepIO io;
+  if (beginStep(step, offset, nFrames, firstSegment, io)) {
+    NodeProfile *profile = activeProfile(step);
+    const uint64_t start = profileBegin(profile);
+    Dispatch::process(step.node, io.inputs, io.outputs, nFrames);
+    profileProcess(profile, start);
+    endStep(step, io, offset, nFrames);
+  }
+}
+
+void GraphManager::runBatch(PlanStep *begin, PlanStep *end, int nFrames) {
+  // The steps do not feed each other, so all of them can be set up before
+  // the batch call and finished after it. A step split by parameter
+  // changes runs alone.
+  int count = 0;
+  for (PlanStep *step = begin; step != end; ++step) {
+    if (step->changeBegin != step->changeEnd) {
+      runSplit(*step, nFrames, [this, step](int o, int n, bool first) {
+        runStep<VirtualDispatch>(*step, o, n, first);
+      });
+      continue;
+    }
+    StepIO &io = batchIO_[count];
+    if (beginStep(*step, 0, nFrames, true, io)) {
+      batchSteps_[count] = step;
+      batchNodes_[count] = step->node;
+      batchInputs_[count] = io.inputs;
+      batchOutputs_[count] = io.outputs;
+      ++count;
+    }
+  }
+  if (count == 0) {
+    return;
+  }
+  const uint64_t start = profileBegin(activeProfile(*begin));
+  begin->node->batchProcess_(batchNodes_.data(), count, batchInputs_.data(),
+                             batchOutputs_.data(), nFrames);
+#if MS_PROFILING
+  // The batch is timed as a whole and shared evenly between its nodes.
+  if (activeProfile(*begin)) {
+    const uint64_t share = (ProfileClock::now() - start) / count;
+    for (int i = 0; i < count; ++i) {
+      if (batchSteps_[i]->profile) {
+        batchSteps_[i]->profile->recordProcess(share);
+      }
+    }
+  }
+#else
+  (void)start;
+#endif
+  for (int i = 0; i < count; ++i) {
+    endStep(*batchSteps_[i], batchIO_[i], 0, nFrames);
+  }
+}
+
+void GraphManager::runPlan(int nFrames) {
+  PlanStep *steps = plan_.data();
+  for (const PlanGroup &group : planGroups_) {
+    (this->*group.run)(steps + group.begin, steps + group.end, nFrames);
+  }
+}
+
+GraphManager::RunSteps GraphManager::dispatchFor(const Node *node) {
+  if (node->sampleType_ == SampleType::Float64) {
+    return &GraphManager::runDoubleSteps;
+  }
+  RunSteps run = &GraphManager::runSteps<VirtualDispatch>;
+  BuiltinNodeTypes::forEach([node, &run](auto tag) {
+    using T = typename decltype(tag)::type;
+    if (node->staticType_ == StaticNode<T>::typeKey()) {
+      run = &GraphManager::runSteps<StaticDispatch<T>>;
+    }
+  });
+  return run;
+}
+
+void GraphManager::runControl(PlanStep &step) {
+  const bool paramsChanged =
+      step.node->paramsChanged_.exchange(false, std::memory_order_relaxed);
+  bool dirty = paramsChanged || step.controlPending ||
+               step.node->processControlEveryBlock_;
+  for (uint32_t r = step.controlRouteBegin; !dirty && r < step.controlRouteEnd;
+       ++r) {
+    dirty = controlStamps_[controlRoutes_[r].source] > step.controlSeen;
+  }
+  if (!dirty) {
+    ++blockControlSkipped_;
+    return;
+  }
+
+  ControlSlot *slots = controlSlots_.data();
+  for (uint32_t r = step.controlRouteBegin; r < step.controlRouteEnd; ++r) {
+    slots[controlRoutes_[r].destination] = slots[controlRoutes_[r].source];
+  }
+  step.controlSeen = controlChangeCounter_;
+  step.controlPending = false;
+
+  ControlSlot *outputSlots = slots + step.controlBase + step.numControlInputs;
+  std::copy(outputSlots, outputSlots + step.numControlOutputs,
+            controlScratch_.begin());
+
+  const ControlInputs inputs(slots + step.controlBase, step.numControlInputs);
+  ControlOutputs outputs(outputSlots, step.numControlOutputs);
+  NodeProfile *profile = activeProfile(step);
+  const uint64_t start = profileBegin(profile);
+  step.node->processControl(inputs, outputs);
+  profileEnd(profile, &NodeProfile::control, start);
+  ++blockControlEvaluated_;
+
+  uint64_t *stamps = controlStamps_.data() + step.controlBase +
+                     step.numControlInputs;
+  for (int o = 0; o < step.numControlOutputs; ++o) {
+    if (outputSlots[o].i != controlScratch_[o].i) {
+      stamps[o] = ++controlChangeCounter_;
+    }
+  }
+}
+
+void GraphManager::process(int nFrames) {
+  std::unique_lock<std::mutex> lock(graphMutex_, std::try_to_lock);
+  if (!lock.owns_lock() || !isPrepared_ || needsBufferReallocation_) {
+    return;
+  }
+  physicalInputOffset_ = 0;
+  runBlock(std::min(nFrames, blockSize_));
+}
+
+void GraphManager::process(int nFrames, void *deviceOutput,
+                           SampleFormat format, int numDeviceChannels) {
+  const size_t frameBytes =
+      static_cast<size_t>(numDeviceChannels) * bytesPerSample(format);
+
+  std::unique_lock<std::mutex> lock(graphMutex_, std::try_to_lock);
+  if (!lock.owns_lock() || !isPrepared_ || needsBufferReallocation_ ||
+      numDeviceChannels >
+          static_cast<int>(deviceChannelPointers_.size())) {
+    std::memset(deviceOutput, 0, frameBytes * nFrames);
+    return;
+  }
+
+  uint8_t *out = static_cast<uint8_t *>(deviceOutput);
+  for (int offset = 0; offset < nFrames; offset += blockSize_) {
+    const int n = std::min(blockSize_, nFrames - offset);
+    physicalInputOffset_ = offset;
+    runBlock(n);
+    writeDeviceOutput(out + offset * frameBytes, format, numDeviceChannels, n);
+  }
+  physicalInputOffset_ = 0;
+}
+
+void GraphManager::writeDeviceOutput(void *deviceOutput, SampleFormat format,
+                                     int numDeviceChannels, int nFrames) {
+  // The pointer table was sized when the plan was compiled.
+  std::fill(deviceChannelPointers_.begin(),
+            deviceChannelPointers_.begin() + numDeviceChannels, nullptr);
+  const int bound = std::min<int>(numDeviceChannels,
+                                  static_cast<int>(deviceChannelSources_.size()));
+  for (int c = 0; c < bound; ++c) {
+    const auto &sources = deviceChannelSources_[c];
+    if (sources.size() == 1) {
+      deviceChannelPointers_[c] = sources[0];
+    } else if (sources.size() > 1) {
+      sumBuffers(sources, 0, deviceMixBuffers_[c].data(), nFrames);
+      deviceChannelPointers_[c] = deviceMixBuffers_[c].data();
+    }
+  }
+
+  interleaveToDevice(deviceChannelPointers_.data(), numDeviceChannels,
+                     deviceOutput, format, nFrames, &ditherState_);
+}
+
+const float *GraphManager::getNodeOutput(const std::string &nodeId,
+                                         int outputIndex) const {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  auto it = audioBuffers_.find(nodeId);
+  if (it == audioBuffers_.end() || outputIndex < 0 ||
+      outputIndex >= static_cast<int>(it->second.size())) {
+    return nullptr;
+  }
+  return it->second[outputIndex].data();
+}
+
+int GraphManager::getLatency(const std::string &nodeId) const {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  if (!nodes_.count(nodeId)) {
+    return 0;
+  }
+  std::unordered_map<std::string, int> memo;
+  return pathLatency(nodeId, memo);
+}
+
+int GraphManager::pathLatency(const std::string &nodeId,
+                              std::unordered_map<std::string, int> &memo) const {
+  auto known = memo.find(nodeId);
+  if (known != memo.end()) {
+    return std::max(known->second, 0);
+  }
+  memo[nodeId] = -1;
+
+  const Node *node = nodes_.at(nodeId).get();
+  int inputLatency = 0;
+  for (const auto &c : connections_) {
+    if (c.toNodeId != nodeId) {
+      continue;
+    }
+    const PortType *type = findPortType(node->getInputPorts(), c.toPortName);
+    if (type && *type == PortType::Audio) {
+      inputLatency = std::max(inputLatency, pathLatency(c.fromNodeId, memo));
+    }
+  }
+  const int latency = inputLatency + node->getLatency();
+  memo[nodeId] = latency;
+  return latency;
+}
+
+bool GraphManager::getControlOutput(const std::string &nodeId,
+                                    const std::string &portName,
+                                    ControlValue &value) const {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  auto node = nodes_.find(nodeId);
+  auto layout = controlLayouts_.find(nodeId);
+  if (node == nodes_.end() || layout == controlLayouts_.end()) {
+    return false;
+  }
+  const auto &ports = node->second->getOutputPorts();
+  const int index = portIndex(ports, portName, PortType::Control);
+  if (index < 0) {
+    return false;
+  }
+
+  const ControlSlot slot = controlSlots_[layout->second.base +
+                                         layout->second.numInputs + index];
+  switch (findPort(ports, portName)->controlType) {
+  case ControlType::Float:
+    value = slot.f;
+    break;
+  case ControlType::Int:
+    value = static_cast<int>(slot.i);
+    break;
+  case ControlType::Bool:
+    value = slot.i != 0;
+    break;
+  }
+  return true;
+}
+
+void GraphManager::setPhysicalInput(int channelIndex, const float *data,
+                                    int nFrames) {
+  if (channelIndex < 0) {
+    return;
+  }
+  if (channelIndex >= static_cast<int>(physicalInputBuffers_.size())) {
+    physicalInputBuffers_.resize(channelIndex + 1);
+  }
+  auto &buffer = physicalInputBuffers_[channelIndex];
+  if (static_cast<int>(buffer.size()) < nFrames) {
+    buffer.resize(std::max(nFrames, blockSize_), 0.0f);
+  }
+  std::memcpy(buffer.data(), data, sizeof(float) * nFrames);
+}
+
+const float *GraphManager::getPhysicalInput(int channelIndex) const {
+  if (channelIndex < 0 ||
+      channelIndex >= static_cast<int>(physicalInputBuffers_.size())) {
+    return nullptr;
+  }
+  return physicalInputBuffers_[channelIndex].data() + physicalInputOffset_;
+}
+
+} // namespace ms
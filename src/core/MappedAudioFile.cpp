@@ -0,0 +1,291 @@
+#include "MappedAudioFile.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ms {
+
+namespace {
+
+constexpr uint16_t kFormatPcm = 1;
+constexpr uint16_t kFormatFloat = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+/** Scale of 16-bit samples, as miniaudio converts them. */
+constexpr float kInt16Scale = 1.0f / 32768.0f;
+
+uint16_t readU16(const unsigned char *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const unsigned char *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+#if MS_HAVE_MMAP
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+#endif
+
+} // namespace
+
+MappedAudioFile::~MappedAudioFile() { close(); }
+
+bool MappedAudioFile::map(const std::string &path) {
+  close();
+#if MS_HAVE_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  const size_t bytes = static_cast<size_t>(info.st_size);
+  void *mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  path_ = path;
+  mapping_ = mapping;
+  mappedBytes_ = bytes;
+  return true;
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+void MappedAudioFile::close() {
+#if MS_HAVE_MMAP
+  if (mapping_) {
+    munmap(mapping_, mappedBytes_);
+  }
+#endif
+  path_.clear();
+  mapping_ = nullptr;
+  mappedBytes_ = 0;
+  data_ = nullptr;
+  channels_ = 0;
+  sampleRate_ = 0;
+  frames_ = 0;
+}
+
+bool MappedAudioFile::setLayout(SampleFormat format, int channels,
+                                int sampleRate, size_t dataOffset,
+                                size_t dataBytes) {
+  const size_t sampleBytes = static_cast<size_t>(bytesPerSample(format));
+  // The data is read in place, so its samples must be aligned.
+  if ((format != SampleFormat::S16 && format != SampleFormat::F32) ||
+      channels <= 0 || sampleRate <= 0 || dataOffset % sampleBytes != 0 ||
+      dataOffset >= mappedBytes_) {
+    return false;
+  }
+  // Writers that never patched their header leave a size past the end.
+  dataBytes = std::min(dataBytes, mappedBytes_ - dataOffset);
+  const uint64_t frames = dataBytes / (sampleBytes * channels);
+  if (frames == 0) {
+    return false;
+  }
+  data_ = static_cast<const unsigned char *>(mapping_) + dataOffset;
+  format_ = format;
+  channels_ = channels;
+  sampleRate_ = sampleRate;
+  frames_ = frames;
+  return true;
+}
+
+bool MappedAudioFile::open(const std::string &path) {
+  if (!map(path)) {
+    return false;
+  }
+  const unsigned char *bytes = static_cast<const unsigned char *>(mapping_);
+  if (mappedBytes_ < 12 || std::memcmp(bytes, "RIFF", 4) != 0 ||
+      std::memcmp(bytes + 8, "WAVE", 4) != 0) {
+    close();
+    return false;
+  }
+
+  // Walk the chunks for "fmt " and "data"; chunks are padded to even sizes.
+  const unsigned char *fmt = nullptr;
+  uint32_t fmtBytes = 0;
+  size_t dataOffset = 0;
+  size_t dataBytes = 0;
+  size_t offset = 12;
+  while (offset + 8 <= mappedBytes_) {
+    const uint32_t size = readU32(bytes + offset + 4);
+    if (std::memcmp(bytes + offset, "fmt ", 4) == 0) {
+      fmt = bytes + offset + 8;
+      fmtBytes = size;
+    } else if (std::memcmp(bytes + offset, "data", 4) == 0) {
+      dataOffset = offset + 8;
+      dataBytes = size;
+      break;
+    }
+    offset += 8 + static_cast<size_t>(size) + (size & 1);
+  }
+  if (!fmt || fmtBytes < 16 || dataOffset == 0 ||
+      fmt + fmtBytes > bytes + dataOffset - 8) {
+    close();
+    return false;
+  }
+
+  uint16_t tag = readU16(fmt);
+  const int channels = readU16(fmt + 2);
+  const int sampleRate = static_cast<int>(readU32(fmt + 4));
+  const uint16_t blockAlign = readU16(fmt + 12);
+  const uint16_t bits = readU16(fmt + 14);
+  if (tag == kFormatExtensible && fmtBytes >= 40) {
+    // The subformat GUID starts with the plain format tag.
+    tag = readU16(fmt + 24);
+  }
+  SampleFormat format;
+  if (tag == kFormatPcm && bits == 16) {
+    format = SampleFormat::S16;
+  } else if (tag == kFormatFloat && bits == 32) {
+    format = SampleFormat::F32;
+  } else {
+    close();
+    return false;
+  }
+  if (blockAlign != channels * bits / 8 ||
+      !setLayout(format, channels, sampleRate, dataOffset, dataBytes)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedAudioFile::openRaw(const std::string &path, SampleFormat format,
+                              int channels, int sampleRate,
+                              size_t dataOffset) {
+  if (!map(path)) {
+    return false;
+  }
+  if (!setLayout(format, channels, sampleRate, dataOffset,
+                 mappedBytes_ - std::min(dataOffset, mappedBytes_))) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+Span<const float> MappedAudioFile::getFloatData() const {
+  if (!data_ || format_ != SampleFormat::F32) {
+    return Span<const float>();
+  }
+  return Span<const float>(reinterpret_cast<const float *>(data_),
+                           static_cast<size_t>(frames_) * channels_);
+}
+
+Span<const int16_t> MappedAudioFile::getInt16Data() const {
+  if (!data_ || format_ != SampleFormat::S16) {
+    return Span<const int16_t>();
+  }
+  return Span<const int16_t>(reinterpret_cast<const int16_t *>(data_),
+                             static_cast<size_t>(frames_) * channels_);
+}
+
+void MappedAudioFile::advise(AccessPattern pattern) const {
+#if MS_HAVE_MMAP
+  if (!mapping_) {
+    return;
+  }
+  int advice = MADV_NORMAL;
+  if (pattern == AccessPattern::Sequential) {
+    advice = MADV_SEQUENTIAL;
+  } else if (pattern == AccessPattern::Random) {
+    advice = MADV_RANDOM;
+  }
+  madvise(mapping_, mappedBytes_, advice);
+#else
+  (void)pattern;
+#endif
+}
+
+void MappedAudioFile::prefetch(uint64_t frame, uint64_t count) const {
+#if MS_HAVE_MMAP
+  if (!data_ || frame >= frames_) {
+    return;
+  }
+  count = std::min(count, frames_ - frame);
+  const size_t frameBytes =
+      static_cast<size_t>(bytesPerSample(format_)) * channels_;
+  // madvise wants a page-aligned start.
+  const unsigned char *mapping = static_cast<const unsigned char *>(mapping_);
+  const size_t begin =
+      static_cast<size_t>(data_ - mapping) + frame * frameBytes;
+  const size_t aligned = begin - begin % pageSize();
+  madvise(const_cast<unsigned char *>(mapping) + aligned,
+          begin + count * frameBytes - aligned, MADV_WILLNEED);
+#else
+  (void)frame;
+  (void)count;
+#endif
+}
+
+void MappedAudioFile::touch(uint64_t frame, uint64_t count) const {
+#if MS_HAVE_MMAP
+  if (!data_ || frame >= frames_ || count == 0) {
+    return;
+  }
+  count = std::min(count, frames_ - frame);
+  const size_t frameBytes =
+      static_cast<size_t>(bytesPerSample(format_)) * channels_;
+  const volatile unsigned char *begin = data_ + frame * frameBytes;
+  const volatile unsigned char *end = begin + count * frameBytes;
+  // One read per page faults it in; the last byte covers the final page.
+  unsigned char sink = 0;
+  for (const volatile unsigned char *p = begin; p < end; p += pageSize()) {
+    sink ^= *p;
+  }
+  sink ^= end[-1];
+  (void)sink;
+#else
+  (void)frame;
+  (void)count;
+#endif
+}
+
+uint64_t MappedAudioFile::read(uint64_t frame, uint64_t count,
+                               float *output) const {
+  if (!data_ || frame >= frames_) {
+    return 0;
+  }
+  count = std::min(count, frames_ - frame);
+  const size_t samples = static_cast<size_t>(count) * channels_;
+  const size_t first = static_cast<size_t>(frame) * channels_;
+  if (format_ == SampleFormat::F32) {
+    std::memcpy(output, reinterpret_cast<const float *>(data_) + first,
+                samples * sizeof(float));
+    return count;
+  }
+  const int16_t *in = reinterpret_cast<const int16_t *>(data_) + first;
+  const simd::Float4 scale = simd::Float4::set1(kInt16Scale);
+  size_t i = 0;
+  for (; i + simd::kWidth <= samples; i += simd::kWidth) {
+    (simd::Float4::loadInt16(in + i) * scale).store(output + i);
+  }
+  for (; i < samples; ++i) {
+    output[i] = in[i] * kInt16Scale;
+  }
+  return count;
+}
+
+} // namespace ms
@@ -0,0 +1,133 @@
+#include "MirroredRingBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__linux__)
+#define MS_HAVE_MEMFD 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ms {
+
+namespace {
+
+/** Page size; the ring's bytes must be a whole number of pages to alias. */
+size_t pageSize() {
+#if MS_HAVE_MEMFD
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+#else
+  return 4096;
+#endif
+}
+
+} // namespace
+
+MirroredRingBuffer::~MirroredRingBuffer() { release(); }
+
+MirroredRingBuffer::MirroredRingBuffer(MirroredRingBuffer &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      mapping_(std::exchange(other.mapping_, nullptr)),
+      fallback_(std::move(other.fallback_)) {}
+
+MirroredRingBuffer &
+MirroredRingBuffer::operator=(MirroredRingBuffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+    mapping_ = std::exchange(other.mapping_, nullptr);
+    fallback_ = std::move(other.fallback_);
+  }
+  return *this;
+}
+
+void MirroredRingBuffer::allocate(size_t minCapacity) {
+  release();
+  const size_t perPage = pageSize() / sizeof(float);
+  const size_t capacity =
+      (std::max<size_t>(minCapacity, 1) + perPage - 1) / perPage * perPage;
+  if (!mapMirrored(capacity)) {
+    fallback_.assign(2 * capacity, 0.0f);
+    data_ = fallback_.data();
+  }
+  capacity_ = capacity;
+}
+
+bool MirroredRingBuffer::mapMirrored(size_t capacity) {
+#if MS_HAVE_MEMFD
+  const size_t bytes = capacity * sizeof(float);
+  const int fd = memfd_create("ms-ring", MFD_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  // Reserve both halves in one range, then map the file over each. The
+  // pages are prefaulted so the audio thread never takes the first fault.
+  void *range = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+    range = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                 -1, 0);
+  }
+  bool mapped = range != MAP_FAILED;
+  for (int half = 0; mapped && half < 2; ++half) {
+    void *address = static_cast<unsigned char *>(range) + half * bytes;
+    mapped = mmap(address, bytes, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_FIXED | MAP_POPULATE, fd,
+                  0) == address;
+  }
+  // The mappings keep their own reference to the memfd.
+  ::close(fd);
+  if (!mapped) {
+    if (range != MAP_FAILED) {
+      munmap(range, 2 * bytes);
+    }
+    return false;
+  }
+  mapping_ = range;
+  data_ = static_cast<float *>(range);
+  return true;
+#else
+  (void)capacity;
+  return false;
+#endif
+}
+
+void MirroredRingBuffer::release() {
+#if MS_HAVE_MEMFD
+  if (mapping_) {
+    munmap(mapping_, 2 * capacity_ * sizeof(float));
+  }
+#endif
+  mapping_ = nullptr;
+  fallback_.clear();
+  fallback_.shrink_to_fit();
+  data_ = nullptr;
+  capacity_ = 0;
+}
+
+void MirroredRingBuffer::clear() {
+  if (data_) {
+    // With shared pages, clearing one half clears both.
+    std::fill(data_, data_ + (mapping_ ? capacity_ : 2 * capacity_), 0.0f);
+  }
+}
+
+void MirroredRingBuffer::copyToMirror(size_t position, size_t count) {
+  // The part in the first half goes up one capacity, the rest down one.
+  const size_t end = position + count;
+  if (position < capacity_) {
+    const size_t split = std::min(end, capacity_);
+    std::memcpy(data_ + position + capacity_, data_ + position,
+                (split - position) * sizeof(float));
+    position = split;
+  }
+  if (position < end) {
+    std::memcpy(data_ + position - capacity_, data_ + position,
+                (end - position) * sizeof(float));
+  }
+}
+
+} // namespace ms
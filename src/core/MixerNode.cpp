@@ -0,0 +1,232 @@
+#include "MixerNode.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace ms {
+
+namespace {
+
+using simd::Float4;
+using simd::UInt4;
+
+constexpr float kHalfPi = 1.57079632679f;
+
+/** Outputs accumulated per pass over an input. */
+constexpr int kPassOutputs = 4;
+
+/** One output an input reaches: its gain and, while ramping, increment. */
+struct Send {
+  float *out;
+  float gain;
+  float step;
+};
+
+/** Frames tested at a time for silence, so playing inputs exit early. */
+constexpr int kSilenceChunk = 16;
+
+/** Returns true if every sample of the block is zero (of either sign). */
+bool isSilent(const float *in, int nFrames) {
+  const UInt4 magnitude = UInt4::set1(0x7FFFFFFFu);
+  int i = 0;
+  while (i + kSilenceChunk <= nFrames) {
+    UInt4 bits = UInt4::set1(0);
+    for (const int end = i + kSilenceChunk; i < end; i += simd::kWidth) {
+      bits = bits | (Float4::load(in + i).asUInt() & magnitude);
+    }
+    uint32_t lanes[simd::kWidth];
+    bits.store(lanes);
+    if ((lanes[0] | lanes[1] | lanes[2] | lanes[3]) != 0) {
+      return false;
+    }
+  }
+  for (; i < nFrames; ++i) {
+    if (in[i] != 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Accumulates frames [begin, end) of an input into K outputs. A ramping
+ * send's gain at frame i is gain + step * (i - begin + 1).
+ */
+template <int K, bool Ramping>
+void mixPass(const float *in, const Send *sends, int begin, int end) {
+  float *outs[K];
+  Float4 gains[K];
+  Float4 steps[K];
+  for (int k = 0; k < K; ++k) {
+    outs[k] = sends[k].out;
+    gains[k] = Float4::set1(sends[k].gain);
+    steps[k] = Float4::set1(sends[k].step);
+  }
+  Float4 index = Float4::set(1.0f, 2.0f, 3.0f, 4.0f);
+  int i = begin;
+  for (; i + simd::kWidth <= end; i += simd::kWidth) {
+    const Float4 x = Float4::load(in + i);
+    for (int k = 0; k < K; ++k) {
+      const Float4 gain = Ramping ? gains[k] + steps[k] * index : gains[k];
+      (Float4::load(outs[k] + i) + x * gain).store(outs[k] + i);
+    }
+    if (Ramping) {
+      index += Float4::set1(static_cast<float>(simd::kWidth));
+    }
+  }
+  for (; i < end; ++i) {
+    const float t = static_cast<float>(i - begin + 1);
+    for (int k = 0; k < K; ++k) {
+      const float gain =
+          Ramping ? sends[k].gain + sends[k].step * t : sends[k].gain;
+      outs[k][i] += in[i] * gain;
+    }
+  }
+}
+
+/** Accumulates an input into all its sends, kPassOutputs per pass. */
+template <bool Ramping>
+void mixSends(const float *in, const Send *sends, int count, int begin,
+              int end) {
+  for (int s = 0; s < count; s += kPassOutputs) {
+    switch (std::min(count - s, kPassOutputs)) {
+    case 4:
+      mixPass<4, Ramping>(in, sends + s, begin, end);
+      break;
+    case 3:
+      mixPass<3, Ramping>(in, sends + s, begin, end);
+      break;
+    case 2:
+      mixPass<2, Ramping>(in, sends + s, begin, end);
+      break;
+    default:
+      mixPass<1, Ramping>(in, sends + s, begin, end);
+      break;
+    }
+  }
+}
+
+} // namespace
+
+MixerNode::MixerNode(const std::string &id, int numInputs, int numOutputs)
+    : StaticNode<MixerNode>(id), numInputs_(std::max(numInputs, 1)),
+      numOutputs_(std::max(numOutputs, 1)) {
+  for (int i = 0; i < numInputs_; ++i) {
+    addInputPort("in" + std::to_string(i), PortType::Audio);
+  }
+  for (int o = 0; o < numOutputs_; ++o) {
+    addOutputPort("out" + std::to_string(o), PortType::Audio);
+  }
+  for (int i = 0; i < numInputs_; ++i) {
+    gainParams_.push_back(addParam("gain" + std::to_string(i), 1.0f));
+    panParams_.push_back(addParam("pan" + std::to_string(i), 0.0f));
+  }
+  const size_t entries = static_cast<size_t>(numInputs_) * numOutputs_;
+  cachedGain_.assign(numInputs_, 1.0f);
+  cachedPan_.assign(numInputs_, 0.0f);
+  gains_.assign(entries, 0.0f);
+  targets_.assign(entries, 0.0f);
+  steps_.assign(entries, 0.0f);
+  rampLeft_.assign(numInputs_, 0);
+  for (int i = 0; i < numInputs_; ++i) {
+    computeTargets(i, 1.0f, 0.0f);
+  }
+  gains_ = targets_;
+  setTailLength(0);
+}
+
+void MixerNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  rampFrames_ = std::max(1, static_cast<int>(sampleRate * kRampMs / 1000.0f));
+  // Parameters set before the graph starts apply at once.
+  for (int i = 0; i < numInputs_; ++i) {
+    computeTargets(i, getParam(gainParams_[i])->asFloat(),
+                   getParam(panParams_[i])->asFloat());
+    rampLeft_[i] = 0;
+  }
+  gains_ = targets_;
+}
+
+void MixerNode::computeTargets(int input, float gain, float pan) {
+  cachedGain_[input] = gain;
+  cachedPan_[input] = pan;
+  float *target = targets_.data() + static_cast<size_t>(input) * numOutputs_;
+  std::fill(target, target + numOutputs_, 0.0f);
+  if (numOutputs_ == 1) {
+    target[0] = gain;
+    return;
+  }
+  const float position = (std::min(std::max(pan, -1.0f), 1.0f) + 1.0f) *
+                         0.5f * static_cast<float>(numOutputs_ - 1);
+  const int left = std::min(static_cast<int>(position), numOutputs_ - 2);
+  const float fraction = position - static_cast<float>(left);
+  // The ends are exact, so a hard-panned input reaches one output only.
+  target[left] = fraction < 1.0f ? gain * std::cos(kHalfPi * fraction) : 0.0f;
+  target[left + 1] =
+      fraction > 0.0f ? gain * std::sin(kHalfPi * fraction) : 0.0f;
+}
+
+void MixerNode::render(const float *const *inputs, float **outputs,
+                       int nFrames) {
+  for (int o = 0; o < numOutputs_; ++o) {
+    std::fill(outputs[o], outputs[o] + nFrames, 0.0f);
+  }
+  Send sends[64];
+  const int maxSends = static_cast<int>(sizeof(sends) / sizeof(sends[0]));
+
+  for (int i = 0; i < numInputs_; ++i) {
+    const size_t rowBegin = static_cast<size_t>(i) * numOutputs_;
+    float *row = gains_.data() + rowBegin;
+    const float *target = targets_.data() + rowBegin;
+    float *step = steps_.data() + rowBegin;
+
+    const float gain = getParam(gainParams_[i])->asFloat();
+    const float pan = getParam(panParams_[i])->asFloat();
+    if (gain != cachedGain_[i] || pan != cachedPan_[i]) {
+      // Ramp from wherever the row is, even mid-ramp.
+      computeTargets(i, gain, pan);
+      for (int o = 0; o < numOutputs_; ++o) {
+        step[o] = (target[o] - row[o]) / static_cast<float>(rampFrames_);
+      }
+      rampLeft_[i] = rampFrames_;
+    }
+
+    const int ramp = std::min(rampLeft_[i], nFrames);
+    const float *in = inputs[i];
+    if (!isSilent(in, nFrames)) {
+      // Ramping frames first, then frames at the target gains. Sends are
+      // gathered in batches when there are more outputs than fit.
+      for (int o = 0; o < numOutputs_ && ramp > 0;) {
+        int count = 0;
+        for (; o < numOutputs_ && count < maxSends; ++o) {
+          if (row[o] != 0.0f || step[o] != 0.0f) {
+            sends[count++] = Send{outputs[o], row[o], step[o]};
+          }
+        }
+        mixSends<true>(in, sends, count, 0, ramp);
+      }
+      for (int o = 0; o < numOutputs_ && ramp < nFrames;) {
+        int count = 0;
+        for (; o < numOutputs_ && count < maxSends; ++o) {
+          if (target[o] != 0.0f) {
+            sends[count++] = Send{outputs[o], target[o], 0.0f};
+          }
+        }
+        mixSends<false>(in, sends, count, ramp, nFrames);
+      }
+    }
+
+    if (rampLeft_[i] > nFrames) {
+      for (int o = 0; o < numOutputs_; ++o) {
+        row[o] += step[o] * static_cast<float>(nFrames);
+      }
+      rampLeft_[i] -= nFrames;
+    } else if (rampLeft_[i] > 0) {
+      std::copy(target, target + numOutputs_, row);
+      std::fill(step, step + numOutputs_, 0.0f);
+      rampLeft_[i] = 0;
+    }
+  }
+}
+
+} // namespace ms
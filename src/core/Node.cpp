@@ -1,28 +1,18 @@
 #include "Node.hpp"
+#include "GraphManager.hpp"
 
 namespace ms {
 
 void Node::applyFadeIn(float *buffer, int nFrames) {
-  if (!fadeInActive_) {
+  if (graph_) {
     return;
   }
-
-  for (int i = 0; i < nFrames; ++i) {
-    if (currentFadeInSample_ <  fadeInSamples_) {
-      float fadeInGain = static_cast<float>(currentFadeInSample_) / fadeInSamples_;
-      buffer[i] *= fadeInGain;
-      currentFadeInSample_++;
-    } else {
-      fadeInActive_ = false;
-      break;
-    }
-  }
+  float *const buffers[1] = {buffer};
+  envelope_.apply(buffers, 1, nFrames);
 }
 
 const float *Node::getPhysicalInput(int channelIndex) const {
-  // Placeholder implementation
-  // In the real implementation, this would interface with the audio hardware
-  return nullptr;
+  return graph_ ? graph_->getPhysicalInput(channelIndex) : nullptr;
 }
 
 }
@@ -0,0 +1,78 @@
+#include "NodePool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace ms {
+
+NodePool::NodePool(size_t chunkSize)
+    : chunkSize_(blockSize(chunkSize, kCacheLineSize)) {}
+
+NodePool::~NodePool() {
+  for (const Chunk &chunk : chunks_) {
+    ::operator delete(chunk.data, std::align_val_t(kCacheLineSize));
+  }
+}
+
+size_t NodePool::blockSize(size_t size, size_t alignment) {
+  const size_t granularity = std::max(alignment, kCacheLineSize);
+  return (std::max<size_t>(size, 1) + granularity - 1) / granularity *
+         granularity;
+}
+
+void *NodePool::allocate(size_t size, size_t alignment) {
+  const size_t bytes = blockSize(size, alignment);
+  const size_t align = std::max(alignment, kCacheLineSize);
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto freeList = freeBlocks_.find({bytes, align});
+  if (freeList != freeBlocks_.end() && !freeList->second.empty()) {
+    void *block = freeList->second.back();
+    freeList->second.pop_back();
+    bytesInUse_ += bytes;
+    return block;
+  }
+
+  auto aligned = [align](char *p) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char *>((address + align - 1) / align * align);
+  };
+  char *block = cursor_ ? aligned(cursor_) : nullptr;
+  if (!block || block + bytes > end_) {
+    // Oversized or over-aligned nodes get a chunk of their own.
+    const size_t size = std::max(chunkSize_, bytes + align);
+    char *data = static_cast<char *>(
+        ::operator new(size, std::align_val_t(kCacheLineSize)));
+    chunks_.push_back({data, size});
+    bytesReserved_ += size;
+    cursor_ = data;
+    end_ = data + size;
+    block = aligned(cursor_);
+  }
+  cursor_ = block + bytes;
+  bytesInUse_ += bytes;
+  return block;
+}
+
+void NodePool::deallocate(void *block, size_t size, size_t alignment) {
+  if (!block) {
+    return;
+  }
+  const size_t bytes = blockSize(size, alignment);
+  const size_t align = std::max(alignment, kCacheLineSize);
+  std::lock_guard<std::mutex> lock(mutex_);
+  freeBlocks_[{bytes, align}].push_back(block);
+  bytesInUse_ -= bytes;
+}
+
+size_t NodePool::getBytesInUse() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytesInUse_;
+}
+
+size_t NodePool::getBytesReserved() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytesReserved_;
+}
+
+} // namespace ms
@@ -0,0 +1,46 @@
+#include "NodeRegistry.hpp"
+#include "BuiltinNodes.hpp"
+
+namespace ms {
+
+NodeRegistry &NodeRegistry::instance() {
+  static NodeRegistry registry;
+  return registry;
+}
+
+NodeRegistry::NodeRegistry() {
+  BuiltinNodeTypes::forEach([this](auto tag) {
+    using T = typename decltype(tag)::type;
+    add<T>(T::kTypeName);
+  });
+}
+
+bool NodeRegistry::add(const std::string &typeName, const Entry &entry) {
+  if (!entry.construct) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.emplace(typeName, entry).second;
+}
+
+bool NodeRegistry::find(const std::string &typeName, Entry &entry) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(typeName);
+  if (it == entries_.end()) {
+    return false;
+  }
+  entry = it->second;
+  return true;
+}
+
+std::vector<std::string> NodeRegistry::getTypeNames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> names;
+  names.reserve(entries_.size());
+  for (const auto &entry : entries_) {
+    names.push_back(entry.first);
+  }
+  return names;
+}
+
+} // namespace ms
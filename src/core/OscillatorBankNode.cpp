@@ -0,0 +1,193 @@
+#include "OscillatorBankNode.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+
+namespace ms {
+
+namespace {
+
+using simd::Float4;
+using simd::UInt4;
+
+constexpr uint32_t kSignBit = 0x80000000u;
+
+/**
+ * sin(2 pi x) for a phase in cycles. The lanes of phase hold the fraction
+ * of a cycle as a 32-bit fixed-point number.
+ */
+struct SineWave {
+  static Float4 sample(UInt4 phase, Float4, Float4) {
+    // Read as signed, the phase is x in [-0.5, 0.5). sin(2 pi x) is odd and
+    // symmetric about x = 0.25, so z = min(|x|, 0.5 - |x|) in [0, 0.25]
+    // covers it with one odd polynomial (minimax, degree 7).
+    const Float4 x = phase.toFloat() * Float4::set1(0x1p-32f);
+    const Float4 ax = (x.asUInt() & UInt4::set1(~kSignBit)).asFloat();
+    const Float4 z = simd::min(ax, Float4::set1(0.5f) - ax);
+    const Float4 z2 = z * z;
+    Float4 p = Float4::set1(-7.099343872e+01f);
+    p = p * z2 + Float4::set1(8.134076691e+01f);
+    p = p * z2 + Float4::set1(-4.133714294e+01f);
+    p = p * z2 + Float4::set1(6.283164024e+00f);
+    p = p * z;
+    return (p.asUInt() ^ (phase & UInt4::set1(kSignBit))).asFloat();
+  }
+};
+
+/** Returns the phase as a float in [0, 1). */
+inline Float4 unitPhase(UInt4 phase) {
+  return phase.shr<8>().toFloat() * Float4::set1(0x1p-24f);
+}
+
+/**
+ * PolyBLEP residual of a unit step at phase 0: a two-sample polynomial
+ * correction that cancels most of the aliasing of the discontinuity.
+ * step is the phase increment in cycles and inverseStep its reciprocal.
+ */
+inline Float4 polyBlep(Float4 t, Float4 step, Float4 inverseStep) {
+  const Float4 one = Float4::set1(1.0f);
+  // Just after the wrap: -(1 - t/dt)^2.
+  const Float4 after = one - t * inverseStep;
+  const UInt4 isAfter = simd::lessThan(t, step);
+  // Just before it: (1 + (t - 1)/dt)^2.
+  const Float4 before = one + (t - one) * inverseStep;
+  const UInt4 isBefore = simd::lessThan(one - step, t);
+  return (((Float4::zero() - after * after).asUInt() & isAfter) |
+          ((before * before).asUInt() & isBefore))
+      .asFloat();
+}
+
+/** Sawtooth rising from -1 to 1. */
+struct SawWave {
+  static Float4 sample(UInt4 phase, Float4 step, Float4 inverseStep) {
+    const Float4 t = unitPhase(phase);
+    return t + t - Float4::set1(1.0f) - polyBlep(t, step, inverseStep);
+  }
+};
+
+/** Square, 1 in the first half of the cycle and -1 in the second. */
+struct SquareWave {
+  static Float4 sample(UInt4 phase, Float4 step, Float4 inverseStep) {
+    const Float4 naive =
+        (Float4::set1(1.0f).asUInt() ^ (phase & UInt4::set1(kSignBit)))
+            .asFloat();
+    const Float4 rise = unitPhase(phase);
+    const Float4 fall = unitPhase(phase + UInt4::set1(kSignBit));
+    return naive + polyBlep(rise, step, inverseStep) -
+           polyBlep(fall, step, inverseStep);
+  }
+};
+
+} // namespace
+
+OscillatorBankNode::OscillatorBankNode(const std::string &id,
+                                       int numOscillators,
+                                       OscillatorWaveform waveform)
+    : StaticNode<OscillatorBankNode>(id),
+      numOscillators_(std::max(numOscillators, 1)),
+      activeWaveform_(waveform) {
+  const float amplitude = 1.0f / static_cast<float>(numOscillators_);
+  for (int k = 0; k < numOscillators_; ++k) {
+    addControlInputPort("freq" + std::to_string(k), ControlType::Float,
+                        ControlSlot::fromFloat(440.0f));
+    addControlInputPort("amp" + std::to_string(k), ControlType::Float,
+                        ControlSlot::fromFloat(amplitude));
+  }
+  addOutputPort("out", PortType::Audio);
+  waveform_ = addParam("waveform", static_cast<int>(waveform));
+
+  const size_t padded =
+      (static_cast<size_t>(numOscillators_) + simd::kWidth - 1) /
+      simd::kWidth * simd::kWidth;
+  phases_.assign(padded, 0);
+  increments_.assign(padded, 0);
+  frequencies_.assign(padded, 0.0f);
+  steps_.assign(padded, 0.0f);
+  inverseSteps_.assign(padded, 0.0f);
+  amplitudes_.assign(padded, 0.0f);
+  targetAmplitudes_.assign(padded, 0.0f);
+  for (int k = 0; k < numOscillators_; ++k) {
+    frequencies_[k] = 440.0f;
+    amplitudes_[k] = targetAmplitudes_[k] = amplitude;
+  }
+}
+
+void OscillatorBankNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  laneMix_.assign(static_cast<size_t>(blockSize) * simd::kWidth, 0.0f);
+  for (int k = 0; k < numOscillators_; ++k) {
+    updateIncrement(k);
+  }
+}
+
+void OscillatorBankNode::updateIncrement(int k) {
+  const double cycles = std::min(
+      std::max(static_cast<double>(frequencies_[k]) / sampleRate_, 0.0),
+      0.4999);
+  increments_[k] = static_cast<uint32_t>(cycles * 4294967296.0);
+  steps_[k] = static_cast<float>(cycles);
+  inverseSteps_[k] = cycles > 0.0 ? static_cast<float>(1.0 / cycles) : 0.0f;
+}
+
+void OscillatorBankNode::processControl(const ControlInputs &inputControls,
+                                        ControlOutputs &outputControls) {
+  (void)outputControls;
+  for (int k = 0; k < numOscillators_; ++k) {
+    const float frequency = inputControls.getFloat(2 * k);
+    if (frequency != frequencies_[k]) {
+      frequencies_[k] = frequency;
+      updateIncrement(k);
+    }
+    targetAmplitudes_[k] = inputControls.getFloat(2 * k + 1);
+  }
+  const int waveform = getParam(waveform_)->asInt();
+  activeWaveform_ = static_cast<OscillatorWaveform>(
+      std::min(std::max(waveform, 0),
+               static_cast<int>(OscillatorWaveform::Square)));
+}
+
+void OscillatorBankNode::render(float *out, int nFrames) {
+  switch (activeWaveform_) {
+  case OscillatorWaveform::Sine:
+    renderWith<SineWave>(out, nFrames);
+    break;
+  case OscillatorWaveform::Saw:
+    renderWith<SawWave>(out, nFrames);
+    break;
+  case OscillatorWaveform::Square:
+    renderWith<SquareWave>(out, nFrames);
+    break;
+  }
+}
+
+template <typename Wave>
+void OscillatorBankNode::renderWith(float *out, int nFrames) {
+  // Each group of four oscillators keeps its state in registers for the
+  // whole block and adds into one partial mix per lane; the lanes are
+  // summed once per frame at the end.
+  float *mix = laneMix_.data();
+  const Float4 inverseFrames = Float4::set1(1.0f / static_cast<float>(nFrames));
+  for (size_t g = 0; g < phases_.size(); g += simd::kWidth) {
+    UInt4 phase = UInt4::load(phases_.data() + g);
+    const UInt4 increment = UInt4::load(increments_.data() + g);
+    const Float4 step = Float4::load(steps_.data() + g);
+    const Float4 inverseStep = Float4::load(inverseSteps_.data() + g);
+    const Float4 target = Float4::load(targetAmplitudes_.data() + g);
+    Float4 amplitude = Float4::load(amplitudes_.data() + g);
+    const Float4 ramp = (target - amplitude) * inverseFrames;
+
+    for (int i = 0; i < nFrames; ++i) {
+      const Float4 y = amplitude * Wave::sample(phase, step, inverseStep);
+      (g == 0 ? y : Float4::load(mix + i * simd::kWidth) + y)
+          .store(mix + i * simd::kWidth);
+      phase = phase + increment;
+      amplitude += ramp;
+    }
+    phase.store(phases_.data() + g);
+    target.store(amplitudes_.data() + g);
+  }
+  for (int i = 0; i < nFrames; ++i) {
+    out[i] = simd::horizontalSum(Float4::load(mix + i * simd::kWidth));
+  }
+}
+
+} // namespace ms
@@ -0,0 +1,397 @@
+#include "Oversampler.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace ms {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/** Number of channels an IIR filter state processes, one per lane. */
+constexpr int kLanes = simd::kWidth;
+
+/** Filter lengths per stage; later stages see less of the band. */
+constexpr int kFirHalfLength[] = {32, 8, 8};
+constexpr double kFirKaiserBeta[] = {8.0, 8.0, 8.0};
+constexpr int kIirCoefs[] = {12, 6, 4};
+constexpr double kIirTransition[] = {0.03, 0.12, 0.2};
+
+/** Zeroth-order modified Bessel function of the first kind. */
+double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 50 && term > 1e-12 * sum; ++k) {
+    const double t = x / (2.0 * k);
+    term *= t * t;
+    sum += term;
+  }
+  return sum;
+}
+
+/**
+ * Designs the non-zero odd taps of a Kaiser-windowed half-band lowpass of
+ * length 4 * halfLength - 1 (the other phase is a pure delay). Tap i
+ * weights the i-th newest input; the taps sum to one.
+ */
+std::vector<float> designHalfBandTaps(int halfLength, double beta) {
+  const int numTaps = 2 * halfLength;
+  std::vector<double> taps(numTaps);
+  double sum = 0.0;
+  for (int i = 0; i < numTaps; ++i) {
+    // Offset from the filter centre in high-rate samples (always odd).
+    const double d = 2.0 * halfLength - 1.0 - 2.0 * i;
+    const double sinc = std::sin(kPi * d / 2.0) / (kPi * d / 2.0);
+    const double r = d / (2.0 * halfLength);
+    const double window = besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta);
+    taps[i] = sinc * window;
+    sum += taps[i];
+  }
+  std::vector<float> result(numTaps);
+  for (int i = 0; i < numTaps; ++i) {
+    result[i] = static_cast<float>(taps[i] / sum);
+  }
+  return result;
+}
+
+/**
+ * Designs the coefficients of a polyphase allpass half-band filter with the
+ * given normalized transition bandwidth (elliptic design, after
+ * Valenzuela & Constantinides). Even coefficients belong to the first
+ * branch, odd ones to the second.
+ */
+std::vector<float> designAllpassCoefs(int count, double transition) {
+  double k = std::tan((1.0 - transition * 2.0) * kPi / 4.0);
+  k *= k;
+  const double kksqrt = std::pow(1.0 - k * k, 0.25);
+  const double e = 0.5 * (1.0 - kksqrt) / (1.0 + kksqrt);
+  const double e4 = e * e * e * e;
+  const double q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+  const int order = count * 2 + 1;
+  std::vector<float> coefs(count);
+  for (int index = 0; index < count; ++index) {
+    const int c = index + 1;
+    double num = 0.0;
+    double term = 0.0;
+    int i = 0;
+    do {
+      term = std::pow(q, i * (i + 1)) * std::sin((i * 2 + 1) * c * kPi / order);
+      num += (i & 1) ? -term : term;
+      ++i;
+    } while (std::fabs(term) > 1e-100);
+    num *= std::pow(q, 0.25);
+
+    double den = 0.0;
+    i = 1;
+    do {
+      term = std::pow(q, i * i) * std::cos(i * 2 * c * kPi / order);
+      den += (i & 1) ? -term : term;
+      ++i;
+    } while (std::fabs(term) > 1e-100);
+    den += 0.5;
+
+    const double ww = num / den;
+    const double wwsq = ww * ww;
+    const double x =
+        std::sqrt((1.0 - wwsq * k) * (1.0 - wwsq / k)) / (1.0 + wwsq);
+    coefs[index] = static_cast<float>((1.0 - x) / (1.0 + x));
+  }
+  return coefs;
+}
+
+/** Dot product of n taps (a multiple of four) with n samples. */
+inline float dot(const float *taps, const float *samples, int n) {
+  simd::Float4 acc = simd::Float4::zero();
+  for (int i = 0; i < n; i += simd::kWidth) {
+    acc += simd::Float4::load(taps + i) * simd::Float4::load(samples + i);
+  }
+  return simd::horizontalSum(acc);
+}
+
+/**
+ * Runs one sample through the allpass sections of both branches; a holds
+ * the first branch's lanes and b the second's. x and y hold the previous
+ * input and output of each section.
+ */
+inline void allpassPairs(const float *coefs, int count, float *x, float *y,
+                         simd::Float4 &a, simd::Float4 &b) {
+  for (int k = 0; k < count; k += 2) {
+    const simd::Float4 x0 = simd::Float4::load(x + k * kLanes);
+    const simd::Float4 x1 = simd::Float4::load(x + (k + 1) * kLanes);
+    a.store(x + k * kLanes);
+    b.store(x + (k + 1) * kLanes);
+    a = (a - simd::Float4::load(y + k * kLanes)) * simd::Float4::set1(coefs[k]) +
+        x0;
+    b = (b - simd::Float4::load(y + (k + 1) * kLanes)) *
+            simd::Float4::set1(coefs[k + 1]) +
+        x1;
+    a.store(y + k * kLanes);
+    b.store(y + (k + 1) * kLanes);
+  }
+}
+
+inline simd::Float4 gather(const float *const *channels, int lanes,
+                           int index) {
+  float tmp[kLanes] = {};
+  for (int l = 0; l < lanes; ++l) {
+    tmp[l] = channels[l][index];
+  }
+  return simd::Float4::load(tmp);
+}
+
+inline void scatter(simd::Float4 value, float *const *channels, int lanes,
+                    int index) {
+  float tmp[kLanes];
+  value.store(tmp);
+  for (int l = 0; l < lanes; ++l) {
+    channels[l][index] = tmp[l];
+  }
+}
+
+} // namespace
+
+Oversampler::Oversampler(int factor, OversamplingFilter filter)
+    : filter_(filter) {
+  numStages_ = factor >= 8 ? 3 : factor >= 4 ? 2 : factor >= 2 ? 1 : 0;
+  factor_ = 1 << numStages_;
+
+  for (int s = 0; s < numStages_; ++s) {
+    Stage stage;
+    if (filter_ == OversamplingFilter::LinearPhase) {
+      stage.taps = designHalfBandTaps(kFirHalfLength[s], kFirKaiserBeta[s]);
+      // The interpolated phase is centred between the halfLength-th and
+      // the (halfLength + 1)-th newest input, once in each direction.
+      stage.latency = 2.0 * kFirHalfLength[s] - 1.0;
+    } else {
+      stage.coefs = designAllpassCoefs(kIirCoefs[s], kIirTransition[s]);
+      // Each first-order section delays low frequencies by
+      // (1 - c) / (1 + c) samples; the two branches are averaged in each
+      // direction.
+      for (float c : stage.coefs) {
+        stage.latency += (1.0 - c) / (1.0 + c);
+      }
+    }
+    filterLatency_ +=
+        stage.latency * static_cast<double>(1 << (numStages_ - s));
+    stages_.push_back(std::move(stage));
+  }
+}
+
+void Oversampler::prepareDirection(Direction &direction, int numChannels,
+                                   int maxFrames) {
+  direction.numChannels = numChannels;
+  direction.numStates = filter_ == OversamplingFilter::LinearPhase
+                            ? numChannels
+                            : (numChannels + kLanes - 1) / kLanes;
+  direction.filters.assign(
+      static_cast<size_t>(numStages_) * direction.numStates, FilterState());
+  for (int s = 0; s < numStages_; ++s) {
+    const Stage &stage = stages_[s];
+    for (int i = 0; i < direction.numStates; ++i) {
+      FilterState &state = direction.filters[s * direction.numStates + i];
+      state.history.resize(stage.taps.size() * 2);
+      state.odd.resize(stage.taps.size() * 2);
+      state.x.resize(stage.coefs.size() * kLanes);
+      state.y.resize(stage.coefs.size() * kLanes);
+    }
+  }
+  for (auto &buffers : direction.buffers) {
+    buffers.assign(numChannels,
+                   std::vector<float>(static_cast<size_t>(maxFrames) * factor_));
+  }
+}
+
+void Oversampler::prepare(int numInputs, int numOutputs, int maxFrames,
+                          int pathLatency) {
+  // Round the round trip up to whole base-rate samples. FIR stage delays
+  // are whole oversampled samples, so the padding is exact; it is always
+  // shorter than one base-rate sample, hence than any block.
+  const double path = filterLatency_ + std::max(pathLatency, 0);
+  latency_ = static_cast<int>(std::ceil(path / factor_));
+  padLength_ = static_cast<int>(std::floor(
+      static_cast<double>(latency_) * factor_ - path + 0.5));
+  assert(filter_ != OversamplingFilter::LinearPhase ||
+         static_cast<double>(latency_) * factor_ == path + padLength_);
+  padState_.assign(numOutputs, std::vector<float>(padLength_));
+  padScratch_.resize(padLength_);
+
+  prepareDirection(up_, numInputs, maxFrames);
+  prepareDirection(down_, numOutputs, maxFrames);
+  stageInputs_.resize(std::max(numInputs, numOutputs));
+  stageOutputs_.resize(std::max(numInputs, numOutputs));
+  upsampledPointers_.resize(numInputs);
+  outputPointers_.resize(numOutputs);
+  for (int ch = 0; ch < numOutputs; ++ch) {
+    outputPointers_[ch] = down_.buffers[0][ch].data();
+  }
+  reset();
+}
+
+void Oversampler::resetDirection(Direction &direction) {
+  for (auto &state : direction.filters) {
+    std::fill(state.history.begin(), state.history.end(), 0.0f);
+    std::fill(state.odd.begin(), state.odd.end(), 0.0f);
+    std::fill(state.x.begin(), state.x.end(), 0.0f);
+    std::fill(state.y.begin(), state.y.end(), 0.0f);
+    state.pos = 0;
+  }
+}
+
+void Oversampler::reset() {
+  resetDirection(up_);
+  resetDirection(down_);
+  for (auto &state : padState_) {
+    std::fill(state.begin(), state.end(), 0.0f);
+  }
+}
+
+const float *const *Oversampler::upsample(const float *const *inputs,
+                                          int nFrames) {
+  const int numChannels = up_.numChannels;
+  if (numStages_ == 0) {
+    std::copy(inputs, inputs + numChannels, upsampledPointers_.begin());
+    return upsampledPointers_.data();
+  }
+
+  std::copy(inputs, inputs + numChannels, stageInputs_.begin());
+  int n = nFrames;
+  for (int s = 0; s < numStages_; ++s) {
+    const Stage &stage = stages_[s];
+    FilterState *filters = up_.filters.data() + s * up_.numStates;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      stageOutputs_[ch] = up_.buffers[s & 1][ch].data();
+    }
+
+    if (filter_ == OversamplingFilter::LinearPhase) {
+      const int numTaps = static_cast<int>(stage.taps.size());
+      const int halfLength = numTaps / 2;
+      for (int ch = 0; ch < numChannels; ++ch) {
+        FilterState &state = filters[ch];
+        const float *in = stageInputs_[ch];
+        float *out = stageOutputs_[ch];
+        float *history = state.history.data();
+        int pos = state.pos;
+        for (int i = 0; i < n; ++i) {
+          history[pos] = history[pos + numTaps] = in[i];
+          const float *window = history + pos + 1;
+          pos = pos + 1 == numTaps ? 0 : pos + 1;
+          out[2 * i] = dot(stage.taps.data(), window, numTaps);
+          out[2 * i + 1] = window[halfLength];
+        }
+        state.pos = pos;
+      }
+    } else {
+      const int numCoefs = static_cast<int>(stage.coefs.size());
+      for (int g = 0; g < up_.numStates; ++g) {
+        FilterState &state = filters[g];
+        const int first = g * kLanes;
+        const int lanes = std::min(kLanes, numChannels - first);
+        const float *const *in = stageInputs_.data() + first;
+        float *const *out = stageOutputs_.data() + first;
+        for (int i = 0; i < n; ++i) {
+          simd::Float4 a = gather(in, lanes, i);
+          simd::Float4 b = a;
+          allpassPairs(stage.coefs.data(), numCoefs, state.x.data(),
+                       state.y.data(), a, b);
+          scatter(a, out, lanes, 2 * i);
+          scatter(b, out, lanes, 2 * i + 1);
+        }
+      }
+    }
+
+    std::copy(stageOutputs_.begin(), stageOutputs_.begin() + numChannels,
+              stageInputs_.begin());
+    n *= 2;
+  }
+  std::copy(stageInputs_.begin(), stageInputs_.begin() + numChannels,
+            upsampledPointers_.begin());
+  return upsampledPointers_.data();
+}
+
+void Oversampler::downsample(float **outputs, int nFrames) {
+  const int numChannels = down_.numChannels;
+  if (padLength_ > 0) {
+    // Delay in place: the block's last samples become the next block's
+    // first.
+    const int n = nFrames * factor_;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      float *buffer = outputPointers_[ch];
+      float *state = padState_[ch].data();
+      std::copy(buffer + n - padLength_, buffer + n, padScratch_.begin());
+      std::memmove(buffer + padLength_, buffer,
+                   sizeof(float) * (n - padLength_));
+      std::copy(state, state + padLength_, buffer);
+      std::copy(padScratch_.begin(), padScratch_.end(), state);
+    }
+  }
+  if (numStages_ == 0) {
+    for (int ch = 0; ch < numChannels; ++ch) {
+      std::memcpy(outputs[ch], outputPointers_[ch], sizeof(float) * nFrames);
+    }
+    return;
+  }
+
+  std::copy(outputPointers_.begin(), outputPointers_.end(),
+            stageInputs_.begin());
+  int n = nFrames << (numStages_ - 1);
+  for (int step = 0; step < numStages_; ++step) {
+    const int s = numStages_ - 1 - step;
+    const Stage &stage = stages_[s];
+    FilterState *filters = down_.filters.data() + s * down_.numStates;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      stageOutputs_[ch] = step + 1 == numStages_
+                              ? outputs[ch]
+                              : down_.buffers[(step + 1) & 1][ch].data();
+    }
+
+    if (filter_ == OversamplingFilter::LinearPhase) {
+      const int numTaps = static_cast<int>(stage.taps.size());
+      const int halfLength = numTaps / 2;
+      for (int ch = 0; ch < numChannels; ++ch) {
+        FilterState &state = filters[ch];
+        const float *in = stageInputs_[ch];
+        float *out = stageOutputs_[ch];
+        float *history = state.history.data();
+        float *odd = state.odd.data();
+        int pos = state.pos;
+        for (int i = 0; i < n; ++i) {
+          history[pos] = history[pos + numTaps] = in[2 * i];
+          odd[pos] = odd[pos + numTaps] = in[2 * i + 1];
+          const float *window = history + pos + 1;
+          const float *oddWindow = odd + pos + 1;
+          pos = pos + 1 == numTaps ? 0 : pos + 1;
+          out[i] = 0.5f * (oddWindow[halfLength - 1] +
+                           dot(stage.taps.data(), window, numTaps));
+        }
+        state.pos = pos;
+      }
+    } else {
+      const int numCoefs = static_cast<int>(stage.coefs.size());
+      const simd::Float4 half = simd::Float4::set1(0.5f);
+      for (int g = 0; g < down_.numStates; ++g) {
+        FilterState &state = filters[g];
+        const int first = g * kLanes;
+        const int lanes = std::min(kLanes, numChannels - first);
+        const float *const *in = stageInputs_.data() + first;
+        float *const *out = stageOutputs_.data() + first;
+        for (int i = 0; i < n; ++i) {
+          simd::Float4 a = gather(in, lanes, 2 * i + 1);
+          simd::Float4 b = gather(in, lanes, 2 * i);
+          allpassPairs(stage.coefs.data(), numCoefs, state.x.data(),
+                       state.y.data(), a, b);
+          scatter((a + b) * half, out, lanes, i);
+        }
+      }
+    }
+
+    std::copy(stageOutputs_.begin(), stageOutputs_.begin() + numChannels,
+              stageInputs_.begin());
+    n /= 2;
+  }
+}
+
+} // namespace ms
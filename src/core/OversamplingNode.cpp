@@ -0,0 +1,117 @@
+#include "OversamplingNode.hpp"
+#include <algorithm>
+
+namespace ms {
+
+namespace {
+
+int countPorts(const std::vector<Port> &ports, PortType type) {
+  return static_cast<int>(std::count_if(
+      ports.begin(), ports.end(),
+      [type](const Port &port) { return port.type == type; }));
+}
+
+} // namespace
+
+OversamplingNode::OversamplingNode(const std::string &id,
+                                   std::shared_ptr<Node> inner, int factor,
+                                   OversamplingFilter filter)
+    : Node(id), inner_(std::move(inner)), oversampler_(factor, filter) {
+  inputPorts_ = inner_->getInputPorts();
+  outputPorts_ = inner_->getOutputPorts();
+  numAudioInputs_ = countPorts(inputPorts_, PortType::Audio);
+  numAudioOutputs_ = countPorts(outputPorts_, PortType::Audio);
+  setProcessControlEveryBlock(inner_->getProcessControlEveryBlock());
+
+  // Declared in the same order, so handles of the two nodes line up.
+  for (const Param &param : inner_->getParams()) {
+    addParam(param.name, param.value);
+    forwardedParams_.push_back(param.value);
+  }
+
+  const int numEventInputs = countPorts(inputPorts_, PortType::Event);
+  const int numEventOutputs = countPorts(outputPorts_, PortType::Event);
+  inputEventStorage_.resize(static_cast<size_t>(numEventInputs) *
+                            kEventCapacity);
+  inputSpans_.resize(numEventInputs);
+  outputEventStorage_.resize(static_cast<size_t>(numEventOutputs) *
+                             kEventCapacity);
+  outputQueues_.resize(numEventOutputs);
+  for (int p = 0; p < numEventOutputs; ++p) {
+    outputQueues_[p].bind(outputEventStorage_.data() + p * kEventCapacity,
+                          kEventCapacity);
+    outputQueuePointers_.push_back(&outputQueues_[p]);
+  }
+}
+
+void OversamplingNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  const int factor = oversampler_.getFactor();
+  inner_->prepare(sampleRate * factor, blockSize * factor);
+  // The oversampler pads the inner node's latency with its own, so the
+  // sum is whole samples at the graph's rate.
+  oversampler_.prepare(numAudioInputs_, numAudioOutputs_, blockSize,
+                       inner_->getLatency());
+  setLatency(oversampler_.getLatency());
+  // The filters ring for about their latency after the inner node stops.
+  const int innerTail = inner_->getTailLength();
+  setTailLength(innerTail == kInfiniteTail
+                    ? kInfiniteTail
+                    : (innerTail + factor - 1) / factor +
+                          oversampler_.getLatency());
+}
+
+void OversamplingNode::forwardParams() {
+  const Span<Param> params = getParams();
+  for (size_t i = 0; i < forwardedParams_.size(); ++i) {
+    if (params[i].value != forwardedParams_[i]) {
+      forwardedParams_[i] = params[i].value;
+      inner_->setParam(ParamHandle{static_cast<int>(i)}, params[i].value);
+    }
+  }
+}
+
+void OversamplingNode::process(const float *const *inputs, float **outputs,
+                               int nFrames) {
+  forwardParams();
+  const float *const *upsampled = oversampler_.upsample(inputs, nFrames);
+  inner_->process(upsampled, oversampler_.getOversampledOutputs(),
+                  nFrames * oversampler_.getFactor());
+  oversampler_.downsample(outputs, nFrames);
+}
+
+void OversamplingNode::processControl(const ControlInputs &inputControls,
+                                      ControlOutputs &outputControls) {
+  forwardParams();
+  inner_->processControl(inputControls, outputControls);
+}
+
+void OversamplingNode::processEvent(const EventSpan *inputEvents,
+                                    EventQueue *const *outputEvents) {
+  const int factor = oversampler_.getFactor();
+  for (size_t p = 0; p < inputSpans_.size(); ++p) {
+    Event *scaled = inputEventStorage_.data() + p * kEventCapacity;
+    const size_t count =
+        std::min(inputEvents[p].size(), static_cast<size_t>(kEventCapacity));
+    for (size_t i = 0; i < count; ++i) {
+      scaled[i] = inputEvents[p][i];
+      scaled[i].sampleOffset *= factor;
+    }
+    inputSpans_[p] = EventSpan(scaled, count);
+  }
+  for (auto &queue : outputQueues_) {
+    queue.clear();
+  }
+
+  inner_->processEvent(inputSpans_.data(), outputQueuePointers_.data());
+
+  for (size_t p = 0; p < outputQueues_.size(); ++p) {
+    for (const Event &event : outputQueues_[p].events()) {
+      Event scaled = event;
+      scaled.sampleOffset /= factor;
+      outputEvents[p]->push(scaled);
+    }
+  }
+}
+
+} // namespace ms
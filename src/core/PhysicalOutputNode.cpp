@@ -0,0 +1,16 @@
+#include "PhysicalOutputNode.hpp"
+
+namespace ms {
+
+PhysicalOutputNode::PhysicalOutputNode(const std::string &id,
+                                       const std::vector<int> &deviceChannels)
+    : Node(id), deviceChannels_(deviceChannels) {
+  // A sink never produces audio of its own, so there is nothing to fade.
+  setFadeInDuration(0.0f);
+  setFadeOutDuration(0.0f);
+  for (size_t i = 0; i < deviceChannels_.size(); ++i) {
+    addInputPort("in" + std::to_string(i), PortType::Audio);
+  }
+}
+
+} // namespace ms
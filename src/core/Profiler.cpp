@@ -0,0 +1,75 @@
+#include "Profiler.hpp"
+
+namespace ms {
+
+namespace {
+
+/** Returns the duration below which the given fraction of calls fall. */
+double percentile(const NodeProfile &profile, uint64_t calls, double fraction,
+                  double nsPerTick) {
+  const uint64_t rank = static_cast<uint64_t>(fraction * (calls - 1)) + 1;
+  uint64_t seen = 0;
+  for (int bin = 0; bin < NodeProfile::kHistogramBins; ++bin) {
+    seen += profile.histogram[bin].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      // Report the middle of the bin.
+      const double lo = static_cast<double>(NodeProfile::binFloor(bin));
+      const double hi =
+          bin + 1 < NodeProfile::kHistogramBins
+              ? static_cast<double>(NodeProfile::binFloor(bin + 1))
+              : lo;
+      return 0.5 * (lo + hi) * nsPerTick;
+    }
+  }
+  return 0.0;
+}
+
+} // namespace
+
+NodeProfileStats makeProfileStats(const NodeProfile &profile, double nsPerTick) {
+  NodeProfileStats stats;
+  stats.nodeId = profile.nodeId;
+
+  const uint64_t calls = profile.process.calls.load(std::memory_order_relaxed);
+  stats.processCalls = calls;
+  if (calls > 0) {
+    stats.processMinNs =
+        profile.process.minTicks.load(std::memory_order_relaxed) * nsPerTick;
+    stats.processMeanNs =
+        profile.process.totalTicks.load(std::memory_order_relaxed) *
+        nsPerTick / static_cast<double>(calls);
+    stats.processMaxNs =
+        profile.process.maxTicks.load(std::memory_order_relaxed) * nsPerTick;
+    stats.processP50Ns = percentile(profile, calls, 0.50, nsPerTick);
+    stats.processP90Ns = percentile(profile, calls, 0.90, nsPerTick);
+    stats.processP99Ns = percentile(profile, calls, 0.99, nsPerTick);
+  }
+
+  stats.controlCalls = profile.control.calls.load(std::memory_order_relaxed);
+  if (stats.controlCalls > 0) {
+    stats.controlMeanNs =
+        profile.control.totalTicks.load(std::memory_order_relaxed) *
+        nsPerTick / static_cast<double>(stats.controlCalls);
+    stats.controlMaxNs =
+        profile.control.maxTicks.load(std::memory_order_relaxed) * nsPerTick;
+  }
+
+  stats.eventCalls = profile.event.calls.load(std::memory_order_relaxed);
+  if (stats.eventCalls > 0) {
+    stats.eventMeanNs =
+        profile.event.totalTicks.load(std::memory_order_relaxed) * nsPerTick /
+        static_cast<double>(stats.eventCalls);
+    stats.eventMaxNs =
+        profile.event.maxTicks.load(std::memory_order_relaxed) * nsPerTick;
+  }
+
+  stats.subnormalSamples =
+      profile.subnormalSamples.load(std::memory_order_relaxed);
+  stats.nonFiniteSamples =
+      profile.nonFiniteSamples.load(std::memory_order_relaxed);
+  stats.nonFiniteOrigins =
+      profile.nonFiniteOrigins.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace ms
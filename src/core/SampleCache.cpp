@@ -0,0 +1,247 @@
+#include "SampleCache.hpp"
+#include "miniaudio.hpp"
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace ms {
+
+namespace {
+
+/** Frames decoded per read. */
+constexpr ma_uint64 kChunkFrames = 65536;
+
+} // namespace
+
+size_t SampleCache::KeyHash::operator()(const SampleKey &key) const {
+  size_t hash = std::hash<std::string>()(key.path);
+  hash ^= std::hash<int>()(key.sampleRate) + 0x9e3779b9 + (hash << 6) +
+          (hash >> 2);
+  hash ^= std::hash<int>()(static_cast<int>(key.format)) + 0x9e3779b9 +
+          (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+SampleCache &SampleCache::instance() {
+  static SampleCache cache;
+  return cache;
+}
+
+SampleCache::SampleCache(size_t budgetBytes, int numLoaders)
+    : numLoaders_(std::max(numLoaders, 1)) {
+  stats_.budgetBytes = budgetBytes;
+}
+
+SampleCache::~SampleCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  queued_.notify_all();
+  for (std::thread &loader : loaders_) {
+    loader.join();
+  }
+  // Requests no loader started get no sample.
+  for (auto &waiting : waiting_) {
+    for (Callback &done : waiting.second) {
+      done(nullptr);
+    }
+  }
+}
+
+std::shared_ptr<DecodedSample> SampleCache::decode(const SampleKey &key) {
+  if (key.format != SampleFormat::F32 && key.format != SampleFormat::S16) {
+    return nullptr;
+  }
+  const ma_format format =
+      key.format == SampleFormat::S16 ? ma_format_s16 : ma_format_f32;
+  const ma_decoder_config config = ma_decoder_config_init(
+      format, 0, static_cast<ma_uint32>(std::max(key.sampleRate, 0)));
+  ma_decoder decoder;
+  if (ma_decoder_init_file(key.path.c_str(), &config, &decoder) !=
+      MA_SUCCESS) {
+    return nullptr;
+  }
+  auto sample = std::make_shared<DecodedSample>();
+  sample->key = key;
+  sample->sampleRate = static_cast<int>(decoder.outputSampleRate);
+  sample->channels = static_cast<int>(decoder.outputChannels);
+
+  // The reported length can be an estimate (resampling, some compressed
+  // formats), so read until the decoder runs dry.
+  ma_uint64 expected = 0;
+  ma_decoder_get_length_in_pcm_frames(&decoder, &expected);
+  const size_t channels = static_cast<size_t>(sample->channels);
+  auto readAll = [&](auto &data) {
+    data.reserve(static_cast<size_t>(expected) * channels);
+    for (;;) {
+      const size_t done = data.size() / channels;
+      data.resize((done + kChunkFrames) * channels);
+      ma_uint64 read = 0;
+      ma_decoder_read_pcm_frames(&decoder, data.data() + done * channels,
+                                 kChunkFrames, &read);
+      data.resize((done + read) * channels);
+      if (read < kChunkFrames) {
+        break;
+      }
+    }
+    data.shrink_to_fit();
+    sample->frames = data.size() / channels;
+  };
+  if (format == ma_format_s16) {
+    readAll(sample->int16s);
+  } else {
+    readAll(sample->floats);
+  }
+  ma_decoder_uninit(&decoder);
+  if (sample->frames == 0) {
+    return nullptr;
+  }
+  return sample;
+}
+
+void SampleCache::startLoaders() {
+  if (!loaders_.empty()) {
+    return;
+  }
+  for (int i = 0; i < numLoaders_; ++i) {
+    loaders_.emplace_back([this] { loaderLoop(); });
+  }
+}
+
+void SampleCache::loaderLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    queued_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+    if (quit_) {
+      return;
+    }
+    const SampleKey key = queue_.front();
+    queue_.pop_front();
+
+    lock.unlock();
+    const auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<const DecodedSample> sample = decode(key);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    lock.lock();
+
+    stats_.decodeSeconds += seconds;
+    if (sample) {
+      stats_.decodedBytes += sample->getBytes();
+      recency_.push_front(key);
+      entries_[key] = Entry{sample, recency_.begin()};
+      stats_.residentBytes += sample->getBytes();
+      // The new entry is referenced here, so it survives its own eviction.
+      evict(stats_.budgetBytes);
+    } else {
+      ++stats_.failures;
+    }
+    std::vector<Callback> callbacks = std::move(waiting_[key]);
+    waiting_.erase(key);
+
+    lock.unlock();
+    // The last callback takes the loader's reference, so that once it has
+    // run the entry is only held by its users.
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      if (i + 1 == callbacks.size()) {
+        callbacks[i](std::move(sample));
+      } else {
+        callbacks[i](sample);
+      }
+    }
+    callbacks.clear();
+    lock.lock();
+  }
+}
+
+std::shared_ptr<const DecodedSample> SampleCache::find(const SampleKey &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  ++stats_.hits;
+  touch(it->second);
+  return it->second.sample;
+}
+
+void SampleCache::loadAsync(const SampleKey &key, Callback done) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    ++stats_.hits;
+    touch(it->second);
+    std::shared_ptr<const DecodedSample> sample = it->second.sample;
+    lock.unlock();
+    done(std::move(sample));
+    return;
+  }
+  ++stats_.misses;
+  auto waiting = waiting_.find(key);
+  if (waiting != waiting_.end()) {
+    waiting->second.push_back(std::move(done));
+    return;
+  }
+  waiting_[key].push_back(std::move(done));
+  queue_.push_back(key);
+  startLoaders();
+  lock.unlock();
+  queued_.notify_one();
+}
+
+std::shared_ptr<const DecodedSample> SampleCache::load(const SampleKey &key) {
+  auto result =
+      std::make_shared<std::promise<std::shared_ptr<const DecodedSample>>>();
+  std::future<std::shared_ptr<const DecodedSample>> future =
+      result->get_future();
+  loadAsync(key, [result](std::shared_ptr<const DecodedSample> sample) {
+    result->set_value(std::move(sample));
+  });
+  return future.get();
+}
+
+void SampleCache::setBudget(size_t budgetBytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.budgetBytes = budgetBytes;
+  evict(budgetBytes);
+}
+
+size_t SampleCache::getBudget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_.budgetBytes;
+}
+
+void SampleCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  evict(0);
+}
+
+SampleCacheStats SampleCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SampleCacheStats stats = stats_;
+  stats.entries = static_cast<int>(entries_.size());
+  return stats;
+}
+
+void SampleCache::evict(size_t budgetBytes) {
+  auto it = recency_.end();
+  while (stats_.residentBytes > budgetBytes && it != recency_.begin()) {
+    --it;
+    auto entry = entries_.find(*it);
+    if (entry->second.sample.use_count() > 1) {
+      continue;
+    }
+    stats_.residentBytes -= entry->second.sample->getBytes();
+    ++stats_.evictions;
+    entries_.erase(entry);
+    it = recency_.erase(it);
+  }
+}
+
+void SampleCache::touch(Entry &entry) {
+  recency_.splice(recency_.begin(), recency_, entry.recency);
+}
+
+} // namespace ms
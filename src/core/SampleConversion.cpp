@@ -0,0 +1,231 @@
+#include "SampleConversion.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace ms {
+
+namespace {
+
+/** Frames converted per channel before moving on to the next channel. Keeps
+ * the interleaved destination lines hot in cache while staying on the stack. */
+constexpr int kTileFrames = 64;
+
+struct QuantizeRange {
+  float scale;
+  float lo;
+  float hi;
+};
+
+QuantizeRange rangeFor(SampleFormat format) {
+  switch (format) {
+  case SampleFormat::S16:
+    return {32767.0f, -32768.0f, 32767.0f};
+  case SampleFormat::S24:
+    return {8388607.0f, -8388608.0f, 8388607.0f};
+  default:
+    // 2147483647 is not representable as float; clamp to the largest float
+    // below 2^31 so the conversion never overflows.
+    return {2147483647.0f, -2147483648.0f, 2147483520.0f};
+  }
+}
+
+inline simd::UInt4 xorshift(simd::UInt4 &state) {
+  state = state ^ state.shl<13>();
+  state = state ^ state.shr<17>();
+  state = state ^ state.shl<5>();
+  return state;
+}
+
+/** Uniform noise in [0, 1) built from the top 23 bits of each lane. */
+inline simd::Float4 uniform(simd::UInt4 &state) {
+  return (xorshift(state).shr<9>() | simd::UInt4::set1(0x3F800000u))
+             .asFloat() -
+         simd::Float4::set1(1.0f);
+}
+
+inline float uniformScalar(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  const uint32_t bits = (state >> 9) | 0x3F800000u;
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f - 1.0f;
+}
+
+/**
+ * Scales, dithers, clamps and rounds n samples to int32. A null source
+ * produces exact digital silence (no dither noise).
+ */
+void quantize(const float *src, int32_t *dst, int n, const QuantizeRange &range,
+              DitherState *dither) {
+  if (!src) {
+    std::memset(dst, 0, sizeof(int32_t) * n);
+    return;
+  }
+
+  const simd::Float4 scale = simd::Float4::set1(range.scale);
+  const simd::Float4 lo = simd::Float4::set1(range.lo);
+  const simd::Float4 hi = simd::Float4::set1(range.hi);
+
+  int i = 0;
+  if (dither) {
+    simd::UInt4 state = simd::UInt4::load(dither->seeds);
+    for (; i + simd::kWidth <= n; i += simd::kWidth) {
+      simd::Float4 x = simd::Float4::load(src + i) * scale;
+      x += uniform(state) - uniform(state);
+      simd::clamp(x, lo, hi).storeRoundedInt(dst + i);
+    }
+    state.store(dither->seeds);
+    for (; i < n; ++i) {
+      float x = src[i] * range.scale + uniformScalar(dither->seeds[0]) -
+                uniformScalar(dither->seeds[0]);
+      x = std::min(std::max(x, range.lo), range.hi);
+      dst[i] = static_cast<int32_t>(std::lrintf(x));
+    }
+    return;
+  }
+
+  for (; i + simd::kWidth <= n; i += simd::kWidth) {
+    simd::clamp(simd::Float4::load(src + i) * scale, lo, hi)
+        .storeRoundedInt(dst + i);
+  }
+  for (; i < n; ++i) {
+    const float x = std::min(std::max(src[i] * range.scale, range.lo), range.hi);
+    dst[i] = static_cast<int32_t>(std::lrintf(x));
+  }
+}
+
+void interleaveFloat(const float *const *channels, int numChannels, float *dst,
+                     int nFrames) {
+  if (numChannels == 1) {
+    if (channels[0]) {
+      std::memcpy(dst, channels[0], sizeof(float) * nFrames);
+    } else {
+      std::memset(dst, 0, sizeof(float) * nFrames);
+    }
+    return;
+  }
+
+  if (numChannels == 2 && channels[0] && channels[1]) {
+    const float *left = channels[0];
+    const float *right = channels[1];
+    int i = 0;
+    for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+      const simd::Float4 l = simd::Float4::load(left + i);
+      const simd::Float4 r = simd::Float4::load(right + i);
+      simd::zipLo(l, r).store(dst + 2 * i);
+      simd::zipHi(l, r).store(dst + 2 * i + simd::kWidth);
+    }
+    for (; i < nFrames; ++i) {
+      dst[2 * i] = left[i];
+      dst[2 * i + 1] = right[i];
+    }
+    return;
+  }
+
+  for (int frame0 = 0; frame0 < nFrames; frame0 += kTileFrames) {
+    const int n = std::min(kTileFrames, nFrames - frame0);
+    float *out = dst + static_cast<size_t>(frame0) * numChannels;
+    for (int c = 0; c < numChannels; ++c) {
+      const float *src = channels[c];
+      if (src) {
+        src += frame0;
+        for (int i = 0; i < n; ++i) {
+          out[i * numChannels + c] = src[i];
+        }
+      } else {
+        for (int i = 0; i < n; ++i) {
+          out[i * numChannels + c] = 0.0f;
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+void interleaveToDevice(const float *const *channels, int numChannels,
+                        void *destination, SampleFormat format, int nFrames,
+                        DitherState *dither) {
+  if (numChannels <= 0 || nFrames <= 0 || !destination) {
+    return;
+  }
+
+  if (format == SampleFormat::F32) {
+    interleaveFloat(channels, numChannels, static_cast<float *>(destination),
+                    nFrames);
+    return;
+  }
+
+  const QuantizeRange range = rangeFor(format);
+  DitherState *activeDither =
+      (dither && dither->enabled && format != SampleFormat::S32) ? dither
+                                                                 : nullptr;
+
+  alignas(16) int32_t quantized[kTileFrames];
+  const size_t frameBytes =
+      static_cast<size_t>(numChannels) * bytesPerSample(format);
+  uint8_t *bytes = static_cast<uint8_t *>(destination);
+
+  for (int frame0 = 0; frame0 < nFrames; frame0 += kTileFrames) {
+    const int n = std::min(kTileFrames, nFrames - frame0);
+    uint8_t *tile = bytes + frame0 * frameBytes;
+
+    for (int c = 0; c < numChannels; ++c) {
+      const float *src = channels[c] ? channels[c] + frame0 : nullptr;
+      quantize(src, quantized, n, range, activeDither);
+
+      switch (format) {
+      case SampleFormat::S16: {
+        int16_t *out = reinterpret_cast<int16_t *>(tile) + c;
+        for (int i = 0; i < n; ++i) {
+          out[i * numChannels] = static_cast<int16_t>(quantized[i]);
+        }
+        break;
+      }
+      case SampleFormat::S24: {
+        uint8_t *out = tile + c * 3;
+        for (int i = 0; i < n; ++i) {
+          const uint32_t s = static_cast<uint32_t>(quantized[i]);
+          uint8_t *p = out + i * frameBytes;
+          p[0] = static_cast<uint8_t>(s);
+          p[1] = static_cast<uint8_t>(s >> 8);
+          p[2] = static_cast<uint8_t>(s >> 16);
+        }
+        break;
+      }
+      default: {
+        int32_t *out = reinterpret_cast<int32_t *>(tile) + c;
+        for (int i = 0; i < n; ++i) {
+          out[i * numChannels] = quantized[i];
+        }
+        break;
+      }
+      }
+    }
+  }
+}
+
+void convertSamples(const float *source, double *destination, int nFrames) {
+  int i = 0;
+  for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+    simd::Float4::load(source + i).storeDouble(destination + i);
+  }
+  for (; i < nFrames; ++i) {
+    destination[i] = source[i];
+  }
+}
+
+void convertSamples(const double *source, float *destination, int nFrames) {
+  int i = 0;
+  for (; i + simd::kWidth <= nFrames; i += simd::kWidth) {
+    simd::Float4::loadDouble(source + i).store(destination + i);
+  }
+  for (; i < nFrames; ++i) {
+    destination[i] = static_cast<float>(source[i]);
+  }
+}
+
+} // namespace ms
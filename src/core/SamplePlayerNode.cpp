@@ -0,0 +1,653 @@
+#include "SamplePlayerNode.hpp"
+#include "miniaudio.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace ms {
+
+namespace {
+
+/** Frames decoded per read on the I/O thread. */
+constexpr int kChunkFrames = 4096;
+
+/** How often the I/O thread tops up the rings while voices stream. */
+constexpr auto kPollPeriod = std::chrono::milliseconds(5);
+
+/** Backstop for a wake-up the audio thread could not deliver. */
+constexpr auto kIdlePeriod = std::chrono::milliseconds(50);
+
+/** Playback states of a voice. */
+enum VoiceState : int {
+  kFree,     // available to "play" events
+  kPlaying,  // rendering, maybe releasing
+  kStopping, // done; waiting for the I/O thread to close its stream
+};
+
+/** Copies the first channels of interleaved frames of stride fileChannels. */
+void keepChannels(const float *in, int fileChannels, float *out, int channels,
+                  size_t frames) {
+  for (size_t i = 0; i < frames; ++i) {
+    std::copy(in + i * fileChannels, in + i * fileChannels + channels,
+              out + i * channels);
+  }
+}
+
+/** Where a voice reads its frames: the head in memory, then the ring. */
+struct FrameSource {
+  const float *head;
+  uint64_t headFrames;
+  int headStride;
+  const float *ring;
+  int channels;
+
+  const float *at(uint64_t n) const {
+    return n < headFrames
+               ? head + n * headStride
+               : ring + ((n - headFrames) & (SamplePlayerNode::kRingFrames - 1)) *
+                            channels;
+  }
+};
+
+/**
+ * Mixes frames [begin, end) of a voice into the outputs with linear
+ * interpolation, where every frame read is known to be available, and
+ * returns the new position. Channels is the sample's channel count, or 0
+ * for any count.
+ */
+template <int Channels>
+double mixAvailable(const FrameSource &source, double position, double ratio,
+                    const float *rates, const float *gains, float **outputs,
+                    int numOutputs, int begin, int end) {
+  const int channels = Channels ? Channels : source.channels;
+  for (int i = begin; i < end; ++i) {
+    // Positions stay far below 2^63; the signed conversion is one
+    // instruction.
+    const uint64_t n = static_cast<uint64_t>(static_cast<int64_t>(position));
+    const float fraction = static_cast<float>(position - n);
+    const float *a = source.at(n);
+    const float *b = source.at(n + 1);
+    for (int o = 0; o < numOutputs; ++o) {
+      const int c = o % channels;
+      outputs[o][i] += gains[i] * (a[c] + (b[c] - a[c]) * fraction);
+    }
+    position += rates[i] * ratio;
+  }
+  return position;
+}
+
+} // namespace
+
+struct SamplePlayerNode::Sample {
+  std::string path;
+  /** Channels kept: min(file channels, outputs). */
+  int channels = 0;
+  int fileChannels = 0;
+  int sampleRate = 0;
+  /** Length of the file, in frames. */
+  uint64_t length = 0;
+  /**
+   * The first headFrames frames, interleaved with a stride of headStride
+   * floats: the preloaded head or a whole sample from a SampleCache. Voices
+   * stream from here on.
+   */
+  uint64_t headFrames = 0;
+  const float *headData = nullptr;
+  int headStride = 0;
+  std::vector<float> head;
+  std::shared_ptr<const DecodedSample> shared;
+  std::shared_ptr<const MappedAudioFile> mapped;
+};
+
+struct SamplePlayerNode::Voice {
+  /**
+   * Frames headFrames, headFrames + 1, ... of the stream, interleaved at
+   * the sample's channel count. The I/O thread writes, the audio thread
+   * reads; written and consumed count frames past headFrames.
+   */
+  std::vector<float> ring;
+  std::atomic<uint64_t> written{0};
+  std::atomic<uint64_t> consumed{0};
+  /** Frame at which the stream ends; lowered by the I/O thread on errors. */
+  std::atomic<uint64_t> end{0};
+  /** Ring frames the I/O thread keeps decoded ahead of the audio thread. */
+  std::atomic<uint64_t> readAhead{0};
+  /** Set by the I/O thread once it has closed the voice's stream. */
+  std::atomic<bool> released{false};
+
+  // I/O thread.
+  ma_decoder decoder;
+  /** True while the voice streams; it has a decoder unless mapped. */
+  bool open = false;
+  const Sample *streamed = nullptr;
+
+  // Audio thread.
+  int index = 0;
+  int state = kFree;
+  /** True while the voice has a stream the I/O thread serves. */
+  bool streaming = false;
+  /** True once the stop command is posted. */
+  bool closing = false;
+  const Sample *sample = nullptr;
+  /** Playback position, in frames of the file. */
+  double position = 0.0;
+  /** Frames of the current block before the voice starts. */
+  int delay = 0;
+  /** Frame of the current block at which the release starts, or -1. */
+  int releaseAt = -1;
+  /** Frames of the release left, or -1 if not releasing. */
+  int releaseLeft = -1;
+};
+
+SamplePlayerNode::SamplePlayerNode(const std::string &id, int numOutputs,
+                                   int numVoices, int preloadFrames)
+    : StaticNode<SamplePlayerNode>(id), numOutputs_(std::max(numOutputs, 1)),
+      preloadFrames_(std::max(preloadFrames, 1)),
+      // Each voice has at most a start and a stop in flight.
+      commands_(2 * static_cast<size_t>(std::max(numVoices, 1))) {
+  addInputPort("trigger", PortType::Event);
+  for (int o = 0; o < numOutputs_; ++o) {
+    addOutputPort("out" + std::to_string(o), PortType::Audio);
+  }
+  rate_ = addSmoothedParam("rate", 1.0f);
+  gain_ = addSmoothedParam("gain", 1.0f);
+  playSymbol_ = Symbol::intern("play");
+  stopSymbol_ = Symbol::intern("stop");
+  sampleTable_.assign(kMaxSamples, nullptr);
+  for (int v = 0; v < std::max(numVoices, 1); ++v) {
+    voices_.push_back(std::make_unique<Voice>());
+    voices_.back()->index = v;
+  }
+}
+
+SamplePlayerNode::~SamplePlayerNode() {
+  if (ioThread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(ioMutex_);
+      ioQuit_.store(true);
+    }
+    ioWakeup_.notify_one();
+    ioThread_.join();
+  }
+}
+
+int SamplePlayerNode::loadSample(const std::string &path) {
+  const int count = sampleCount_.load(std::memory_order_relaxed);
+  if (count == kMaxSamples) {
+    return -1;
+  }
+  // Decode at the file's own channel count and rate; voices resample.
+  const ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 0, 0);
+  ma_decoder decoder;
+  if (ma_decoder_init_file(path.c_str(), &config, &decoder) != MA_SUCCESS) {
+    return -1;
+  }
+  ma_format format;
+  ma_uint32 fileChannels = 0;
+  ma_uint32 sampleRate = 0;
+  ma_uint64 length = 0;
+  if (ma_decoder_get_data_format(&decoder, &format, &fileChannels, &sampleRate,
+                                 nullptr, 0) != MA_SUCCESS ||
+      ma_decoder_get_length_in_pcm_frames(&decoder, &length) != MA_SUCCESS ||
+      fileChannels == 0 || sampleRate == 0 || length == 0) {
+    ma_decoder_uninit(&decoder);
+    return -1;
+  }
+
+  auto sample = std::make_unique<Sample>();
+  sample->path = path;
+  sample->fileChannels = static_cast<int>(fileChannels);
+  sample->channels = std::min(sample->fileChannels, numOutputs_);
+  sample->sampleRate = static_cast<int>(sampleRate);
+  const uint64_t wanted =
+      std::min<uint64_t>(length, static_cast<uint64_t>(preloadFrames_));
+  std::vector<float> decoded(wanted * fileChannels);
+  ma_uint64 read = 0;
+  ma_decoder_read_pcm_frames(&decoder, decoded.data(), wanted, &read);
+  ma_decoder_uninit(&decoder);
+  if (read == 0) {
+    return -1;
+  }
+  // A short read means the reported length was wrong; trust the data.
+  sample->length = read < wanted ? read : length;
+  sample->headFrames = read;
+  sample->head.resize(read * sample->channels);
+  keepChannels(decoded.data(), sample->fileChannels, sample->head.data(),
+               sample->channels, read);
+  sample->headData = sample->head.data();
+  sample->headStride = sample->channels;
+
+  startStreaming();
+  preloadBytes_.fetch_add(sample->head.size() * sizeof(float),
+                          std::memory_order_relaxed);
+  return publish(std::move(sample));
+}
+
+int SamplePlayerNode::addSample(std::shared_ptr<const DecodedSample> decoded) {
+  if (!decoded || decoded->key.format != SampleFormat::F32 ||
+      decoded->frames == 0 ||
+      sampleCount_.load(std::memory_order_relaxed) == kMaxSamples) {
+    return -1;
+  }
+  auto sample = std::make_unique<Sample>();
+  sample->path = decoded->key.path;
+  sample->fileChannels = decoded->channels;
+  sample->channels = std::min(decoded->channels, numOutputs_);
+  sample->sampleRate = decoded->sampleRate;
+  // The whole sample is the head: it plays from the shared data and never
+  // streams.
+  sample->length = decoded->frames;
+  sample->headFrames = decoded->frames;
+  sample->headData = decoded->floats.data();
+  sample->headStride = decoded->channels;
+  sample->shared = std::move(decoded);
+  return publish(std::move(sample));
+}
+
+int SamplePlayerNode::addSample(std::shared_ptr<const MappedAudioFile> file) {
+  if (!file || !file->isOpen() ||
+      sampleCount_.load(std::memory_order_relaxed) == kMaxSamples) {
+    return -1;
+  }
+  auto sample = std::make_unique<Sample>();
+  sample->path = file->getPath();
+  sample->fileChannels = file->getChannels();
+  sample->channels = std::min(sample->fileChannels, numOutputs_);
+  sample->sampleRate = file->getSampleRate();
+  sample->length = file->getFrames();
+  // The head is copied (16-bit data converted) rather than played from
+  // the mapping: the kernel may evict mapped pages at any time, and the
+  // audio thread must never fault one back in.
+  const uint64_t head =
+      std::min<uint64_t>(sample->length, static_cast<uint64_t>(preloadFrames_));
+  std::vector<float> converted(head * sample->fileChannels);
+  file->read(0, head, converted.data());
+  sample->head.resize(head * sample->channels);
+  keepChannels(converted.data(), sample->fileChannels, sample->head.data(),
+               sample->channels, head);
+  sample->headFrames = head;
+  sample->headData = sample->head.data();
+  sample->headStride = sample->channels;
+  preloadBytes_.fetch_add(sample->head.size() * sizeof(float),
+                          std::memory_order_relaxed);
+  if (sample->length > head) {
+    // Only the I/O thread reads the rest, in order.
+    file->advise(AccessPattern::Sequential);
+    startStreaming();
+  }
+  sample->mapped = std::move(file);
+  return publish(std::move(sample));
+}
+
+int SamplePlayerNode::publish(std::unique_ptr<Sample> sample) {
+  const int count = sampleCount_.load(std::memory_order_relaxed);
+  sampleTable_[count] = sample.get();
+  samples_.push_back(std::move(sample));
+  sampleCount_.store(count + 1, std::memory_order_release);
+  return count;
+}
+
+void SamplePlayerNode::startStreaming() {
+  if (ioThread_.joinable()) {
+    return;
+  }
+  // Rings are only read by voices playing a sample, which are published
+  // after this.
+  size_t bytes = 0;
+  for (const auto &voice : voices_) {
+    voice->ring.assign(static_cast<size_t>(kRingFrames) * numOutputs_, 0.0f);
+    bytes += voice->ring.size() * sizeof(float);
+  }
+  ringBytes_.store(bytes, std::memory_order_relaxed);
+  ioThread_ = std::thread([this] { ioLoop(); });
+}
+
+SamplePlayerStats SamplePlayerNode::getStats() const {
+  SamplePlayerStats stats;
+  stats.samples = sampleCount_.load(std::memory_order_acquire);
+  stats.preloadBytes = preloadBytes_.load(std::memory_order_relaxed);
+  stats.ringBytes = ringBytes_.load(std::memory_order_relaxed);
+  stats.activeVoices = activeVoices_.load(std::memory_order_relaxed);
+  stats.underruns = underruns_.load(std::memory_order_relaxed);
+  stats.droppedTriggers = droppedTriggers_.load(std::memory_order_relaxed);
+  stats.streamErrors = streamErrors_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void SamplePlayerNode::prepare(int sampleRate, int blockSize) {
+  Node::prepare(sampleRate, blockSize);
+  rates_.assign(blockSize, 1.0f);
+  // The graph never processes a node while preparing it, so voices can be
+  // ended here; their streams close in the background.
+  for (const auto &voice : voices_) {
+    if (voice->state == kPlaying) {
+      stopVoice(*voice);
+    }
+  }
+}
+
+bool SamplePlayerNode::postCommand(const StreamCommand &command) {
+  if (!commands_.push(command)) {
+    return false;
+  }
+  // As in ConvolutionNode: passing through the mutex orders the flag
+  // against the I/O thread's wait; if the mutex is busy, its timeout
+  // covers the rare miss.
+  ioPosted_.store(true, std::memory_order_release);
+  if (ioMutex_.try_lock()) {
+    ioMutex_.unlock();
+  }
+  ioWakeup_.notify_one();
+  return true;
+}
+
+void SamplePlayerNode::startVoice(Voice &voice, const Sample &sample,
+                                  int offset) {
+  voice.state = kPlaying;
+  voice.sample = &sample;
+  voice.position = 0.0;
+  voice.delay = offset;
+  voice.releaseAt = -1;
+  voice.releaseLeft = -1;
+  voice.closing = false;
+  voice.streaming = sample.length > sample.headFrames;
+  if (!voice.streaming) {
+    voice.end.store(sample.length, std::memory_order_relaxed);
+    return;
+  }
+  // The command publishes the ring state to the I/O thread.
+  voice.written.store(0, std::memory_order_relaxed);
+  voice.consumed.store(0, std::memory_order_relaxed);
+  voice.end.store(sample.length, std::memory_order_relaxed);
+  voice.readAhead.store(
+      readAheadFrames(getSmoother(rate_)->getCurrent(), sample),
+      std::memory_order_relaxed);
+  if (!postCommand(StreamCommand{voice.index, &sample})) {
+    voice.streaming = false;
+    voice.end.store(sample.headFrames, std::memory_order_relaxed);
+  }
+}
+
+void SamplePlayerNode::stopVoice(Voice &voice) {
+  voice.state = voice.streaming ? kStopping : kFree;
+  // If the queue is full, render() retries next block.
+  voice.closing =
+      voice.streaming && postCommand(StreamCommand{voice.index, nullptr});
+}
+
+uint64_t SamplePlayerNode::readAheadFrames(float rate,
+                                           const Sample &sample) const {
+  const double step = std::min(std::max(rate, 0.0f), kMaxRate) *
+                      static_cast<double>(sample.sampleRate) / sampleRate_;
+  const double frames = std::ceil(step * sampleRate_ * kReadAheadMs / 1000.0);
+  return std::min<uint64_t>(static_cast<uint64_t>(frames) + kChunkFrames,
+                            kRingFrames);
+}
+
+void SamplePlayerNode::processEvent(const EventSpan *inputEvents,
+                                    EventQueue *const *) {
+  const int count = sampleCount_.load(std::memory_order_acquire);
+  for (const Event &event : inputEvents[0]) {
+    const int index = event.value.isInt() ? event.value.asInt() : -1;
+    const bool valid = index >= 0 && index < count;
+    if (event.type == playSymbol_ && valid) {
+      auto free = std::find_if(
+          voices_.begin(), voices_.end(),
+          [](const std::unique_ptr<Voice> &v) { return v->state == kFree; });
+      if (free == voices_.end()) {
+        droppedTriggers_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      startVoice(**free, *sampleTable_[index], event.sampleOffset);
+    } else if (event.type == stopSymbol_) {
+      for (const auto &voice : voices_) {
+        if (voice->state == kPlaying && voice->releaseLeft < 0 &&
+            (!valid || voice->sample == sampleTable_[index])) {
+          voice->releaseAt = std::max(event.sampleOffset, voice->delay);
+        }
+      }
+    }
+  }
+}
+
+void SamplePlayerNode::render(float **outputs, int nFrames) {
+  for (int o = 0; o < numOutputs_; ++o) {
+    std::fill(outputs[o], outputs[o] + nFrames, 0.0f);
+  }
+  const float *smoothedRates = getSmoother(rate_)->processBlock(nFrames);
+  const float *gains = getSmoother(gain_)->processBlock(nFrames);
+  float *rates = rates_.data();
+  float fastest = 0.0f;
+  for (int i = 0; i < nFrames; ++i) {
+    rates[i] = std::min(std::max(smoothedRates[i], 0.0f), kMaxRate);
+    fastest = std::max(fastest, rates[i]);
+  }
+  const int releaseFrames =
+      std::max(1, static_cast<int>(sampleRate_ * kReleaseMs / 1000.0f));
+  int active = 0;
+
+  for (const auto &voicePointer : voices_) {
+    Voice &voice = *voicePointer;
+    if (voice.state == kStopping) {
+      if (!voice.closing) {
+        stopVoice(voice);
+      } else if (voice.released.exchange(false, std::memory_order_acquire)) {
+        voice.state = kFree;
+      }
+      continue;
+    }
+    if (voice.state != kPlaying) {
+      continue;
+    }
+
+    const Sample &sample = *voice.sample;
+    const double ratio =
+        static_cast<double>(sample.sampleRate) / static_cast<double>(sampleRate_);
+    // Frames the audio thread may read: the head and what has been
+    // streamed. The I/O thread lowers end before it publishes the last
+    // frames.
+    const uint64_t available =
+        sample.headFrames + voice.written.load(std::memory_order_acquire);
+    const uint64_t end = voice.end.load(std::memory_order_acquire);
+    const FrameSource source{sample.headData, sample.headFrames,
+                             sample.headStride, voice.ring.data(),
+                             sample.channels};
+
+    // Up to the first frame that may need data the voice does not have,
+    // or a release, frames mix without checks.
+    int i = voice.delay;
+    if (voice.releaseAt < 0 && voice.releaseLeft < 0) {
+      const double room =
+          static_cast<double>(std::min(available, end)) - 2.0 - voice.position;
+      const double maxStep = fastest * ratio;
+      int count = 0;
+      if (room > 0.0) {
+        count = maxStep > 0.0 ? static_cast<int>(std::min(
+                                    room / maxStep, static_cast<double>(nFrames)))
+                              : nFrames;
+      }
+      const int stop = std::min(nFrames, i + count);
+      switch (sample.channels) {
+      case 1:
+        voice.position =
+            mixAvailable<1>(source, voice.position, ratio, rates, gains,
+                            outputs, numOutputs_, i, stop);
+        break;
+      case 2:
+        voice.position =
+            mixAvailable<2>(source, voice.position, ratio, rates, gains,
+                            outputs, numOutputs_, i, stop);
+        break;
+      default:
+        voice.position =
+            mixAvailable<0>(source, voice.position, ratio, rates, gains,
+                            outputs, numOutputs_, i, stop);
+        break;
+      }
+      i = stop;
+    }
+
+    bool finished = false;
+    for (; i < nFrames; ++i) {
+      if (i == voice.releaseAt) {
+        voice.releaseLeft = releaseFrames;
+      }
+      const uint64_t n = static_cast<uint64_t>(voice.position);
+      if (n >= end) {
+        finished = true;
+        break;
+      }
+      if (n + 1 >= available && n + 1 < end) {
+        // The disk fell behind: silence until the I/O thread catches up.
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+      const float fraction = static_cast<float>(voice.position - n);
+      const float *a = source.at(n);
+      const float *b = n + 1 < end ? source.at(n + 1) : nullptr;
+      float gain = gains[i];
+      if (voice.releaseLeft >= 0) {
+        gain *= static_cast<float>(voice.releaseLeft) / releaseFrames;
+        if (voice.releaseLeft-- == 0) {
+          finished = true;
+          break;
+        }
+      }
+      for (int o = 0; o < numOutputs_; ++o) {
+        const int c = o % sample.channels;
+        const float next = b ? b[c] : 0.0f;
+        outputs[o][i] += gain * (a[c] + (next - a[c]) * fraction);
+      }
+      voice.position += rates[i] * ratio;
+    }
+    voice.delay = 0;
+    voice.releaseAt = -1;
+
+    if (finished) {
+      stopVoice(voice);
+      continue;
+    }
+    ++active;
+    if (voice.streaming) {
+      // Frames before the playback position are no longer needed.
+      const uint64_t n = static_cast<uint64_t>(voice.position);
+      voice.consumed.store(
+          n > sample.headFrames ? n - sample.headFrames : 0,
+          std::memory_order_release);
+      voice.readAhead.store(readAheadFrames(rates[nFrames - 1], sample),
+                            std::memory_order_relaxed);
+    }
+  }
+  activeVoices_.store(active, std::memory_order_relaxed);
+}
+
+bool SamplePlayerNode::fillVoice(Voice &voice, std::vector<float> &scratch) {
+  const Sample &sample = *voice.streamed;
+  const uint64_t written = voice.written.load(std::memory_order_relaxed);
+  const uint64_t buffered =
+      written - voice.consumed.load(std::memory_order_acquire);
+  const uint64_t target = voice.readAhead.load(std::memory_order_relaxed);
+  const uint64_t remaining = voice.end.load(std::memory_order_relaxed) -
+                             sample.headFrames - written;
+  if (buffered >= target || remaining == 0) {
+    return false;
+  }
+  const uint64_t frames = std::min<uint64_t>(
+      {static_cast<uint64_t>(kChunkFrames), kRingFrames - buffered, remaining});
+  const uint64_t frame = sample.headFrames + written;
+  scratch.resize(frames * sample.fileChannels);
+  uint64_t read = 0;
+  if (sample.mapped) {
+    // Have the kernel start on the next chunk while this one is copied.
+    sample.mapped->prefetch(frame + frames, kChunkFrames);
+    read = sample.mapped->read(frame, frames, scratch.data());
+  } else {
+    ma_uint64 decoded = 0;
+    ma_decoder_read_pcm_frames(&voice.decoder, scratch.data(), frames,
+                               &decoded);
+    read = decoded;
+  }
+
+  // Copy in up to two runs around the end of the ring.
+  const uint64_t start = written & (kRingFrames - 1);
+  const uint64_t first = std::min<uint64_t>(read, kRingFrames - start);
+  float *ring = voice.ring.data();
+  keepChannels(scratch.data(), sample.fileChannels,
+               ring + start * sample.channels, sample.channels, first);
+  keepChannels(scratch.data() + first * sample.fileChannels,
+               sample.fileChannels, ring, sample.channels, read - first);
+  if (read < frames) {
+    // The file is shorter than it claimed, or unreadable: end the voice
+    // where the data stops.
+    voice.end.store(frame + read, std::memory_order_release);
+  }
+  voice.written.store(written + read, std::memory_order_release);
+  return read > 0;
+}
+
+void SamplePlayerNode::ioLoop() {
+  std::vector<float> scratch;
+  while (!ioQuit_.load(std::memory_order_acquire)) {
+    StreamCommand command;
+    while (commands_.pop(command)) {
+      Voice &voice = *voices_[command.voice];
+      closeStream(voice);
+      if (!command.sample) {
+        voice.released.store(true, std::memory_order_release);
+        continue;
+      }
+      const Sample &sample = *command.sample;
+      voice.streamed = &sample;
+      if (sample.mapped) {
+        voice.open = true;
+        continue;
+      }
+      const ma_decoder_config config =
+          ma_decoder_config_init(ma_format_f32, 0, 0);
+      if (ma_decoder_init_file(sample.path.c_str(), &config, &voice.decoder) !=
+          MA_SUCCESS) {
+        voice.end.store(sample.headFrames, std::memory_order_release);
+        streamErrors_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      voice.open = true;
+      if (ma_decoder_seek_to_pcm_frame(&voice.decoder, sample.headFrames) !=
+          MA_SUCCESS) {
+        ma_decoder_uninit(&voice.decoder);
+        voice.open = false;
+        voice.end.store(sample.headFrames, std::memory_order_release);
+        streamErrors_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    // Top up in rounds of one chunk per voice, so that a voice far behind
+    // does not starve the others; check for commands between rounds.
+    bool streaming = false;
+    bool filled = false;
+    for (const auto &voice : voices_) {
+      if (voice->open) {
+        streaming = true;
+        filled = fillVoice(*voice, scratch) || filled;
+      }
+    }
+    if (filled) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(ioMutex_);
+    ioWakeup_.wait_for(lock, streaming ? kPollPeriod : kIdlePeriod, [this] {
+      return ioQuit_.load() || ioPosted_.exchange(false);
+    });
+  }
+  for (const auto &voice : voices_) {
+    closeStream(*voice);
+  }
+}
+
+void SamplePlayerNode::closeStream(Voice &voice) {
+  if (voice.open && !voice.streamed->mapped) {
+    ma_decoder_uninit(&voice.decoder);
+  }
+  voice.open = false;
+}
+
+} // namespace ms
@@ -0,0 +1,175 @@
+#include "SmoothedValue.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace ms {
+
+namespace {
+
+/** Fraction of the distance left at the end of an exponential ramp. */
+constexpr float kExponentialResidual = 0.001f;
+
+void fillConstant(float *dst, float value, int n) {
+  const simd::Float4 v = simd::Float4::set1(value);
+  int i = 0;
+  for (; i + simd::kWidth <= n; i += simd::kWidth) {
+    v.store(dst + i);
+  }
+  for (; i < n; ++i) {
+    dst[i] = value;
+  }
+}
+
+} // namespace
+
+SmoothedValue::SmoothedValue(float initialValue, float rampTimeMs,
+                             SmoothingType type)
+    : current_(initialValue), target_(initialValue), rampTimeMs_(rampTimeMs),
+      type_(type) {
+  updateRampSamples();
+}
+
+void SmoothedValue::prepare(int sampleRate, int blockSize) {
+  sampleRate_ = sampleRate;
+  buffer_.assign(blockSize, target_);
+  bufferHoldsTarget_ = false;
+  updateRampSamples();
+  setCurrentAndTarget(target_);
+}
+
+void SmoothedValue::setRampTime(float rampTimeMs) {
+  rampTimeMs_ = rampTimeMs;
+  updateRampSamples();
+}
+
+void SmoothedValue::setType(SmoothingType type) {
+  type_ = type;
+  updateRampSamples();
+}
+
+void SmoothedValue::updateRampSamples() {
+  rampSamples_ = std::max(
+      0, static_cast<int>(rampTimeMs_ * 0.001f * static_cast<float>(sampleRate_)));
+  coefficient_ =
+      rampSamples_ > 0
+          ? std::pow(kExponentialResidual, 1.0f / static_cast<float>(rampSamples_))
+          : 0.0f;
+}
+
+void SmoothedValue::setTarget(float target) {
+  if (target == target_) {
+    return;
+  }
+  target_ = target;
+  bufferHoldsTarget_ = false;
+  if (rampSamples_ == 0) {
+    current_ = target;
+    remaining_ = 0;
+    return;
+  }
+  remaining_ = rampSamples_;
+  step_ = (target_ - current_) / static_cast<float>(rampSamples_);
+}
+
+void SmoothedValue::setCurrentAndTarget(float value) {
+  if (value != target_ || isRamping()) {
+    bufferHoldsTarget_ = false;
+  }
+  current_ = value;
+  target_ = value;
+  remaining_ = 0;
+}
+
+float SmoothedValue::getNextValue() {
+  if (remaining_ == 0) {
+    return current_;
+  }
+  if (--remaining_ == 0) {
+    current_ = target_;
+  } else if (type_ == SmoothingType::Linear) {
+    current_ += step_;
+  } else {
+    current_ = target_ + (current_ - target_) * coefficient_;
+  }
+  return current_;
+}
+
+void SmoothedValue::skip(int nFrames) {
+  if (remaining_ == 0) {
+    return;
+  }
+  const int n = std::min(nFrames, remaining_);
+  remaining_ -= n;
+  if (remaining_ == 0) {
+    current_ = target_;
+  } else if (type_ == SmoothingType::Linear) {
+    current_ += step_ * static_cast<float>(n);
+  } else {
+    current_ = target_ + (current_ - target_) *
+                             std::pow(coefficient_, static_cast<float>(n));
+  }
+}
+
+const float *SmoothedValue::processBlock(int nFrames) {
+  nFrames = std::min(nFrames, static_cast<int>(buffer_.size()));
+  float *out = buffer_.data();
+
+  if (remaining_ == 0) {
+    if (!bufferHoldsTarget_) {
+      fillConstant(out, target_, static_cast<int>(buffer_.size()));
+      bufferHoldsTarget_ = true;
+    }
+    return out;
+  }
+
+  const int rampFrames = std::min(nFrames, remaining_);
+  int i = 0;
+
+  if (type_ == SmoothingType::Linear) {
+    const float start = current_;
+    const float step = step_;
+    simd::Float4 v = simd::Float4::set(1.0f, 2.0f, 3.0f, 4.0f) *
+                         simd::Float4::set1(step) +
+                     simd::Float4::set1(start);
+    const simd::Float4 increment = simd::Float4::set1(4.0f * step);
+    for (; i + simd::kWidth <= rampFrames; i += simd::kWidth) {
+      v.store(out + i);
+      v += increment;
+    }
+    for (; i < rampFrames; ++i) {
+      out[i] = start + step * static_cast<float>(i + 1);
+    }
+    current_ = start + step * static_cast<float>(rampFrames);
+  } else {
+    const float a = coefficient_;
+    const float a2 = a * a;
+    const float a4 = a2 * a2;
+    float distance = current_ - target_;
+    const simd::Float4 target = simd::Float4::set1(target_);
+    const simd::Float4 decay4 = simd::Float4::set1(a4);
+    simd::Float4 d = simd::Float4::set(a, a2, a2 * a, a4) *
+                     simd::Float4::set1(distance);
+    for (; i + simd::kWidth <= rampFrames; i += simd::kWidth) {
+      (target + d).store(out + i);
+      d *= decay4;
+      distance *= a4;
+    }
+    for (; i < rampFrames; ++i) {
+      distance *= a;
+      out[i] = target_ + distance;
+    }
+    current_ = target_ + distance;
+  }
+
+  remaining_ -= rampFrames;
+  if (remaining_ == 0) {
+    current_ = target_;
+    out[rampFrames - 1] = target_;
+  }
+  fillConstant(out + rampFrames, target_, nFrames - rampFrames);
+  bufferHoldsTarget_ = false;
+  return out;
+}
+
+} // namespace ms
@@ -0,0 +1,15 @@
+#include "SumNode.hpp"
+#include <algorithm>
+
+namespace ms {
+
+SumNode::SumNode(const std::string &id, int numInputs)
+    : StaticNode<SumNode>(id), numInputs_(std::max(numInputs, 1)) {
+  for (int i = 0; i < numInputs_; ++i) {
+    addInputPort("in" + std::to_string(i), PortType::Audio);
+  }
+  addOutputPort("out", PortType::Audio);
+  setTailLength(0);
+}
+
+} // namespace ms
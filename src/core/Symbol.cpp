@@ -0,0 +1,81 @@
+#include "Symbol.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ms {
+
+namespace {
+
+/**
+ * Append-only table of interned strings. Entries live in fixed-size chunks
+ * that are never moved, so readers can resolve ids without locking.
+ */
+class SymbolTable {
+public:
+  static SymbolTable &instance() {
+    static SymbolTable table;
+    return table;
+  }
+
+  uint32_t intern(std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(std::string(name));
+    if (it != ids_.end()) {
+      return it->second;
+    }
+
+    const uint32_t id = count_.load(std::memory_order_relaxed);
+    const uint32_t chunk = id / kChunkSize;
+    if (chunk >= kMaxChunks) {
+      return 0;
+    }
+    if (!chunks_[chunk].load(std::memory_order_relaxed)) {
+      chunks_[chunk].store(new std::string[kChunkSize],
+                           std::memory_order_release);
+    }
+    chunks_[chunk].load(std::memory_order_relaxed)[id % kChunkSize] =
+        std::string(name);
+    ids_.emplace(std::string(name), id);
+    count_.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  std::string_view name(uint32_t id) const {
+    if (id >= count_.load(std::memory_order_acquire)) {
+      return {};
+    }
+    return chunks_[id / kChunkSize].load(std::memory_order_acquire)[id % kChunkSize];
+  }
+
+private:
+  static constexpr uint32_t kChunkSize = 1024;
+  static constexpr uint32_t kMaxChunks = 1024;
+
+  SymbolTable() { intern(""); }
+
+  ~SymbolTable() {
+    for (auto &chunk : chunks_) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::atomic<std::string *> chunks_[kMaxChunks] = {};
+  std::atomic<uint32_t> count_{0};
+};
+
+} // namespace
+
+Symbol Symbol::intern(std::string_view name) {
+  return Symbol(SymbolTable::instance().intern(name));
+}
+
+std::string_view Symbol::str() const {
+  return SymbolTable::instance().name(id_);
+}
+
+} // namespace ms